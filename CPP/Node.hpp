@@ -4,21 +4,78 @@
 
 #ifndef SCAPEGOATTREE_NODE_HPP
 #define SCAPEGOATTREE_NODE_HPP
-template<typename T>
-class Node {
+#include <cstdint>
+#include <utility>
+#include "aggregates.hpp"
+/**
+ * Tree node. With an Aggregate other than NoAggregate it also carries the
+ * aggregate of its whole subtree (inherited field `agg`).
+ */
+template<typename T, typename Aggregate = NoAggregate>
+class Node : public NodeAggregate<Aggregate> {
 public:
     T value{};     // stored value
+    unsigned int size=1;      // subtree size; next to value so small keys need no padding
     Node* left{};    // left child pointer
     Node* right{};   // right child pointer
     Node* parent{};  // parent pointer
-    unsigned int size=1;      // subtree size
+    std::uint64_t birth=0;    // epoch the node was created in (copy-on-write snapshots)
 
     /**
      * Initializes a node with a value and an optional parent pointer.
      */
     explicit Node(const T& v, Node* parentPtr = nullptr)
     : value(v), parent(parentPtr){}
-    template<typename>
+    explicit Node(T&& v, Node* parentPtr = nullptr)
+    : value(std::move(v)), parent(parentPtr){}
+    template<typename, typename>
     friend class ScapeGoatTree;
 };
+
+/**
+ * Which optional fields a CompactNode stores. Without parent links the
+ * iterator keeps a stack of ancestors; without subtree sizes scapegoats are
+ * found by counting the siblings along the insertion path (as in Galperin and
+ * Rivest's original algorithm) and kthSmallest does not compile.
+ */
+template<bool Parent = true, bool Size = true>
+struct NodeFeatures {
+    static constexpr bool parent = Parent;
+    static constexpr bool size = Size;
+};
+
+/**
+ * The optional fields, one specialization per combination, on top of the
+ * aggregate. A single base keeps every compiler from padding empty ones.
+ */
+template<typename Aggregate, bool Parent, bool Size>
+struct CompactLinks : NodeAggregate<Aggregate> {
+    std::uint32_t parent = 0;
+    std::uint32_t size = 1; // subtree size
+};
+template<typename Aggregate>
+struct CompactLinks<Aggregate, true, false> : NodeAggregate<Aggregate> {
+    std::uint32_t parent = 0;
+};
+template<typename Aggregate>
+struct CompactLinks<Aggregate, false, true> : NodeAggregate<Aggregate> {
+    std::uint32_t size = 1;
+};
+template<typename Aggregate>
+struct CompactLinks<Aggregate, false, false> : NodeAggregate<Aggregate> {};
+
+/**
+ * Node of a CompactScapeGoatTree. Links are 32-bit slots in the tree's node
+ * array (0 = none) instead of pointers: 20 bytes for an int key, where a
+ * Node<int> takes 40; 16 without the parent link and 12 without the size too.
+ */
+template<typename T, typename Aggregate = NoAggregate, typename Features = NodeFeatures<>>
+struct CompactNode : CompactLinks<Aggregate, Features::parent, Features::size> {
+    T value{};
+    std::uint32_t left = 0;
+    std::uint32_t right = 0;
+
+    explicit CompactNode(const T& v) : value(v) {}
+    explicit CompactNode(T&& v) : value(std::move(v)) {}
+};
 #endif //SCAPEGOATTREE_NODE_HPP
@@ -0,0 +1,77 @@
+//
+// Created by DELL on 19/01/2026.
+//
+
+#ifndef SCAPEGOATPROJECT_AGGREGATES_HPP
+#define SCAPEGOATPROJECT_AGGREGATES_HPP
+#include <cstddef>
+#include <limits>
+
+/**
+ * Subtree aggregates (monoids) a ScapeGoatTree can maintain per node.
+ *
+ * A monoid provides:
+ *  - value_type                 the aggregate's type
+ *  - identity()                 neutral element (aggregate of an empty range)
+ *  - lift(const T&)             aggregate of a single key
+ *  - combine(a, b)              associative merge, a covers smaller keys than b
+ *
+ * Any struct with that shape can be plugged in as a user-defined aggregate.
+ */
+
+/**
+ * Default: nodes store no aggregate at all.
+ */
+struct NoAggregate {};
+
+template<typename T>
+struct SumAggregate {
+    using value_type = T;
+    static value_type identity() { return T{}; }
+    static value_type lift(const T& v) { return v; }
+    static value_type combine(const value_type& a, const value_type& b) { return a + b; }
+};
+
+template<typename T>
+struct MinAggregate {
+    using value_type = T;
+    static value_type identity() { return std::numeric_limits<T>::max(); }
+    static value_type lift(const T& v) { return v; }
+    static value_type combine(const value_type& a, const value_type& b) { return b < a ? b : a; }
+};
+
+template<typename T>
+struct MaxAggregate {
+    using value_type = T;
+    static value_type identity() { return std::numeric_limits<T>::lowest(); }
+    static value_type lift(const T& v) { return v; }
+    static value_type combine(const value_type& a, const value_type& b) { return a < b ? b : a; }
+};
+
+template<typename T>
+struct CountAggregate {
+    using value_type = std::size_t;
+    static value_type identity() { return 0; }
+    static value_type lift(const T&) { return 1; }
+    static value_type combine(const value_type& a, const value_type& b) { return a + b; }
+};
+
+template<typename T>
+struct SumOfSquaresAggregate {
+    using value_type = T;
+    static value_type identity() { return T{}; }
+    static value_type lift(const T& v) { return v * v; }
+    static value_type combine(const value_type& a, const value_type& b) { return a + b; }
+};
+
+/**
+ * Storage for a node's aggregate; empty (and optimized away) for NoAggregate.
+ */
+template<typename Aggregate>
+struct NodeAggregate {
+    typename Aggregate::value_type agg{}; // aggregate over the whole subtree
+};
+template<>
+struct NodeAggregate<NoAggregate> {};
+
+#endif //SCAPEGOATPROJECT_AGGREGATES_HPP
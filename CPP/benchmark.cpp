@@ -1,7 +1,19 @@
 #include <iostream>
 #include <chrono>
 #include <set>
+#include <vector>
+#include <algorithm>
+#include <limits>
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <random>
+#include <memory>
 #include "scapegoat_tree.hpp"
+#include "sharded_scapegoat_tree.hpp"
+#include "rcu_scapegoat_tree.hpp"
+#include "concurrent_scapegoat_tree.hpp"
+#include "compact_scapegoat_tree.hpp"
 
 void benchmark_sequential_ops() {
     constexpr int N = 50000;  // ✅ Size that works
@@ -23,6 +35,13 @@ void benchmark_sequential_ops() {
     int sum = sgt.sumInRange(0, N);
     end = std::chrono::high_resolution_clock::now();
     auto sgt_range = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    // Same query on a tree that keeps subtree sums
+    ScapeGoatTree<int, SumAggregate<int>> summed;
+    for (int i = 0; i < N; ++i) summed.insert(i);
+    start = std::chrono::high_resolution_clock::now();
+    int aggregated_sum = summed.sumInRange(0, N);
+    end = std::chrono::high_resolution_clock::now();
+    auto agg_range = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start);
      //Sequential Delete
      start = std::chrono::high_resolution_clock::now();
     for (int i = 0; i < N; ++i) sgt.deleteValue(i);
@@ -55,13 +74,918 @@ void benchmark_sequential_ops() {
     std::cout << "  std::set:      " << set_search.count() << " ms\n\n";
 
     std::cout << "Range Sum (ScapeGoat unique feature):\n";
-    std::cout << "  Result: " << sum << " in " << sgt_range.count() << " μs\n\n";
+    std::cout << "  Result: " << sum << " in " << sgt_range.count() << " μs\n";
+    std::cout << "  With SumAggregate: " << aggregated_sum << " in " << agg_range.count() << " ns\n\n";
     std::cout << "Delete:\n";
     std::cout << "  ScapeGoatTree: " << sgt_delete.count() << " ms\n";
     std::cout << "  std::set:      " << set_delete.count() << " ms\n\n";
 }
 
+void benchmark_node_pool() {
+    constexpr int N = 50000;
+    constexpr int ROUNDS = 10;
+
+    // Insert/delete churn: every round frees and re-creates the same N nodes
+    auto start = std::chrono::high_resolution_clock::now();
+    ScapeGoatTree<int> sgt;
+    for (int r = 0; r < ROUNDS; ++r) {
+        for (int i = 0; i < N; ++i) sgt.insert((i * 7919) % N);
+        for (int i = 0; i < N; ++i) sgt.deleteValue((i * 7919) % N);
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    auto churn = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+    const PoolStats& stats = sgt.poolStats();
+    std::cout << "=== Node Pool (" << ROUNDS << " rounds of " << N << " inserts + deletes) ===\n\n";
+    std::cout << "  Time:               " << churn.count() << " ms\n";
+    std::cout << "  Nodes created:      " << stats.nodesServed << "\n";
+    std::cout << "  Heap allocations:   " << stats.slabAllocations << "\n";
+    std::cout << "  Allocations saved:  " << stats.nodesServed - stats.slabAllocations << "\n";
+    std::cout << "  Pool capacity:      " << stats.capacity << " nodes\n";
+    sgt.shrink_to_fit();
+    std::cout << "  After shrink_to_fit: " << sgt.poolStats().capacity << " nodes\n\n";
+}
+
+void benchmark_hot_paths() {
+    constexpr int N = 100000;
+    // Measured on the previous insert/delete (path Vector per insert, separate size-fixing walks)
+    constexpr double BEFORE_INSERT_VISITS = 18.78;
+    constexpr double BEFORE_DELETE_VISITS = 29.87;
+    constexpr double BEFORE_INSERT_ALLOCS = 1.0; // one 50-slot path Vector per call
+
+    ScapeGoatTree<int> sgt;
+    sgt.reserve(N);
+    const std::size_t slabsBefore = sgt.poolStats().slabAllocations;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < N; ++i) sgt.insert(static_cast<int>(i * 7919LL % N));
+    auto end = std::chrono::high_resolution_clock::now();
+    auto insert_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    const double insertVisits = static_cast<double>(sgt.getNodeVisits()) / N;
+    const double insertAllocs = static_cast<double>(sgt.poolStats().slabAllocations - slabsBefore) / N;
+
+    const std::size_t visitsBefore = sgt.getNodeVisits();
+    start = std::chrono::high_resolution_clock::now();
+    for (int i = 0; i < N; ++i) sgt.deleteValue(static_cast<int>(i * 7919LL % N));
+    end = std::chrono::high_resolution_clock::now();
+    auto delete_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    const double deleteVisits = static_cast<double>(sgt.getNodeVisits() - visitsBefore) / N;
+
+    std::cout << "=== Insert/Delete Hot Paths (100K keys) ===\n\n";
+    std::cout << "Insert (" << insert_time.count() << " ms):\n";
+    std::cout << "  Node visits/op:      before " << BEFORE_INSERT_VISITS << ", now " << insertVisits << "\n";
+    std::cout << "  Heap allocations/op: before " << BEFORE_INSERT_ALLOCS << ", now " << insertAllocs << "\n\n";
+    std::cout << "Delete (" << delete_time.count() << " ms):\n";
+    std::cout << "  Node visits/op:      before " << BEFORE_DELETE_VISITS << ", now " << deleteVisits << "\n";
+    std::cout << "  Heap allocations/op: 0\n\n";
+}
+
+void benchmark_bulk_load() {
+    constexpr int N = 1000000;
+    auto* keys = new int[N];
+    for (int i = 0; i < N; ++i) keys[i] = static_cast<int>(i * 7919LL % N);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    ScapeGoatTree<int> inserted;
+    for (int i = 0; i < N; ++i) inserted.insert(keys[i]);
+    auto end = std::chrono::high_resolution_clock::now();
+    auto insert_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+    start = std::chrono::high_resolution_clock::now();
+    ScapeGoatTree<int> bulk(keys, keys + N);
+    end = std::chrono::high_resolution_clock::now();
+    auto bulk_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+
+    std::sort(keys, keys + N);
+    start = std::chrono::high_resolution_clock::now();
+    auto sorted = ScapeGoatTree<int>::fromSorted(keys, keys + N);
+    end = std::chrono::high_resolution_clock::now();
+    auto sorted_time = std::chrono::duration_cast<std::chrono::milliseconds>(end - start);
+    delete[] keys;
+
+    std::cout << "=== Bulk Load (1M keys) ===\n\n";
+    std::cout << "  insert() loop:       " << insert_time.count() << " ms\n";
+    std::cout << "  unsorted range ctor: " << bulk_time.count() << " ms\n";
+    std::cout << "  fromSorted:          " << sorted_time.count() << " ms\n\n";
+}
+
+void benchmark_insert_batch() {
+    constexpr int N = 200000;
+    std::cout << "=== insertBatch into a 200K tree: per-key vs merge-and-rebuild ===\n\n";
+    std::cout << "  batch size   per-key (ms)   merge (ms)\n";
+    for (const int m : {1000, 5000, 20000, 50000, 200000}) {
+        Vector<int> batch;
+        for (int i = 0; i < m; ++i) batch.push_back(static_cast<int>((i * 7919LL) % (4 * N)) | 1); // odd keys
+        long long times[2];
+        for (int mode = 0; mode < 2; ++mode) {
+            ScapeGoatTree<int> sgt;
+            for (int i = 0; i < N; ++i) sgt.insert(2 * i); // even keys
+            sgt.setBatchRebuildRatio(mode == 0 ? 1e18 : 0.0);
+            auto start = std::chrono::high_resolution_clock::now();
+            sgt.insertBatch(batch);
+            auto end = std::chrono::high_resolution_clock::now();
+            times[mode] = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+        }
+        std::cout << "  " << m << "\t\t" << times[0] / 1000.0 << "\t\t" << times[1] / 1000.0
+                  << (static_cast<double>(m) / N >= ScapeGoatTree<int>().getBatchRebuildRatio() ? "   <- default picks merge" : "") << "\n";
+    }
+    std::cout << "\n";
+}
+
+void benchmark_delete_batch() {
+    constexpr int N = 1000000;
+    Vector<int> purge;
+    for (int i = 0; i < N; i += 2) purge.push_back(i); // half of the tree
+
+    long long times[2];
+    for (int mode = 0; mode < 2; ++mode) {
+        ScapeGoatTree<int> sgt;
+        for (int i = 0; i < N; ++i) sgt.insert(i);
+        sgt.setBatchRebuildRatio(mode == 0 ? 1e18 : 0.0);
+        auto start = std::chrono::high_resolution_clock::now();
+        sgt.deleteBatch(purge);
+        auto end = std::chrono::high_resolution_clock::now();
+        times[mode] = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    }
+    std::cout << "=== deleteBatch purging 500K of 1M keys ===\n\n";
+    std::cout << "  per-key deleteValue: " << times[0] << " ms\n";
+    std::cout << "  set difference:      " << times[1] << " ms\n\n";
+}
+
+void benchmark_set_algebra() {
+    constexpr int N = 1000000;
+    std::vector<int> keys(N);
+    for (int i = 0; i < N; ++i) keys[i] = i * 2;
+    const ScapeGoatTree<int> big(keys.begin(), keys.end());
+
+    std::cout << "=== Set algebra against a 1M-key tree ===\n\n";
+    for (const int m : {1000, 100000, 1000000}) {
+        std::vector<int> probe(m);
+        for (int i = 0; i < m; ++i) probe[i] = static_cast<int>(static_cast<long long>(i) * N * 2 / m) + (i & 1);
+        const ScapeGoatTree<int> small(probe.begin(), probe.end());
+
+        auto start = std::chrono::high_resolution_clock::now();
+        const auto both = small.intersect(big);
+        auto end = std::chrono::high_resolution_clock::now();
+        const auto intersectUs = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+        ScapeGoatTree<int> target(keys.begin(), keys.end());
+        ScapeGoatTree<int> donor(probe.begin(), probe.end());
+        start = std::chrono::high_resolution_clock::now();
+        target.unionWith(std::move(donor));
+        end = std::chrono::high_resolution_clock::now();
+        const auto unionUs = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+        start = std::chrono::high_resolution_clock::now();
+        const auto merged = big + small;
+        end = std::chrono::high_resolution_clock::now();
+        const auto plusUs = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+
+        std::cout << "  m = " << m << ": intersect " << intersectUs << " us, unionWith "
+                  << unionUs << " us, operator+ " << plusUs << " us\n";
+    }
+    std::cout << "\n";
+}
+
+void benchmark_split_join() {
+    constexpr int N = 1000000;
+    constexpr int BUCKET = 1000;
+    constexpr int ROUNDS = 1000;
+    std::vector<int> keys(N);
+    for (int i = 0; i < N; ++i) keys[i] = i;
+
+    // time-bucketed partitions: drop the oldest bucket, append a new one
+    ScapeGoatTree<int> window(keys.begin(), keys.end());
+    long long splitUs = 0, joinUs = 0;
+    for (int round = 0; round < ROUNDS; ++round) {
+        std::vector<int> fresh(BUCKET);
+        for (int i = 0; i < BUCKET; ++i) fresh[i] = N + round * BUCKET + i;
+        ScapeGoatTree<int> bucket(fresh.begin(), fresh.end());
+
+        auto start = std::chrono::high_resolution_clock::now();
+        auto [oldest, rest] = window.split((round + 1) * BUCKET);
+        auto mid = std::chrono::high_resolution_clock::now();
+        window = ScapeGoatTree<int>::join(std::move(rest), std::move(bucket));
+        auto end = std::chrono::high_resolution_clock::now();
+        splitUs += std::chrono::duration_cast<std::chrono::microseconds>(mid - start).count();
+        joinUs += std::chrono::duration_cast<std::chrono::microseconds>(end - mid).count();
+    }
+    std::cout << "=== split/join on a 1M-key tree ===\n\n";
+    std::cout << "  rotate 1K-key buckets: split " << static_cast<double>(splitUs) / ROUNDS
+              << " us, join " << static_cast<double>(joinUs) / ROUNDS << " us\n";
+
+    // arbitrary pivots: join has to rebuild around the larger of the two seams
+    ScapeGoatTree<int> sgt(keys.begin(), keys.end());
+    unsigned int seed = 12345;
+    auto start = std::chrono::high_resolution_clock::now();
+    for (int round = 0; round < ROUNDS / 10; ++round) {
+        seed = seed * 1103515245u + 12345u;
+        auto [low, high] = sgt.split(static_cast<int>(seed % N));
+        sgt = ScapeGoatTree<int>::join(std::move(low), std::move(high));
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+    const auto us = std::chrono::duration_cast<std::chrono::microseconds>(end - start).count();
+    std::cout << "  random pivots:         split+join " << static_cast<double>(us) / (ROUNDS / 10) << " us\n";
+
+    // what a split used to cost: copying both halves out and rebuilding them
+    start = std::chrono::high_resolution_clock::now();
+    std::vector<int> lowKeys, highKeys;
+    for (int k : sgt) (k < N / 2 ? lowKeys : highKeys).push_back(k);
+    const ScapeGoatTree<int> lowCopy(lowKeys.begin(), lowKeys.end()), highCopy(highKeys.begin(), highKeys.end());
+    end = std::chrono::high_resolution_clock::now();
+    std::cout << "  copy-based split:      "
+              << std::chrono::duration_cast<std::chrono::microseconds>(end - start).count() << " us\n\n";
+}
+
+void benchmark_copy() {
+    constexpr int N = 1000000;
+    ScapeGoatTree<int> sgt;
+    unsigned int seed = 99;
+    for (int i = 0; i < N; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        sgt.insert(static_cast<int>(seed >> 1));
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+    const ScapeGoatTree<int> copy(sgt);
+    auto end = std::chrono::high_resolution_clock::now();
+    const auto copyMs = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    // what copying used to do: one insert() per node
+    start = std::chrono::high_resolution_clock::now();
+    ScapeGoatTree<int> reinserted;
+    for (int k : sgt) reinserted.insert(k);
+    end = std::chrono::high_resolution_clock::now();
+    const auto insertMs = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    std::cout << "=== Copying a 1M-node tree ===\n\n";
+    std::cout << "  structural copy: " << copyMs << " ms (" << copy.poolStats().slabAllocations
+              << " slab allocation)\n";
+    std::cout << "  insert per node: " << insertMs << " ms\n\n";
+}
+
+void benchmark_snapshot() {
+    constexpr int N = 1000000;
+    constexpr int WRITES = 200000;
+    ScapeGoatTree<int> sgt;
+    for (int i = 0; i < N; ++i) sgt.insert(i * 2);
+
+    auto writeLoop = [&sgt](unsigned int seed) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        for (int i = 0; i < WRITES; ++i) {
+            seed = seed * 1103515245u + 12345u;
+            const int key = static_cast<int>(seed % (2u * N));
+            if (key & 1) sgt.insert(key);
+            else sgt.deleteValue(key);
+        }
+        const auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    };
+
+    const auto plainMs = writeLoop(1);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    auto snap = sgt.snapshot();
+    auto end = std::chrono::high_resolution_clock::now();
+    const auto snapNs = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    const auto sharedMs = writeLoop(2);
+
+    // the alternative: copy the whole tree for a consistent reader
+    start = std::chrono::high_resolution_clock::now();
+    const ScapeGoatTree<int> copy(sgt);
+    end = std::chrono::high_resolution_clock::now();
+    const auto copyMs = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    std::cout << "=== Snapshots of a 1M-node tree (" << WRITES << " writes) ===\n\n";
+    std::cout << "  snapshot():              " << snapNs << " ns\n";
+    std::cout << "  writes, no snapshot:     " << plainMs << " ms\n";
+    std::cout << "  writes, snapshot alive:  " << sharedMs << " ms\n";
+    std::cout << "  full copy instead:       " << copyMs << " ms (snapshot still sees " << snap.size() << " keys)\n\n";
+}
+
+void benchmark_background_rebuild() {
+    constexpr int N = 2000000;
+    // deleting just over half the keys fires the deletion rebuild over the whole tree
+    auto run = [](const int backgroundMin) {
+        ScapeGoatTree<int> sgt;
+        Vector<int> keys;
+        for (int i = 0; i < N; ++i) keys.push_back(i);
+        sgt.insertBatch(keys);
+        sgt.setBackgroundRebuild(backgroundMin);
+        long long worstNs = 0, totalNs = 0;
+        for (int i = 0; i < N / 2 + 1000; ++i) {
+            const auto start = std::chrono::high_resolution_clock::now();
+            sgt.deleteValue(i * 2 % N + i * 2 / N);
+            const auto end = std::chrono::high_resolution_clock::now();
+            const long long ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+            worstNs = std::max(worstNs, ns);
+            totalNs += ns;
+        }
+        sgt.waitForRebuild();
+        return std::pair{worstNs, totalNs / 1000000};
+    };
+    const auto [syncWorst, syncMs] = run(0);
+    const auto [bgWorst, bgMs] = run(100000);
+
+    std::cout << "=== Deletion rebuild of a 2M-node tree (" << N / 2 + 1000 << " deletes) ===\n\n";
+    std::cout << "  synchronous:  worst delete " << syncWorst / 1000 << " us, total " << syncMs << " ms\n";
+    std::cout << "  background:   worst delete " << bgWorst / 1000 << " us, total " << bgMs << " ms\n\n";
+}
+
+void benchmark_latency_percentiles() {
+    constexpr int N = 1000000;
+    constexpr int RUNS = 3;
+    // ascending inserts keep producing large scapegoats; the deletes cross the deletion threshold.
+    // No undo history: its stack doubling would show up in max for every mode alike. The
+    // sequence is the same every run, so each operation keeps its fastest time, which
+    // filters out preemption
+    auto run = [](const int budget) {
+        std::vector<long long> ns(N + N / 2 + 1000, std::numeric_limits<long long>::max());
+        for (int r = 0; r < RUNS; ++r) {
+            ScapeGoatTree<int> sgt;
+            sgt.setUndoHistory(false);
+            sgt.setIncrementalRebuild(budget);
+            std::size_t at = 0;
+            auto timed = [&ns, &at](auto op) {
+                const auto start = std::chrono::high_resolution_clock::now();
+                op();
+                const auto end = std::chrono::high_resolution_clock::now();
+                ns[at] = std::min<long long>(ns[at], std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count());
+                at++;
+            };
+            for (int i = 0; i < N; ++i) timed([&sgt, i] { sgt.insert(i); });
+            for (int i = 0; i < N / 2 + 1000; ++i) timed([&sgt, i] { sgt.deleteValue(i * 2 % N + i * 2 / N); });
+        }
+        std::sort(ns.begin(), ns.end());
+        long long total = 0;
+        for (const long long t : ns) total += t;
+        struct { long long p50, p99, p999, p9999, max, totalMs; } result{
+            ns[ns.size() / 2], ns[ns.size() * 99 / 100], ns[ns.size() * 999 / 1000], ns[ns.size() * 9999 / 10000],
+            ns.back(), total / 1000000};
+        return result;
+    };
+
+    std::cout << "=== Per-operation latency, " << N << " ascending inserts + " << N / 2 + 1000
+              << " deletes (best of " << RUNS << " runs per operation) ===\n\n";
+    for (const int budget : {0, 256, 64, 16}) {
+        const auto r = run(budget);
+        std::cout << (budget ? "  budget " + std::to_string(budget) + ":" : std::string("  inline:    "))
+                  << std::string(budget >= 100 ? 1 : budget ? 2 : 0, ' ')
+                  << "p50 " << r.p50 << " ns, p99 " << r.p99 << " ns, p999 " << r.p999 << " ns, p9999 "
+                  << r.p9999 / 1000 << " us, max " << r.max / 1000 << " us, total " << r.totalMs << " ms\n";
+    }
+    std::cout << "\n";
+}
+
+void benchmark_parallel_rebuild() {
+    constexpr int N = 10000000;
+    std::vector<int> keys(N);
+    for (int i = 0; i < N; ++i) keys[i] = i;
+    auto msSince = [](const auto start) {
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count();
+    };
+
+    std::cout << "=== Parallel rebuild of a " << N / 1000000 << "M-node tree (hardware threads: "
+              << std::thread::hardware_concurrency() << ") ===\n\n";
+    for (const int threads : {1, 2, 4, 8, 16}) {
+        ScapeGoatTree<int> sgt;
+        sgt.setRebuildThreads(threads);
+        auto start = std::chrono::high_resolution_clock::now();
+        sgt.assignSorted(keys.begin(), keys.end(), false);
+        const auto buildMs = msSince(start);
+        // the delete that takes the tree below half of max_nodes relinks all remaining nodes
+        for (int i = 0; i < N / 2; ++i) sgt.deleteValue(2 * i);
+        start = std::chrono::high_resolution_clock::now();
+        sgt.deleteValue(1);
+        const auto relinkMs = msSince(start);
+        std::cout << "  " << threads << (threads < 10 ? " thread(s):  " : " threads:   ")
+                  << "build from sorted keys " << buildMs << " ms, deletion rebuild of "
+                  << sgt.size() << " nodes " << relinkMs << " ms\n";
+    }
+    std::cout << "\n";
+}
+
+void benchmark_parallel_bulk_load() {
+    // 100M keys need ~5 GB with 40-byte nodes; scale N up on a machine that has it
+    constexpr int N = 20000000;
+    std::vector<int> keys(N);
+    std::mt19937 rng(18);
+    for (int& k : keys) k = static_cast<int>(rng() % (2u * N)); // ~20% duplicates
+
+    std::cout << "=== Bulk load of " << N / 1000000 << "M unsorted keys (hardware threads: "
+              << std::thread::hardware_concurrency() << ") ===\n\n";
+    long long serialMs = 0;
+    for (const int threads : {1, 2, 4, 8, 16}) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        const auto sgt = ScapeGoatTree<int>::fromUnsorted(keys.begin(), keys.end(), threads);
+        const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count();
+        if (threads == 1) serialMs = ms;
+        std::cout << "  " << threads << (threads < 10 ? " thread(s):  " : " threads:   ") << ms << " ms ("
+                  << sgt.size() << " distinct keys, speedup " << serialMs * 100 / std::max<long long>(ms, 1) / 100.0 << "x)\n";
+    }
+    std::cout << "\n";
+}
+
+void benchmark_parallel_range() {
+    constexpr int N = 10000000;
+    constexpr long long LO = N / 20, HI = N - N / 20;
+    std::vector<long long> keys(N);
+    for (int i = 0; i < N; ++i) keys[i] = i;
+    // no aggregate, so sumInRange visits every key in the range
+    auto sgt = ScapeGoatTree<long long>::fromSorted(keys.begin(), keys.end());
+    long long sum = 0;
+    unsigned int count = 0;
+    auto time = [](auto query) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        query();
+        return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start).count();
+    };
+
+    std::cout << "=== Range queries over " << (HI - LO + 1) << " of " << N << " keys (hardware threads: "
+              << std::thread::hardware_concurrency() << ") ===\n\n";
+    const auto sumMs = time([&] { sum = sgt.sumInRange(LO, HI); });
+    const auto valuesMs = time([&] { count = sgt.valuesInRange(LO, HI).size(); });
+    std::cout << "  serial:       sum " << sumMs << " ms, values " << valuesMs << " ms\n";
+    for (const int threads : {1, 2, 4, 8, 16}) {
+        const auto parallelSumMs = time([&] { sum = sgt.sumInRangeParallel(LO, HI, threads); });
+        const auto parallelValuesMs = time([&] { count = sgt.valuesInRangeParallel(LO, HI, threads).size(); });
+        std::cout << "  " << threads << (threads < 10 ? " thread(s):  " : " threads:   ")
+                  << "sum " << parallelSumMs << " ms, values " << parallelValuesMs << " ms\n";
+    }
+    std::cout << "  (" << count << " keys, sum " << sum << ")\n\n";
+}
+
+void benchmark_task_pool() {
+    using Clock = std::chrono::high_resolution_clock;
+    auto nsPer = [](const Clock::time_point start, const long long count) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count() / count;
+    };
+    // a fork tree with empty leaves: the cost of join itself
+    auto forks = [](auto&& self, TaskPool& pool, const int depth) -> void {
+        if (depth == 0) return;
+        pool.join([&] { self(self, pool, depth - 1); }, [&] { self(self, pool, depth - 1); });
+    };
+    constexpr int DEPTH = 20;
+    constexpr long long JOINS = (1LL << DEPTH) - 1;
+
+    TaskPool& shared = TaskPool::shared();
+    std::cout << "=== Task pool (shared pool: " << shared.workers() << " worker(s), hardware threads: "
+              << std::thread::hardware_concurrency() << ") ===\n\n";
+    TaskPool inlineOnly(0);
+    auto start = Clock::now();
+    forks(forks, inlineOnly, DEPTH);
+    std::cout << "  join, no workers:      " << nsPer(start, JOINS) << " ns per fork\n";
+    const TaskPoolStats before = shared.stats();
+    start = Clock::now();
+    forks(forks, shared, DEPTH);
+    const long long sharedNs = nsPer(start, JOINS);
+    std::cout << "  join, shared pool:     " << sharedNs << " ns per fork ("
+              << shared.stats().stolen - before.stolen << " of " << JOINS << " stolen)\n";
+
+    // a fork that is always stolen: the caller waits until a worker runs it
+    constexpr int STEALS = 2000;
+    TaskPool one(1);
+    start = Clock::now();
+    for (int i = 0; i < STEALS; ++i) {
+        std::atomic<bool> taken{false};
+        one.join([&] { taken = true; }, [&] { while (!taken) std::this_thread::yield(); });
+    }
+    std::cout << "  join, always stolen:   " << nsPer(start, STEALS) << " ns per steal\n";
+    start = Clock::now();
+    for (int i = 0; i < STEALS; ++i) std::thread([] {}).join();
+    std::cout << "  std::thread per fork:  " << nsPer(start, STEALS) << " ns per spawn+join\n\n";
+
+    // summing an array in pieces of grain keys: where forking starts to pay off
+    constexpr int N = 1 << 24;
+    std::vector<long long> values(N);
+    for (int i = 0; i < N; ++i) values[i] = i;
+    auto sum = [&](auto&& self, const int lo, const int hi, const int grain) -> long long {
+        if (hi - lo <= grain) {
+            long long s = 0;
+            for (int i = lo; i < hi; ++i) s += values[i];
+            return s;
+        }
+        long long left = 0, right = 0;
+        const int mid = lo + (hi - lo) / 2;
+        shared.join([&] { left = self(self, lo, mid, grain); }, [&] { right = self(self, mid, hi, grain); });
+        return left + right;
+    };
+    long long total = 0;
+    start = Clock::now();
+    for (int i = 0; i < N; ++i) total += values[i];
+    std::cout << "  sum of " << N << " keys, serial: " << nsPer(start, 1000000) << " ms\n";
+    for (const int grain : {1 << 8, 1 << 10, 1 << 12, 1 << 15, 1 << 18, 1 << 21}) {
+        start = Clock::now();
+        total += sum(sum, 0, N, grain);
+        std::cout << "  grain " << grain << ": " << nsPer(start, 1000000) << " ms\n";
+    }
+    std::cout << "  (checksum " << total << ")\n\n";
+}
+
+void benchmark_frozen_set() {
+    constexpr int N = 4000000;
+    constexpr int LOOKUPS = 4000000;
+    std::mt19937 rng(21);
+    std::vector<int> keys(N), probes(LOOKUPS);
+    for (int& k : keys) k = static_cast<int>(rng() >> 1);
+    for (int i = 0; i < LOOKUPS; ++i) probes[i] = i % 2 ? keys[rng() % N] : static_cast<int>(rng() >> 1); // half hits
+    ScapeGoatTree<int> sgt;
+    std::set<int> stdSet;
+    for (const int k : keys) {
+        sgt.insert(k);
+        stdSet.insert(k);
+    }
+    using Clock = std::chrono::high_resolution_clock;
+    auto start = Clock::now();
+    const FrozenScapeGoatSet<int> frozen = sgt.freeze();
+    const auto freezeMs = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+    auto perSecond = [](const Clock::time_point from) {
+        const double seconds = std::chrono::duration<double>(Clock::now() - from).count();
+        return static_cast<long long>(LOOKUPS / seconds / 1e6 * 10) / 10.0;
+    };
+
+    std::cout << "=== Random lookups in " << sgt.size() << " keys (million per second) ===\n\n";
+    std::cout << "  freeze(): " << freezeMs << " ms\n";
+    int hits = 0;
+    start = Clock::now();
+    for (const int p : probes) hits += sgt.search(p);
+    std::cout << "  ScapeGoatTree::search:           " << perSecond(start) << "\n";
+    start = Clock::now();
+    for (const int p : probes) hits += stdSet.count(p) != 0;
+    std::cout << "  std::set::count:                 " << perSecond(start) << "\n";
+    start = Clock::now();
+    for (const int p : probes) hits += frozen.search(p);
+    std::cout << "  FrozenScapeGoatSet::search:      " << perSecond(start) << "\n";
+    std::unique_ptr<bool[]> found(new bool[LOOKUPS]);
+    start = Clock::now();
+    frozen.searchBatch(probes.data(), LOOKUPS, found.get());
+    std::cout << "  FrozenScapeGoatSet::searchBatch: " << perSecond(start)
+#if defined(__AVX2__)
+              << " (AVX2)\n";
+#else
+              << " (scalar; build with -mavx2 for the vector path)\n";
+#endif
+    hits += static_cast<int>(std::count(found.get(), found.get() + LOOKUPS, true));
+    long long ranks = 0;
+    start = Clock::now();
+    for (const int p : probes) ranks += frozen.rank(p);
+    std::cout << "  FrozenScapeGoatSet::rank:        " << perSecond(start) << "\n";
+    start = Clock::now();
+    for (int i = 0; i + 1 < LOOKUPS; i += 2) ranks += frozen.sumInRange(std::min(probes[i], probes[i + 1]), std::max(probes[i], probes[i + 1]));
+    std::cout << "  FrozenScapeGoatSet::sumInRange:  " << perSecond(start) / 2 << " (ranges, two probes each)\n";
+    std::cout << "  (" << hits << " hits, checksum " << ranks << ")\n\n";
+}
+
+void benchmark_compact() {
+    constexpr int N = 10000000;
+    constexpr int CHURN = 2000000;
+    constexpr int LOOKUPS = 2000000;
+    std::mt19937 rng(22);
+    ScapeGoatTree<int> sgt;
+    std::vector<int> keys(N);
+    sgt.reserve(N);
+    for (int& k : keys) sgt.insert(k = static_cast<int>(rng() >> 1));
+    for (int i = 0; i < CHURN; ++i) { // every insert lands in the slot the delete just freed
+        int& k = keys[rng() % N];
+        sgt.deleteValue(k);
+        sgt.insert(k = static_cast<int>(rng() >> 1));
+    }
+    std::vector<int> probes(LOOKUPS);
+    for (int& p : probes) p = static_cast<int>(rng() >> 1);
+    using Clock = std::chrono::high_resolution_clock;
+    auto measure = [&](const char* label) {
+        int hits = 0;
+        auto start = Clock::now();
+        for (const int p : probes) hits += sgt.search(p);
+        const double searchSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        long long sum = 0;
+        start = Clock::now();
+        for (const int p : probes) sum += sgt.getSuccessor(p);
+        const double successorSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << "  " << label << static_cast<long long>(LOOKUPS / searchSeconds / 1e3) << "K search/s, "
+                  << static_cast<long long>(LOOKUPS / successorSeconds / 1e3) << "K getSuccessor/s  (" << hits << " hits, " << sum % 1000 << ")\n";
+    };
+
+    std::cout << "=== compact() on " << sgt.size() << " keys after " << CHURN << " delete/insert pairs ===\n\n";
+    measure("before:  ");
+    const auto start = Clock::now();
+    sgt.compact();
+    std::cout << "  compact(): " << std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count() << " ms\n";
+    measure("after:   ");
+    std::cout << "\n";
+}
+
+void benchmark_compact_storage() {
+    constexpr int N = 4000000;
+    constexpr int LOOKUPS = 2000000;
+    std::mt19937 rng(23);
+    std::vector<int> keys(N), probes(LOOKUPS);
+    for (int& k : keys) k = static_cast<int>(rng() >> 1);
+    for (int& p : probes) p = static_cast<int>(rng() >> 1);
+    using Clock = std::chrono::high_resolution_clock;
+    auto run = [&](auto& tree, const char* label, auto bytes) {
+        auto start = Clock::now();
+        for (const int k : keys) tree.insert(k);
+        const double insertSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        int hits = 0;
+        start = Clock::now();
+        for (const int p : probes) hits += tree.search(p);
+        const double searchSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << "  " << label << static_cast<double>(bytes()) / tree.size() << " bytes/key, "
+                  << static_cast<long long>(N / insertSeconds / 1e3) << "K insert/s, "
+                  << static_cast<long long>(LOOKUPS / searchSeconds / 1e3) << "K search/s  (" << hits << " hits)\n";
+    };
+
+    std::cout << "=== Pointer vs index-linked nodes, " << N << " random int keys ===\n\n";
+    {
+        ScapeGoatTree<int> sgt;
+        run(sgt, "ScapeGoatTree:        ", [&] { return sgt.poolStats().capacity * sizeof(Node<int>); });
+    }
+    {
+        CompactScapeGoatTree<int> compact;
+        run(compact, "CompactScapeGoatTree: ", [&] { return compact.memoryUsage(); });
+        compact.shrink_to_fit();
+        std::cout << "  after shrink_to_fit:  " << static_cast<double>(compact.memoryUsage()) / compact.size() << " bytes/key\n";
+    }
+    std::cout << "\n";
+}
+
+void benchmark_node_features() {
+    constexpr int N = 2000000;
+    constexpr int LOOKUPS = 2000000;
+    std::mt19937 rng(24);
+    std::vector<int> keys(N), probes(LOOKUPS);
+    for (int& k : keys) k = static_cast<int>(rng() >> 1);
+    for (int& p : probes) p = static_cast<int>(rng() >> 1);
+    using Clock = std::chrono::high_resolution_clock;
+    auto run = [&]<typename Features>(const char* label) {
+        CompactScapeGoatTree<int, NoAggregate, Features> tree;
+        auto start = Clock::now();
+        for (const int k : keys) tree.insert(k);
+        const double insertSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        tree.shrink_to_fit();
+        int hits = 0;
+        start = Clock::now();
+        for (const int p : probes) hits += tree.search(p);
+        const double searchSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        long long sum = 0;
+        start = Clock::now();
+        for (auto it = tree.begin(); it != decltype(tree)::end(); ++it) sum += *it;
+        const double iterateMs = std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+        start = Clock::now();
+        for (int i = 0; i < N; i += 2) tree.deleteValue(keys[i]);
+        const double deleteSeconds = std::chrono::duration<double>(Clock::now() - start).count();
+        std::cout << "  " << label << tree.nodeBytes() << " bytes/node, "
+                  << static_cast<long long>(N / insertSeconds / 1e3) << "K insert/s, "
+                  << static_cast<long long>(LOOKUPS / searchSeconds / 1e3) << "K search/s, "
+                  << static_cast<long long>(N / 2 / deleteSeconds / 1e3) << "K delete/s, iterate "
+                  << static_cast<long long>(iterateMs) << " ms  (" << hits << " hits, " << sum % 1000 << ")\n";
+    };
+
+    std::cout << "=== CompactScapeGoatTree node features, " << N << " random int keys ===\n\n";
+    run.template operator()<NodeFeatures<true, true>>("parent + size: ");
+    run.template operator()<NodeFeatures<false, true>>("size only:     ");
+    run.template operator()<NodeFeatures<true, false>>("parent only:   ");
+    run.template operator()<NodeFeatures<false, false>>("neither:       ");
+    std::cout << "\n";
+}
+
+void benchmark_batch_lookup() {
+    constexpr int N = 2000000;
+    constexpr int LOOKUPS = 1 << 21;
+    std::mt19937 rng(25);
+    ScapeGoatTree<int> tree;
+    for (int i = 0; i < N; ++i) tree.insert(static_cast<int>(rng() >> 1));
+    std::vector<int> probes(LOOKUPS);
+    for (int& p : probes) p = static_cast<int>(rng() >> 1);
+    std::vector<char> found(LOOKUPS);
+    std::vector<int> successors(LOOKUPS);
+    bool* hit = reinterpret_cast<bool*>(found.data());
+    using Clock = std::chrono::high_resolution_clock;
+    auto rate = [](const Clock::time_point start) {
+        return static_cast<long long>(LOOKUPS / std::chrono::duration<double>(Clock::now() - start).count() / 1e3);
+    };
+
+    std::cout << "=== Batched lookups, " << N << " random int keys ===\n\n";
+    long long hits = 0;
+    auto start = Clock::now();
+    for (const int p : probes) hits += tree.search(p);
+    std::cout << "  search() loop:       " << rate(start) << "K lookups/s\n";
+    long long sum = 0;
+    start = Clock::now();
+    for (const int p : probes) {
+        try { sum += tree.getSuccessor(p); } catch (const std::runtime_error&) {}
+    }
+    std::cout << "  getSuccessor() loop: " << rate(start) << "K lookups/s\n";
+    int mismatches = 0;
+    // sharing only pays once a batch is dense enough to share the lower levels
+    for (const int batch : {256, 4096, 65536}) {
+        std::vector<int> sorted = probes;
+        for (int b = 0; b < LOOKUPS; b += batch) std::sort(sorted.begin() + b, sorted.begin() + b + batch);
+        start = Clock::now();
+        for (int b = 0; b < LOOKUPS; b += batch) tree.searchBatch(probes.data() + b, batch, hit + b);
+        const long long unsortedRate = rate(start);
+        mismatches += std::count(found.begin(), found.end(), 1) != hits;
+        start = Clock::now();
+        for (int b = 0; b < LOOKUPS; b += batch) tree.searchBatch(sorted.data() + b, batch, hit + b);
+        const long long sortedRate = rate(start);
+        start = Clock::now();
+        for (int b = 0; b < LOOKUPS; b += batch) tree.successorBatch(sorted.data() + b, batch, successors.data() + b, hit + b);
+        const long long successorRate = rate(start);
+        long long batchSum = 0;
+        for (int i = 0; i < LOOKUPS; ++i) if (found[i]) batchSum += successors[i];
+        mismatches += batchSum != sum;
+        std::cout << "  batches of " << batch << ": searchBatch " << unsortedRate << "K/s unsorted, "
+                  << sortedRate << "K/s presorted; successorBatch " << successorRate << "K/s\n";
+    }
+    std::cout << "  (" << mismatches << " mismatches against the loops)\n\n";
+}
+
+void benchmark_sharded() {
+    constexpr int THREADS = 4;
+    constexpr int PER_THREAD = 250000;
+    auto keyOf = [](unsigned int& seed) {
+        seed = seed * 1103515245u + 12345u;
+        return static_cast<int>(seed >> 1);
+    };
+    auto timeThreads = [](auto&& work) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t) threads.emplace_back(work, t);
+        for (auto& thread : threads) thread.join();
+        const auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    };
+
+    ScapeGoatTree<int> single;
+    std::mutex singleLock;
+    const auto mutexMs = timeThreads([&](const int t) {
+        unsigned int seed = t + 1;
+        for (int i = 0; i < PER_THREAD; ++i) {
+            const int key = keyOf(seed);
+            std::lock_guard guard(singleLock);
+            single.insert(key);
+        }
+    });
+
+    ShardedScapeGoatTree<int> sharded(THREADS * 2);
+    const auto shardedMs = timeThreads([&](const int t) {
+        unsigned int seed = t + 1;
+        for (int i = 0; i < PER_THREAD; ++i) sharded.insert(keyOf(seed));
+    });
+
+    // one large batch: routed to every shard and inserted in parallel
+    Vector<int> batch;
+    unsigned int seed = 77;
+    for (int i = 0; i < THREADS * PER_THREAD; ++i) batch.push_back(keyOf(seed));
+    ScapeGoatTree<int> batchSingle;
+    auto start = std::chrono::high_resolution_clock::now();
+    batchSingle.insertBatch(batch);
+    auto end = std::chrono::high_resolution_clock::now();
+    const auto batchSingleMs = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    ShardedScapeGoatTree<int> batchSharded(THREADS * 2, 1);
+    for (int i = 1; i < THREADS * 2; ++i) batchSharded.insert(i * (std::numeric_limits<int>::max() / (THREADS * 2)));
+    start = std::chrono::high_resolution_clock::now();
+    batchSharded.insertBatch(batch);
+    end = std::chrono::high_resolution_clock::now();
+    const auto batchShardedMs = std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+
+    std::cout << "=== Sharded tree, " << THREADS << " writer threads (" << std::thread::hardware_concurrency()
+              << " hardware threads) ===\n\n";
+    std::cout << "  mutex around one tree: " << mutexMs << " ms\n";
+    std::cout << "  sharded (" << sharded.shardCount() << " shards):    " << shardedMs << " ms\n";
+    std::cout << "  1M-key insertBatch, one tree: " << batchSingleMs << " ms\n";
+    std::cout << "  1M-key insertBatch, sharded:  " << batchShardedMs << " ms\n\n";
+}
+
+void benchmark_rcu_readers() {
+    constexpr int THREADS = 4;
+    constexpr int OPS = 300000;   // per thread
+    constexpr int READS_PER_WRITE = 50;
+    constexpr int N = 200000;
+    auto run = [](auto&& read, auto&& write) {
+        const auto start = std::chrono::high_resolution_clock::now();
+        std::vector<std::thread> threads;
+        for (int t = 0; t < THREADS; ++t) {
+            threads.emplace_back([&, t] {
+                unsigned int seed = t + 1;
+                for (int i = 0; i < OPS; ++i) {
+                    seed = seed * 1103515245u + 12345u;
+                    const int key = static_cast<int>((seed >> 1) % (2 * N));
+                    if (i % (READS_PER_WRITE + 1) == 0) write(key);
+                    else read(key);
+                }
+            });
+        }
+        for (auto& thread : threads) thread.join();
+        const auto end = std::chrono::high_resolution_clock::now();
+        return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+    };
+
+    ScapeGoatTree<int> locked;
+    std::mutex lock;
+    for (int i = 0; i < N; ++i) locked.insert(i * 2);
+    std::atomic<long> found{0};
+    const auto mutexMs = run(
+        [&](const int key) {
+            std::lock_guard guard(lock);
+            found += locked.search(key);
+        },
+        [&](const int key) {
+            std::lock_guard guard(lock);
+            if (key & 1) locked.insert(key);
+            else locked.deleteValue(key);
+        });
+
+    RcuScapeGoatTree<int> rcu;
+    Vector<int> initial;
+    for (int i = 0; i < N; ++i) initial.push_back(i * 2);
+    rcu.insertBatch(initial);
+    const auto rcuMs = run(
+        [&](const int key) { found += rcu.search(key); },
+        [&](const int key) {
+            if (key & 1) rcu.insert(key);
+            else rcu.deleteValue(key);
+        });
+
+    std::cout << "=== " << READS_PER_WRITE << ":1 reads:writes, " << THREADS << " threads ("
+              << std::thread::hardware_concurrency() << " hardware threads) ===\n\n";
+    std::cout << "  mutex around the tree: " << mutexMs << " ms\n";
+    std::cout << "  RCU readers:           " << rcuMs << " ms (" << found.load() << " hits)\n\n";
+}
+
+void benchmark_flat_combining() {
+    constexpr int OPS = 200000; // per thread
+    constexpr int RANGE = 1 << 20;
+    std::cout << "=== Write-heavy threads: flat combining vs mutex (" << std::thread::hardware_concurrency()
+              << " hardware threads) ===\n\n";
+    for (const int threads : {2, 4, 8}) {
+        // 45% insert, 45% delete, 10% search on random keys
+        auto run = [threads](auto&& apply) {
+            const auto start = std::chrono::high_resolution_clock::now();
+            std::vector<std::thread> workers;
+            for (int t = 0; t < threads; ++t) {
+                workers.emplace_back([&apply, t] {
+                    unsigned int seed = t * 7919 + 1;
+                    for (int i = 0; i < OPS; ++i) {
+                        seed = seed * 1103515245u + 12345u;
+                        const int key = static_cast<int>((seed >> 8) % RANGE);
+                        apply(seed % 20, key);
+                    }
+                });
+            }
+            for (auto& worker : workers) worker.join();
+            const auto end = std::chrono::high_resolution_clock::now();
+            return std::chrono::duration_cast<std::chrono::milliseconds>(end - start).count();
+        };
+
+        ScapeGoatTree<int> locked;
+        std::mutex lock;
+        const auto mutexMs = run([&](const unsigned int dice, const int key) {
+            std::lock_guard guard(lock);
+            if (dice < 9) locked.insert(key);
+            else if (dice < 18) locked.deleteValue(key);
+            else (void)locked.search(key);
+        });
+
+        ConcurrentScapeGoatTree<int> combined;
+        const auto combinedMs = run([&](const unsigned int dice, const int key) {
+            if (dice < 9) combined.insert(key);
+            else if (dice < 18) combined.deleteValue(key);
+            else (void)combined.search(key);
+        });
+        const CombiningStats stats = combined.combiningStats();
+
+        std::cout << "  " << threads << " threads: mutex " << mutexMs << " ms, flat combining " << combinedMs
+                  << " ms (" << static_cast<double>(stats.requests) / stats.passes << " requests per pass)\n";
+    }
+    std::cout << "\n";
+}
+
 int main() {
     benchmark_sequential_ops();
+    benchmark_node_pool();
+    benchmark_hot_paths();
+    benchmark_bulk_load();
+    benchmark_insert_batch();
+    benchmark_delete_batch();
+    benchmark_set_algebra();
+    benchmark_split_join();
+    benchmark_copy();
+    benchmark_snapshot();
+    benchmark_background_rebuild();
+    benchmark_latency_percentiles();
+    benchmark_parallel_rebuild();
+    benchmark_parallel_bulk_load();
+    benchmark_parallel_range();
+    benchmark_task_pool();
+    benchmark_frozen_set();
+    benchmark_compact();
+    benchmark_compact_storage();
+    benchmark_node_features();
+    benchmark_batch_lookup();
+    benchmark_sharded();
+    benchmark_rcu_readers();
+    benchmark_flat_combining();
     return 0;
 }
\ No newline at end of file
@@ -1,71 +1,181 @@
 #include <pybind11/pybind11.h>
 #include <pybind11/operators.h> // <--- NEEDED FOR + and ==
 #include <pybind11/stl.h>
+#include <pybind11/numpy.h>
 #include "scapegoat_tree.hpp"
+#include "compact_scapegoat_tree.hpp"
 
 namespace py = pybind11;
 typedef long long Type;
+// The Python tree keeps subtree sums so SuminRange answers in O(log n)
+using PyTree = ScapeGoatTree<Type, SumAggregate<Type>>;
+using PyNode = Node<Type, SumAggregate<Type>>;
+// Same tree with 32-bit index links in one node array, for memory-bound sets
+using PyCompactTree = CompactScapeGoatTree<Type, SumAggregate<Type>>;
 /**
  * Pybind11 module for exposing the ScapeGoatTree implementation to Python.
  */
 PYBIND11_MODULE(scapegoat_tree_py, m) {
     // 1. Bind Node
-    py::class_<Node<Type>>(m, "Node")   // node class
-        .def_readonly("value", &Node<Type>::value)
-        .def_readonly("left", &Node<Type>::left)
-        .def_readonly("right", &Node<Type>::right);
+    py::class_<PyNode>(m, "Node")   // node class
+        .def_readonly("value", &PyNode::value)
+        .def_readonly("left", &PyNode::left)
+        .def_readonly("right", &PyNode::right);
 
-    // 2. Bind ScapeGoatTree
-    py::class_<ScapeGoatTree<Type>>(m, "ScapeGoatTree")
+    // 2. Bind read-only snapshots (they stay valid while the tree keeps changing)
+    py::class_<PyTree::Snapshot>(m, "Snapshot")
+        .def("search", &PyTree::Snapshot::search)
+        .def("sum_in_range", &PyTree::Snapshot::sumInRange)
+        .def("kth_smallest", &PyTree::Snapshot::kthSmallest)
+        .def("__len__", &PyTree::Snapshot::size)
+        .def("__iter__", [](const PyTree::Snapshot &s) {
+            return py::make_iterator(s.begin(), s.end());
+        }, py::keep_alive<0, 1>());
+
+    // 3. Bind ScapeGoatTree
+    py::class_<PyTree>(m, "ScapeGoatTree")
         .def(py::init<>())
-        .def(py::init<const ScapeGoatTree<Type>&>()) // Copy constructor
+        .def(py::init<const PyTree&>()) // Copy constructor
+        .def(py::init([](const std::vector<Type> &values) { // O(n) bulk build from an unsorted list
+            return PyTree(values.begin(), values.end());
+        }), py::arg("values"))
+        .def_static("from_sorted", [](const std::vector<Type> &values) {
+            return PyTree::fromSorted(values.begin(), values.end());
+        }, py::arg("values"))
+        .def_static("from_unsorted", [](const std::vector<Type> &values, int threads) {
+            return PyTree::fromUnsorted(values.begin(), values.end(), threads);
+        }, py::arg("values"), py::arg("threads"), py::call_guard<py::gil_scoped_release>()) // parallel sort + dedupe + build
+        .def("set_rebuild_threads", &PyTree::setRebuildThreads, py::arg("threads")) // also used by assign/insert_batch
+        .def("get_rebuild_threads", &PyTree::getRebuildThreads)
+        .def("assign_sorted", [](PyTree &self, const std::vector<Type> &values, bool record_undo) {
+            self.assignSorted(values.begin(), values.end(), record_undo);
+        }, py::arg("values"), py::arg("record_undo") = true)
+        .def("assign", [](PyTree &self, const std::vector<Type> &values, bool record_undo) {
+            self.assign(values.begin(), values.end(), record_undo);
+        }, py::arg("values"), py::arg("record_undo") = true)
 
         // standard ops
-        .def("insert", &ScapeGoatTree<Type>::insert)
-    .def("insert_batch", [](ScapeGoatTree<Type> &self, const std::vector<Type> &values) { // makes an insert batch method that takes, a vector as a parameter
+        .def("insert", &PyTree::insert)
+    .def("insert_batch", [](PyTree &self, const std::vector<Type> &values) { // makes an insert batch method that takes, a vector as a parameter
             Vector<Type> customVec; // custom vector (Vector.hpp)
             for (const auto &v : values) customVec.push_back(v); //copy values from STL vector to our custom Vector.
             self.insertBatch(customVec);
         }, py::arg("values"))
-        .def("delete_batch", [](ScapeGoatTree<Type> &self, const std::vector<Type> &values) {
+        .def("delete_batch", [](PyTree &self, const std::vector<Type> &values) {
             Vector<Type> customVec;
             for (const auto &v : values) customVec.push_back(v);
             self.deleteBatch(customVec);
         }, py::arg("values"))
-        .def("delete_value", &ScapeGoatTree<Type>::deleteValue)
-        .def("search_node", [](const ScapeGoatTree<Type>& t, Type val) -> Node<Type>* {
+        .def("delete_value", &PyTree::deleteValue)
+        .def("search_node", [](const PyTree& t, Type val) -> PyNode* {
 return t.find_node(val);   // call the Node* version
 })
-        .def("search_bool", [](const ScapeGoatTree<Type>& t, Type val) -> bool {
+        .def("search_bool", [](const PyTree& t, Type val) -> bool {
 return t.search(val);   // call the bool version
 })
+        .def("search_many", [](const PyTree& t, const py::array_t<Type, py::array::c_style | py::array::forcecast>& keys) {
+            const auto m = static_cast<int>(keys.size());
+            py::array_t<bool> found(m);
+            t.searchBatch(keys.data(), m, found.mutable_data()); // one shared descent for the whole array
+            return found;
+        }, py::arg("keys"))
 
-        .def("get_root", &ScapeGoatTree<Type>::getRoot, py::return_value_policy::reference_internal)
-        .def("clear", &ScapeGoatTree<Type>::clear)
-        .def("undo", &ScapeGoatTree<Type>::undo)
-        .def("redo", &ScapeGoatTree<Type>::redo)
-        .def("SuminRange",&ScapeGoatTree<Type>::sumInRange)
-        .def("ValuesInRange", &ScapeGoatTree<Type>::valuesInRange)
-        .def("KthSmallest", &ScapeGoatTree<Type>::kthSmallest)
-        .def("GetSuccessor", &ScapeGoatTree<Type>::getSuccessor)
-        .def("GetMin", &ScapeGoatTree<Type>::getMin)
-        .def("GetMax", &ScapeGoatTree<Type>::getMax)
-        .def("Split",&ScapeGoatTree<Type>::split)
-         .def("SetAlpha", &ScapeGoatTree<Type>::changeAlpha)
+        .def("get_root", &PyTree::getRoot, py::return_value_policy::reference_internal)
+        .def("clear", &PyTree::clear)
+        .def("undo", &PyTree::undo)
+        .def("redo", &PyTree::redo)
+        .def("SuminRange",&PyTree::sumInRange)
+        .def("ValuesInRange", &PyTree::valuesInRange)
+        .def("KthSmallest", &PyTree::kthSmallest)
+        .def("GetSuccessor", &PyTree::getSuccessor)
+        .def("GetMin", &PyTree::getMin)
+        .def("GetMax", &PyTree::getMax)
+        .def("snapshot", &PyTree::snapshot)
+        .def("Split",&PyTree::split) // empties the tree: (keys < value, keys >= value)
+        .def_static("join", [](PyTree &left, PyTree &right) { // empties both inputs
+            return PyTree::join(std::move(left), std::move(right));
+        }, py::arg("left"), py::arg("right"))
+         .def("SetAlpha", &PyTree::changeAlpha)
         .def(py::self + py::self)
+        .def("intersect", &PyTree::intersect, py::arg("other"))
+        .def("difference", &PyTree::difference, py::arg("other"))
+        .def("symmetric_difference", &PyTree::symmetricDifference, py::arg("other"))
+        .def("is_subset_of", &PyTree::isSubsetOf, py::arg("other"))
+        .def("is_disjoint", &PyTree::isDisjoint, py::arg("other"))
+        .def("union_with", [](PyTree &self, PyTree &other) { // steals other's nodes, other ends up empty
+            self.unionWith(std::move(other));
+        }, py::arg("other"))
         .def(py::self == py::self)
 
 
-        .def("is_empty", [](const ScapeGoatTree<Type>& t) {
+        .def("is_empty", [](const PyTree& t) {
             return !t;
         })
 
         // Reporting & Displays
-        .def("get_balance_report", &ScapeGoatTree<Type>::isBalanced)
-        .def("get_inorder", [](ScapeGoatTree<Type> &t) { return t.displayInOrder(); })
-        .def("get_preorder", [](ScapeGoatTree<Type> &t) { return t.displayPreOrder(); })
-        .def("get_postorder", [](ScapeGoatTree<Type> &t) { return t.displayPostOrder(); })
-        .def("get_levels", &ScapeGoatTree<Type>::displayLevels);
+        .def("get_balance_report", &PyTree::isBalanced)
+        .def("get_inorder", [](PyTree &t) { return t.displayInOrder(); })
+        .def("get_preorder", [](PyTree &t) { return t.displayPreOrder(); })
+        .def("get_postorder", [](PyTree &t) { return t.displayPostOrder(); })
+        .def("get_levels", &PyTree::displayLevels);
+
 
+    // 4. Bind CompactScapeGoatTree: the same methods, minus the ones that hand
+    // out nodes or snapshots (its nodes move when the array grows)
+    py::class_<PyCompactTree>(m, "CompactScapeGoatTree")
+        .def(py::init<>())
+        .def(py::init<const PyCompactTree&>())
+        .def(py::init([](const std::vector<Type> &values) {
+            return PyCompactTree(values.begin(), values.end());
+        }), py::arg("values"))
+        .def_static("from_sorted", [](const std::vector<Type> &values) {
+            return PyCompactTree::fromSorted(values.begin(), values.end());
+        }, py::arg("values"))
+        .def("assign_sorted", [](PyCompactTree &self, const std::vector<Type> &values, bool record_undo) {
+            self.assignSorted(values.begin(), values.end(), record_undo);
+        }, py::arg("values"), py::arg("record_undo") = true)
+        .def("assign", [](PyCompactTree &self, const std::vector<Type> &values, bool record_undo) {
+            self.assign(values.begin(), values.end(), record_undo);
+        }, py::arg("values"), py::arg("record_undo") = true)
+        .def("insert", &PyCompactTree::insert)
+        .def("insert_batch", [](PyCompactTree &self, const std::vector<Type> &values) {
+            Vector<Type> customVec;
+            for (const auto &v : values) customVec.push_back(v);
+            self.insertBatch(customVec);
+        }, py::arg("values"))
+        .def("delete_batch", [](PyCompactTree &self, const std::vector<Type> &values) {
+            Vector<Type> customVec;
+            for (const auto &v : values) customVec.push_back(v);
+            self.deleteBatch(customVec);
+        }, py::arg("values"))
+        .def("delete_value", &PyCompactTree::deleteValue)
+        .def("search_bool", [](const PyCompactTree& t, Type val) -> bool {
+            return t.search(val);
+        })
+        .def("clear", &PyCompactTree::clear)
+        .def("undo", &PyCompactTree::undo)
+        .def("redo", &PyCompactTree::redo)
+        .def("SuminRange", &PyCompactTree::sumInRange)
+        .def("ValuesInRange", &PyCompactTree::valuesInRange)
+        .def("KthSmallest", &PyCompactTree::kthSmallest)
+        .def("GetSuccessor", &PyCompactTree::getSuccessor)
+        .def("GetMin", &PyCompactTree::getMin)
+        .def("GetMax", &PyCompactTree::getMax)
+        .def("SetAlpha", &PyCompactTree::changeAlpha)
+        .def(py::self + py::self)
+        .def(py::self == py::self)
+        .def("is_empty", [](const PyCompactTree& t) {
+            return !t;
+        })
+        .def("__iter__", [](PyCompactTree &t) {
+            return py::make_iterator(t.begin(), PyCompactTree::end());
+        }, py::keep_alive<0, 1>())
+        .def("shrink_to_fit", &PyCompactTree::shrink_to_fit)
+        .def("memory_usage", &PyCompactTree::memoryUsage)
+        .def("get_balance_report", &PyCompactTree::isBalanced)
+        .def("get_inorder", [](PyCompactTree &t) { return t.displayInOrder(); })
+        .def("get_preorder", [](PyCompactTree &t) { return t.displayPreOrder(); })
+        .def("get_postorder", [](PyCompactTree &t) { return t.displayPostOrder(); })
+        .def("get_levels", &PyCompactTree::displayLevels);
 
 }
\ No newline at end of file
@@ -0,0 +1,296 @@
+/**
+ * ScapeGoatTree with its nodes in one contiguous array and 32-bit links.
+ *
+ * A node refers to its children and parent by slot index instead of by
+ * pointer, so an int key costs 20 bytes (see CompactNode) instead of 40. The
+ * array is the allocator: a new node takes a slot from the free list or the
+ * end of the array, which doubles when full. Links are indices, so growing it
+ * moves the nodes without fixing anything up. Slot 0 means "no node". The
+ * links could address 2^32 - 2 nodes; size() and ranks are ints, as in
+ * ScapeGoatTree, so a tree holds up to INT_MAX keys.
+ *
+ * Insert/delete, rebuilds, batches, undo/redo, bulk loads, the range and
+ * order-statistic queries and the iterator work exactly as in ScapeGoatTree:
+ * the same operations give the same tree shape.
+ *
+ * Features (see NodeFeatures in Node.hpp) drops the parent link, the subtree
+ * size or both from every node, down to 12 bytes for an int key. Shapes stay
+ * the same; operations that cannot do without a field do not compile. Snapshots, split/join, set
+ * algebra and the parallel/background rebuild modes need node pointers that
+ * stay put, and are left to ScapeGoatTree.
+ */
+#ifndef SCAPEGOATPROJECT_COMPACT_SCAPEGOAT_TREE_HPP
+#define SCAPEGOATPROJECT_COMPACT_SCAPEGOAT_TREE_HPP
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <limits>
+#include <string>
+#include "scapegoat_tree.hpp"
+
+template<typename T, typename Aggregate = NoAggregate, typename Features = NodeFeatures<>>
+class CompactScapeGoatTree {
+    using Index = std::uint32_t;
+    using TreeNode = CompactNode<T, Aggregate, Features>;
+    /**
+     * The pointer-linked tree, whose layout-independent helpers this one reuses.
+     */
+    using Linked = ScapeGoatTree<T, Aggregate>;
+    static constexpr bool hasAggregate = !std::is_same_v<Aggregate, NoAggregate>;
+    static constexpr Index NIL = 0;
+    static constexpr Index MAX_NODES = std::numeric_limits<int>::max();
+    static constexpr Index FIRST_CAPACITY = 64;
+
+    /**
+     * nodes[1..used] have been constructed; freed ones keep a default value
+     * and are chained through left, starting at freeList. nodes[0] is never built.
+     */
+    TreeNode* nodes{};
+    Index capacity = 0;
+    Index used = 0;
+    Index freeList = NIL;
+    Index freeCount = 0;
+    Index root = NIL;
+    int nNodes{};
+    int rebuildCount = 0;
+    int max_nodes = 0;
+    double ALPHA = 2.0/3.0;
+    double batchRebuildRatio = 0.05;
+    Stack<Command<T>> undoStack;
+    Stack<Command<T>> redoStack;
+    bool isUndoing = false;
+    /**
+     * Scratch buffer holding the current descent path, as in ScapeGoatTree.
+     */
+    Vector<Index> path;
+
+    /**
+     * Moves the nodes into an array of at least n slots.
+     */
+    void grow(std::size_t n);
+    /**
+     * Builds a node in a free slot (or a new one at the end) and returns its slot.
+     */
+    template<typename V>
+    Index makeNode(V&& value, Index parent);
+    /**
+     * Puts a slot back on the free list; its value is reset so it holds no resources.
+     */
+    void freeNode(Index node);
+    /**
+     * Destroys every slot and frees the array.
+     */
+    void releaseNodes();
+    [[nodiscard]] Index countN(const Index node) const { return node ? nodes[node].size : 0; }
+    /**
+     * Subtree size by walking it, for trees that do not store sizes.
+     */
+    [[nodiscard]] Index countNodes(Index node) const;
+    [[nodiscard]] int findH(Index node) const;
+    [[nodiscard]] int getThreshold() const {return static_cast<int>(log(nNodes) / log(1/ALPHA));}
+    /**
+     * Index in path of the deepest node that is not alpha-weight-balanced
+     * once the new node hangs below path[depth - 1], or -1. Without stored
+     * sizes they are summed up the path, counting each sibling subtree.
+     */
+    [[nodiscard]] int findTraitor(int depth) const;
+    int descend(const T& value);
+    void attach(Index node, int depth);
+    void restructure_subtree(int depth);
+    void DeletionRebuild();
+    /**
+     * Relinks the subtree's own slots into a balanced shape; nothing moves.
+     */
+    Index rebuildSubtree(Index node, Index parent_node);
+    /**
+     * Points node's parent link at parent, if nodes have one.
+     */
+    void setParent(Index node, Index parent);
+    /**
+     * Threads the subtree into an in-order list through right, as flattenNodes does.
+     */
+    Index flattenNodes(Index node, Index head);
+    Index buildFromList(int n, Index& head, Index parent_node);
+    /**
+     * Links the n consecutive slots from first on (in key order) into a
+     * balanced subtree.
+     */
+    Index linkSlots(Index first, int n, Index parent_node);
+    /**
+     * Replaces the contents with the n sorted, distinct keys of array, placed
+     * in key order in slots 1..n.
+     */
+    void assignArray(T* array, int n, bool recordUndo);
+    void mergeBatch(const Vector<T>& values);
+    void subtractBatch(const Vector<T>& values);
+    void recordValues(Index node, OpType type);
+    void inorderTraversal(Index node, int& i, T* array) const;
+    /**
+     * Numbers the subtree's slots in key order from next + 1 on (for shrink_to_fit).
+     */
+    void numberSlots(Index node, Index& next, Index* slotOf) const;
+
+    void pull(Index node);
+    [[nodiscard]] auto aggOf(Index node) const;
+    [[nodiscard]] auto suffixAggregate(Index node, const T& min) const;
+    [[nodiscard]] auto prefixAggregate(Index node, const T& max) const;
+    [[nodiscard]] auto aggregateHelper(Index node, const T& min, const T& max) const;
+    template<typename Op>
+    void foldHelper(Index node, const T& min, const T& max, typename Op::value_type& acc) const;
+    T sumHelper(Index node, T min, T max) const;
+    void rangeHelper(Index node, T min, T max, Vector<T>& range) const;
+    T kthSmallestHelper(Index node, int k) const;
+    [[nodiscard]] Index findSuccessor(Index node) const;
+    bool areTreesEqual(const CompactScapeGoatTree& other, Index n1, Index n2) const;
+
+    void displayPreOrder(Index node, std::ostream& os) const;
+    void displayInOrder(Index node, std::ostream& os) const;
+    void displayPostOrder(Index node, std::ostream& os) const;
+
+public:
+    /**
+     * In-order iterator; a slot index plus the tree, so it survives the array
+     * growing. Without parent links it keeps its own stack of ancestors.
+     */
+    class iterator {
+        friend class CompactScapeGoatTree;
+        struct NoAncestors {};
+        CompactScapeGoatTree* tree;
+        Index curr;
+        std::conditional_t<Features::parent, NoAncestors, Stack<Index>> ancestors;
+        void descendLeft(Index node) {
+            while (node) {
+                ancestors.push(node);
+                node = tree->nodes[node].left;
+            }
+            curr = ancestors.isEmpty() ? NIL : ancestors.pop();
+        }
+
+    public:
+        iterator(CompactScapeGoatTree* owner, const Index node) : tree(owner), curr(node) {}
+        T& operator*() { return tree->nodes[curr].value; }
+        iterator& operator++() {
+            if constexpr (Features::parent) curr = tree->findSuccessor(curr);
+            else descendLeft(tree->nodes[curr].right);
+            return *this;
+        }
+        iterator operator++(int) {
+            iterator temp = *this;
+            ++(*this);
+            return temp;
+        }
+        bool operator!=(const iterator& other) const { return curr != other.curr; }
+        bool operator==(const iterator& other) const { return curr == other.curr; }
+    };
+
+    CompactScapeGoatTree() = default;
+    CompactScapeGoatTree(double alpha);
+    /**
+     * Builds a balanced tree from an unsorted range: sort + dedupe + O(n) build.
+     */
+    template<std::forward_iterator It>
+    CompactScapeGoatTree(It first, It last);
+    /**
+     * Builds a balanced tree from a sorted range in O(n).
+     * Duplicates are dropped; throws std::invalid_argument if the range is not sorted.
+     */
+    template<std::forward_iterator It>
+    static CompactScapeGoatTree fromSorted(It first, It last);
+    /**
+     * Copies the node array slot for slot: same shape, one allocation.
+     * Settings and counters are kept; the undo history is not.
+     */
+    CompactScapeGoatTree(const CompactScapeGoatTree& other);
+    CompactScapeGoatTree(CompactScapeGoatTree&& other) noexcept;
+    CompactScapeGoatTree& operator=(const CompactScapeGoatTree& other);
+    CompactScapeGoatTree& operator=(CompactScapeGoatTree&& other) noexcept;
+    ~CompactScapeGoatTree() { releaseNodes(); }
+
+    /**
+     * Replaces the contents with a sorted range in O(n).
+     * With recordUndo the swap is one undoable batch; without it the undo/redo history is cleared.
+     * Throws std::invalid_argument if the range is not sorted; use assign for unsorted input.
+     */
+    template<std::forward_iterator It>
+    void assignSorted(It first, It last, bool recordUndo = true);
+    /**
+     * Replaces the contents with an unsorted range (sorted and deduplicated first).
+     */
+    template<std::forward_iterator It>
+    void assign(It first, It last, bool recordUndo = true);
+
+    void insert(T value);
+    /**
+     * Large batches (see setBatchRebuildRatio) are merged in with a single rebuild.
+     */
+    void insertBatch(const Vector<T>& values);
+    bool deleteValue(T value);
+    void deleteBatch(const Vector<T>& values);
+    void setBatchRebuildRatio(const double ratio) { if (ratio >= 0) batchRebuildRatio = ratio; }
+    [[nodiscard]] double getBatchRebuildRatio() const { return batchRebuildRatio; }
+
+    [[nodiscard]] bool search(const T& key) const;
+    [[nodiscard]] int size() const { return nNodes; }
+    void clear();
+    void undo();
+    void redo();
+    /**
+     * Sum of the keys in [min, max]: O(log n) with SumAggregate, O(k) otherwise.
+     */
+    T sumInRange(T min, T max) const;
+    template<typename Op = Aggregate>
+    typename Op::value_type aggregateInRange(const T& min, const T& max) const;
+    T getMin();
+    T getMax();
+    Vector<T> valuesInRange(T min, T max);
+    T getSuccessor(T value) const;
+    /**
+     * Needs subtree sizes.
+     */
+    T kthSmallest(int k) const;
+    void changeAlpha(const double alpha){if (alpha > 1 or alpha < 0.5)return; ALPHA=alpha;}
+
+    /**
+     * Makes room for n more nodes without growing the array.
+     */
+    void reserve(std::size_t n);
+    /**
+     * Moves the nodes into an array of exactly size() slots, in key order,
+     * keeping the shape. Needs a temporary 4-byte index per slot.
+     */
+    void shrink_to_fit();
+    /**
+     * Bytes held by the node array.
+     */
+    [[nodiscard]] std::size_t memoryUsage() const { return capacity ? (capacity + 1) * sizeof(TreeNode) : 0; }
+    [[nodiscard]] static constexpr std::size_t nodeBytes() { return sizeof(TreeNode); }
+    [[nodiscard]] std::string isBalanced() const;
+
+    iterator begin();
+    static iterator end();
+
+    std::string displayPreOrder();
+    std::string displayInOrder();
+    std::string displayPostOrder();
+    std::string displayLevels();
+
+    bool operator[](T value) const;
+    /**
+     * Creates a new tree containing elements from both trees (linear merge).
+     */
+    CompactScapeGoatTree operator+(const CompactScapeGoatTree& other) const;
+    CompactScapeGoatTree& operator=(int value);
+    /**
+     * Checks if two trees have the same shape and keys.
+     */
+    bool operator==(const CompactScapeGoatTree& tree) const;
+    bool operator!=(const CompactScapeGoatTree& tree) const;
+    bool operator!() const;
+    void operator+(const T& value);
+    bool operator-(const T& value);
+    bool operator-=(const T& value);
+    void operator+=(const T& value);
+};
+#include "compact_scapegoat_tree.tpp"
+
+#endif //SCAPEGOATPROJECT_COMPACT_SCAPEGOAT_TREE_HPP
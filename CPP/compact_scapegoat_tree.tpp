@@ -0,0 +1,1059 @@
+#ifndef SCAPEGOATPROJECT_COMPACT_SCAPEGOAT_TREE_TPP
+#define SCAPEGOATPROJECT_COMPACT_SCAPEGOAT_TREE_TPP
+#include <algorithm>
+#include <cmath>
+#include <memory>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+#include "queue.hpp"
+
+// =====================
+// Node array
+// =====================
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::grow(std::size_t n) {
+    if (n > MAX_NODES) throw std::length_error("CompactScapeGoatTree is full");
+    n = std::max<std::size_t>({n, std::min<std::size_t>(2 * static_cast<std::size_t>(capacity), MAX_NODES), FIRST_CAPACITY});
+    auto* fresh = static_cast<TreeNode*>(::operator new((n + 1) * sizeof(TreeNode)));
+    if (nodes) {
+        std::uninitialized_move(nodes + 1, nodes + used + 1, fresh + 1);
+        std::destroy(nodes + 1, nodes + used + 1);
+        ::operator delete(nodes);
+    }
+    nodes = fresh;
+    capacity = static_cast<Index>(n);
+}
+
+template<typename T, typename Aggregate, typename Features>
+template<typename V>
+typename CompactScapeGoatTree<T, Aggregate, Features>::Index CompactScapeGoatTree<T, Aggregate, Features>::makeNode(V&& value, const Index parent) {
+    Index slot;
+    if (freeList) {
+        slot = freeList;
+        freeList = nodes[slot].left;
+        freeCount--;
+        nodes[slot].value = std::forward<V>(value);
+    } else {
+        if (used == capacity) grow(static_cast<std::size_t>(used) + 1);
+        slot = ++used;
+        ::new (static_cast<void*>(nodes + slot)) TreeNode(std::forward<V>(value));
+    }
+    TreeNode& node = nodes[slot];
+    node.left = node.right = NIL;
+    if constexpr (Features::size) node.size = 1;
+    setParent(slot, parent);
+    return slot;
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::setParent(const Index node, const Index parent) {
+    if constexpr (Features::parent) nodes[node].parent = parent;
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::freeNode(const Index node) {
+    if constexpr (!std::is_trivially_destructible_v<T>) nodes[node].value = T{};
+    nodes[node].left = freeList;
+    freeList = node;
+    freeCount++;
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::releaseNodes() {
+    if (nodes) {
+        std::destroy(nodes + 1, nodes + used + 1);
+        ::operator delete(nodes);
+    }
+    nodes = nullptr;
+    capacity = used = freeCount = 0;
+    freeList = root = NIL;
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::reserve(const std::size_t n) {
+    const std::size_t available = static_cast<std::size_t>(capacity - used) + freeCount;
+    if (available < n) grow(used + (n - available));
+}
+
+/**
+ * Live slots get their new number in slotOf, freed ones keep 0; links are
+ * then translated through it, so the shape stays as it was.
+ */
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::shrink_to_fit() {
+    if (!root) {
+        releaseNodes();
+        return;
+    }
+    if (capacity == static_cast<Index>(nNodes)) return;
+    auto* slotOf = new Index[used + 1]{};
+    Index next = 0;
+    numberSlots(root, next, slotOf);
+    auto* fresh = static_cast<TreeNode*>(::operator new((nNodes + 1) * sizeof(TreeNode)));
+    for (Index i = 1; i <= used; i++) {
+        if (!slotOf[i]) continue;
+        TreeNode& old = nodes[i];
+        auto* node = ::new (static_cast<void*>(fresh + slotOf[i])) TreeNode(std::move(old.value));
+        node->left = slotOf[old.left];
+        node->right = slotOf[old.right];
+        if constexpr (Features::parent) node->parent = slotOf[old.parent];
+        if constexpr (Features::size) node->size = old.size;
+        if constexpr (hasAggregate) node->agg = old.agg;
+    }
+    const Index newRoot = slotOf[root];
+    delete[] slotOf;
+    releaseNodes();
+    nodes = fresh;
+    capacity = used = static_cast<Index>(nNodes);
+    root = newRoot;
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::numberSlots(const Index node, Index& next, Index* slotOf) const {
+    if (!node) return;
+    numberSlots(nodes[node].left, next, slotOf);
+    slotOf[node] = ++next;
+    numberSlots(nodes[node].right, next, slotOf);
+}
+
+// =====================
+// Constructors
+// =====================
+
+template<typename T, typename Aggregate, typename Features>
+CompactScapeGoatTree<T, Aggregate, Features>::CompactScapeGoatTree(const double alpha) {
+    if (alpha > 1 or alpha < 0.5) return;
+    ALPHA = alpha;
+}
+
+template<typename T, typename Aggregate, typename Features>
+template<std::forward_iterator It>
+CompactScapeGoatTree<T, Aggregate, Features>::CompactScapeGoatTree(It first, It last) {
+    assign(first, last, false);
+}
+
+template<typename T, typename Aggregate, typename Features>
+template<std::forward_iterator It>
+CompactScapeGoatTree<T, Aggregate, Features> CompactScapeGoatTree<T, Aggregate, Features>::fromSorted(It first, It last) {
+    CompactScapeGoatTree tree;
+    tree.assignSorted(first, last, false);
+    return tree;
+}
+
+template<typename T, typename Aggregate, typename Features>
+CompactScapeGoatTree<T, Aggregate, Features>::CompactScapeGoatTree(const CompactScapeGoatTree& other)
+    : root(other.root),
+      nNodes(other.nNodes),
+      rebuildCount(other.rebuildCount),
+      max_nodes(other.max_nodes),
+      ALPHA(other.ALPHA),
+      batchRebuildRatio(other.batchRebuildRatio) {
+    if (!other.used) return;
+    nodes = static_cast<TreeNode*>(::operator new((other.used + 1) * sizeof(TreeNode)));
+    std::uninitialized_copy(other.nodes + 1, other.nodes + other.used + 1, nodes + 1);
+    capacity = used = other.used;
+    freeList = other.freeList;
+    freeCount = other.freeCount;
+}
+
+template<typename T, typename Aggregate, typename Features>
+CompactScapeGoatTree<T, Aggregate, Features>::CompactScapeGoatTree(CompactScapeGoatTree&& other) noexcept
+    : nodes(std::exchange(other.nodes, nullptr)),
+      capacity(std::exchange(other.capacity, 0)),
+      used(std::exchange(other.used, 0)),
+      freeList(std::exchange(other.freeList, NIL)),
+      freeCount(std::exchange(other.freeCount, 0)),
+      root(std::exchange(other.root, NIL)),
+      nNodes(std::exchange(other.nNodes, 0)),
+      rebuildCount(other.rebuildCount),
+      max_nodes(std::exchange(other.max_nodes, 0)),
+      ALPHA(other.ALPHA),
+      batchRebuildRatio(other.batchRebuildRatio) {}
+
+template<typename T, typename Aggregate, typename Features>
+CompactScapeGoatTree<T, Aggregate, Features>& CompactScapeGoatTree<T, Aggregate, Features>::operator=(const CompactScapeGoatTree& other) {
+    if (this == &other) return *this;
+    // the old history describes contents that are gone
+    undoStack.clear();
+    redoStack.clear();
+    CompactScapeGoatTree copy(other);
+    return *this = std::move(copy);
+}
+
+template<typename T, typename Aggregate, typename Features>
+CompactScapeGoatTree<T, Aggregate, Features>& CompactScapeGoatTree<T, Aggregate, Features>::operator=(CompactScapeGoatTree&& other) noexcept {
+    if (this == &other) return *this;
+    releaseNodes();
+    nodes = std::exchange(other.nodes, nullptr);
+    capacity = std::exchange(other.capacity, 0);
+    used = std::exchange(other.used, 0);
+    freeList = std::exchange(other.freeList, NIL);
+    freeCount = std::exchange(other.freeCount, 0);
+    root = std::exchange(other.root, NIL);
+    nNodes = std::exchange(other.nNodes, 0);
+    rebuildCount = other.rebuildCount;
+    max_nodes = std::exchange(other.max_nodes, 0);
+    ALPHA = other.ALPHA;
+    batchRebuildRatio = other.batchRebuildRatio;
+    return *this;
+}
+
+// =====================
+// Bulk construction
+// =====================
+
+/**
+ * The old array goes first, so the new one is allocated at exactly n slots.
+ */
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::assignArray(T* array, const int n, const bool recordUndo) {
+    if (recordUndo) {
+        // one batch: delete the old contents, insert the new ones
+        undoStack.push({OpType::BatchStart, T()});
+        recordValues(root, OpType::Delete);
+        for (int i = 0; i < n; i++) undoStack.push({OpType::Insert, array[i]});
+        undoStack.push({OpType::BatchEnd, T()});
+    } else {
+        undoStack.clear();
+        redoStack.clear();
+    }
+    releaseNodes();
+    nNodes = max_nodes = n;
+    if (n == 0) return;
+    grow(n);
+    for (int i = 0; i < n; i++) ::new (static_cast<void*>(nodes + i + 1)) TreeNode(std::move(array[i]));
+    used = static_cast<Index>(n);
+    root = linkSlots(1, n, NIL);
+}
+
+template<typename T, typename Aggregate, typename Features>
+template<std::forward_iterator It>
+void CompactScapeGoatTree<T, Aggregate, Features>::assignSorted(It first, It last, const bool recordUndo) {
+    if (!std::is_sorted(first, last)) throw std::invalid_argument("assignSorted needs a sorted range");
+    assign(first, last, recordUndo);
+}
+
+template<typename T, typename Aggregate, typename Features>
+template<std::forward_iterator It>
+void CompactScapeGoatTree<T, Aggregate, Features>::assign(It first, It last, const bool recordUndo) {
+    const int n = static_cast<int>(std::distance(first, last));
+    T* array = new T[n];
+    std::copy(first, last, array);
+    // sortUnique only sorts when the input turns out not to be sorted
+    assignArray(array, Linked::sortUnique(array, n), recordUndo);
+    delete[] array;
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::recordValues(const Index node, const OpType type) {
+    if (!node) return;
+    recordValues(nodes[node].left, type);
+    undoStack.push({type, nodes[node].value});
+    recordValues(nodes[node].right, type);
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::inorderTraversal(const Index node, int& i, T* array) const {
+    if (!node) return;
+    inorderTraversal(nodes[node].left, i, array);
+    array[i++] = nodes[node].value;
+    inorderTraversal(nodes[node].right, i, array);
+}
+
+// =====================
+// Rebuilds
+// =====================
+
+/**
+ * Splits like ScapeGoatTree::buildFromList (left half gets (n-1)/2 nodes),
+ * so both trees end up with the same shape.
+ */
+template<typename T, typename Aggregate, typename Features>
+typename CompactScapeGoatTree<T, Aggregate, Features>::Index CompactScapeGoatTree<T, Aggregate, Features>::linkSlots(const Index first, const int n, const Index parent_node) {
+    if (n <= 0) return NIL;
+    const int leftCount = (n - 1) / 2;
+    const Index node = first + leftCount;
+    setParent(node, parent_node);
+    if constexpr (Features::size) nodes[node].size = n;
+    nodes[node].left = linkSlots(first, leftCount, node);
+    nodes[node].right = linkSlots(node + 1, n - 1 - leftCount, node);
+    pull(node);
+    return node;
+}
+
+template<typename T, typename Aggregate, typename Features>
+typename CompactScapeGoatTree<T, Aggregate, Features>::Index CompactScapeGoatTree<T, Aggregate, Features>::flattenNodes(const Index node, const Index head) {
+    if (!node) return head;
+    nodes[node].right = flattenNodes(nodes[node].right, head); // everything after node
+    return flattenNodes(nodes[node].left, node);                // everything before node
+}
+
+template<typename T, typename Aggregate, typename Features>
+typename CompactScapeGoatTree<T, Aggregate, Features>::Index CompactScapeGoatTree<T, Aggregate, Features>::buildFromList(const int n, Index& head, const Index parent_node) {
+    if (n <= 0) return NIL;
+    const int leftCount = (n - 1) / 2;
+    const Index left = buildFromList(leftCount, head, NIL);
+    const Index node = head; // next node in order becomes the root
+    head = nodes[head].right;
+    nodes[node].left = left;
+    if (left) setParent(left, node);
+    setParent(node, parent_node);
+    nodes[node].right = buildFromList(n - 1 - leftCount, head, node);
+    if constexpr (Features::size) nodes[node].size = n;
+    pull(node);
+    return node;
+}
+
+template<typename T, typename Aggregate, typename Features>
+typename CompactScapeGoatTree<T, Aggregate, Features>::Index CompactScapeGoatTree<T, Aggregate, Features>::rebuildSubtree(const Index node, const Index parent_node) {
+    int n;
+    if constexpr (Features::size) n = static_cast<int>(nodes[node].size);
+    else n = static_cast<int>(countNodes(node));
+    Index head = flattenNodes(node, NIL);
+    return buildFromList(n, head, parent_node);
+}
+
+template<typename T, typename Aggregate, typename Features>
+int CompactScapeGoatTree<T, Aggregate, Features>::findH(const Index node) const {
+    if (!node) return -1;
+    return 1 + std::max(findH(nodes[node].left), findH(nodes[node].right));
+}
+
+template<typename T, typename Aggregate, typename Features>
+int CompactScapeGoatTree<T, Aggregate, Features>::findTraitor(const int depth) const {
+    if constexpr (Features::size) {
+        for (int i = depth - 1; i >= 0; i--) {
+            const TreeNode& node = nodes[path[i]];
+            const int left = countN(node.left);
+            const int right = countN(node.right);
+            const int size = node.size;
+
+            if (left > ALPHA * size || right > ALPHA * size)
+                return i;
+        }
+    } else {
+        // path[depth] is the new node, a subtree of one
+        int childSize = 1;
+        for (int i = depth - 1; i >= 0; i--) {
+            const TreeNode& node = nodes[path[i]];
+            const int sibling = static_cast<int>(countNodes(node.left == path[i + 1] ? node.right : node.left));
+            const int size = childSize + sibling + 1;
+
+            if (childSize > ALPHA * size || sibling > ALPHA * size)
+                return i;
+            childSize = size;
+        }
+    }
+    return -1;
+}
+
+template<typename T, typename Aggregate, typename Features>
+typename CompactScapeGoatTree<T, Aggregate, Features>::Index CompactScapeGoatTree<T, Aggregate, Features>::countNodes(const Index node) const {
+    if (!node) return 0;
+    return 1 + countNodes(nodes[node].left) + countNodes(nodes[node].right);
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::restructure_subtree(const int depth) {
+    const int g = findTraitor(depth);
+    if (g < 0) return;
+    const Index goat = path[g];
+    const Index parent = g > 0 ? path[g - 1] : NIL;
+    const bool wasLeft = parent && goat == nodes[parent].left;
+    const Index balanced = rebuildSubtree(goat, parent);
+    rebuildCount++;
+    if (!parent) root = balanced;
+    else if (wasLeft) nodes[parent].left = balanced;
+    else nodes[parent].right = balanced;
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::DeletionRebuild() {
+    if (nNodes < 0.5 * max_nodes && nNodes > 0) { // α = 0.5 for deletion
+        root = rebuildSubtree(root, NIL);
+        rebuildCount++;
+        max_nodes = nNodes;
+    }
+}
+
+// =====================
+// Insert / Delete
+// =====================
+
+template<typename T, typename Aggregate, typename Features>
+int CompactScapeGoatTree<T, Aggregate, Features>::descend(const T& value) {
+    path.clear();
+    Index current = root;
+    while (current) {
+        path.push_back(current);
+        const TreeNode& node = nodes[current];
+        if (value < node.value) current = node.left;
+        else if (value > node.value) current = node.right;
+        else return -1;
+    }
+    return static_cast<int>(path.size());
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::attach(const Index node, const int depth) {
+    if constexpr (Features::size) {
+        for (int i = 0; i < depth; i++) ++nodes[path[i]].size;
+    }
+
+    const Index parent = depth > 0 ? path[depth - 1] : NIL;
+    setParent(node, parent);
+    if (!parent)
+        root = node;
+    else if (nodes[node].value < nodes[parent].value)
+        nodes[parent].left = node;
+    else
+        nodes[parent].right = node;
+
+    if constexpr (hasAggregate) {
+        pull(node);
+        for (int i = depth - 1; i >= 0; i--) pull(path[i]);
+    }
+
+    nNodes++;
+    if (nNodes > max_nodes) max_nodes = nNodes;
+
+    if (depth + 1 <= getThreshold()) return;
+    path.push_back(node);
+    restructure_subtree(depth);
+}
+
+/**
+ * The path holds slots, not pointers, so makeNode may grow the array under it.
+ */
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::insert(T value) {
+    const int depth = descend(value);
+    if (depth < 0) return;
+    if (!isUndoing) undoStack.push({OpType::Insert, value});
+    attach(makeNode(std::move(value), NIL), depth);
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::insertBatch(const Vector<T>& values) {
+    if (!isUndoing) undoStack.push({OpType::BatchStart, T()});
+    if (values.size() > 0 && values.size() >= batchRebuildRatio * nNodes) {
+        mergeBatch(values);
+    } else {
+        for (unsigned int i = 0; i < values.size(); i++) insert(values[i]);
+    }
+    if (!isUndoing) undoStack.push({OpType::BatchEnd, T()});
+}
+
+/**
+ * Merges the sorted batch into the in-order slot list, then one rebuild.
+ * reserve() first, so the array grows at most once.
+ */
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::mergeBatch(const Vector<T>& values) {
+    int m = static_cast<int>(values.size());
+    T* batch = new T[m];
+    for (int i = 0; i < m; i++) batch[i] = values[i];
+    m = Linked::sortUnique(batch, m);
+    reserve(m);
+
+    Index list = flattenNodes(root, NIL);
+    Index head = NIL;
+    Index tail = NIL;
+    auto append = [&](const Index node) {
+        if (tail) nodes[tail].right = node;
+        else head = node;
+        tail = node;
+    };
+    int idx = 0, added = 0;
+    while (list || idx < m) {
+        if (list && (idx == m || nodes[list].value < batch[idx])) {
+            const Index next = nodes[list].right; // existing node comes first
+            append(list);
+            list = next;
+        } else {
+            if (list && !(batch[idx] < nodes[list].value)) { // duplicate, keep the existing node
+                const Index next = nodes[list].right;
+                append(list);
+                list = next;
+            } else {
+                if (!isUndoing) undoStack.push({OpType::Insert, batch[idx]});
+                append(makeNode(std::move(batch[idx]), NIL));
+                added++;
+            }
+            idx++;
+        }
+    }
+    if (tail) nodes[tail].right = NIL;
+
+    nNodes += added;
+    root = buildFromList(nNodes, head, NIL);
+    rebuildCount++;
+    max_nodes = nNodes;
+    delete[] batch;
+}
+
+template<typename T, typename Aggregate, typename Features>
+bool CompactScapeGoatTree<T, Aggregate, Features>::deleteValue(T value) {
+    path.clear();
+    Index node = root;
+    while (node && nodes[node].value != value) {
+        path.push_back(node);
+        node = value < nodes[node].value ? nodes[node].left : nodes[node].right;
+    }
+    if (!node) return false;
+
+    if (not isUndoing) undoStack.push({OpType::Delete, value});
+    const unsigned int ancestors = path.size();
+    const Index parent = ancestors ? path[ancestors - 1] : NIL;
+    TreeNode& gone = nodes[node];
+    Index replacement;
+
+    // Case 1 & 2: Leaf or one child, the child (if any) moves up
+    if (!gone.left || !gone.right) {
+        replacement = gone.left ? gone.left : gone.right;
+    }
+    // Case 3: Two children, the inorder successor is relinked into the node's place
+    else {
+        path.push_back(node);
+        Index suc = gone.right;
+        path.push_back(suc);
+        while (nodes[suc].left) {
+            suc = nodes[suc].left;
+            path.push_back(suc);
+        }
+        const Index sucParent = path[path.size() - 2];
+        if constexpr (Features::size) {
+            for (unsigned int i = ancestors + 1; i + 1 < path.size(); i++) --nodes[path[i]].size;
+        }
+        TreeNode& moved = nodes[suc];
+        if (sucParent == node) gone.right = moved.right;
+        else nodes[sucParent].left = moved.right;
+        if (moved.right) setParent(moved.right, sucParent);
+        moved.left = gone.left;
+        moved.right = gone.right;
+        if (moved.left) setParent(moved.left, suc);
+        if (moved.right) setParent(moved.right, suc);
+        if constexpr (Features::size) moved.size = gone.size - 1;
+        replacement = suc;
+        if constexpr (hasAggregate) {
+            for (unsigned int i = path.size() - 1; i > ancestors + 1; i--) pull(path[i - 1]);
+            pull(suc);
+        }
+    }
+
+    if constexpr (Features::size) {
+        for (unsigned int i = 0; i < ancestors; i++) --nodes[path[i]].size;
+    }
+    if (replacement) setParent(replacement, parent);
+    if (!parent) root = replacement;
+    else if (nodes[parent].left == node) nodes[parent].left = replacement;
+    else nodes[parent].right = replacement;
+    freeNode(node);
+    if constexpr (hasAggregate) {
+        for (unsigned int i = ancestors; i > 0; i--) pull(path[i - 1]);
+    }
+
+    nNodes--;
+    if (nNodes == 0) {
+        root = NIL;
+        max_nodes = 0;
+    } else {
+        DeletionRebuild();
+    }
+    return true;
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::deleteBatch(const Vector<T>& values) {
+    if (!isUndoing) undoStack.push({OpType::BatchStart, T()});
+    if (values.size() > 0 && values.size() >= batchRebuildRatio * nNodes) {
+        subtractBatch(values);
+    } else {
+        for (unsigned int i = 0; i < values.size(); i++) deleteValue(values[i]);
+    }
+    if (!isUndoing) undoStack.push({OpType::BatchEnd, T()});
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::subtractBatch(const Vector<T>& values) {
+    if (!root) return;
+    int m = static_cast<int>(values.size());
+    T* victims = new T[m];
+    for (int i = 0; i < m; i++) victims[i] = values[i];
+    m = Linked::sortUnique(victims, m);
+
+    Index list = flattenNodes(root, NIL);
+    Index head = NIL;
+    Index tail = NIL;
+    int idx = 0;
+    while (list) {
+        const Index next = nodes[list].right;
+        while (idx < m && victims[idx] < nodes[list].value) idx++; // victims not in the tree
+        if (idx < m && !(nodes[list].value < victims[idx])) {
+            if (!isUndoing) undoStack.push({OpType::Delete, nodes[list].value});
+            freeNode(list);
+            nNodes--;
+            idx++;
+        } else {
+            if (tail) nodes[tail].right = list; // survivor keeps its place in order
+            else head = list;
+            tail = list;
+        }
+        list = next;
+    }
+    if (tail) nodes[tail].right = NIL;
+
+    root = buildFromList(nNodes, head, NIL);
+    rebuildCount++;
+    max_nodes = nNodes;
+    delete[] victims;
+}
+
+/**
+ * Keeps the array; only the slots go back to unused.
+ */
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::clear() {
+    if (nodes) std::destroy(nodes + 1, nodes + used + 1);
+    used = freeCount = 0;
+    freeList = root = NIL;
+    nNodes = 0;
+    max_nodes = 0;
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::undo() {
+    if (undoStack.isEmpty()) return;
+    isUndoing = true;
+    Command<T> cmd = undoStack.pop();
+
+    if (cmd.type == OpType::BatchEnd) {
+        redoStack.push(cmd);
+        while (!undoStack.isEmpty()) {
+            Command<T> batchCmd = undoStack.pop();
+            redoStack.push(batchCmd);
+            if (batchCmd.type == OpType::BatchStart) break;
+
+            if (batchCmd.type == OpType::Insert) deleteValue(batchCmd.value);
+            else if (batchCmd.type == OpType::Delete) insert(batchCmd.value);
+        }
+    } else {
+        redoStack.push(cmd);
+        if (cmd.type == OpType::Insert) deleteValue(cmd.value);
+        else if (cmd.type == OpType::Delete) insert(cmd.value);
+    }
+    isUndoing = false;
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::redo() {
+    if (redoStack.isEmpty()) return;
+    isUndoing = true;
+    Command<T> cmd = redoStack.pop();
+
+    if (cmd.type == OpType::BatchStart) {
+        undoStack.push(cmd);
+        while (!redoStack.isEmpty()) {
+            Command<T> batchCmd = redoStack.pop();
+            undoStack.push(batchCmd);
+            if (batchCmd.type == OpType::BatchEnd) break;
+
+            if (batchCmd.type == OpType::Insert) insert(batchCmd.value);
+            else if (batchCmd.type == OpType::Delete) deleteValue(batchCmd.value);
+        }
+    } else {
+        undoStack.push(cmd);
+        if (cmd.type == OpType::Insert) insert(cmd.value);
+        else if (cmd.type == OpType::Delete) deleteValue(cmd.value);
+    }
+    isUndoing = false;
+}
+
+// =====================
+// Queries
+// =====================
+
+template<typename T, typename Aggregate, typename Features>
+bool CompactScapeGoatTree<T, Aggregate, Features>::search(const T& key) const {
+    Index current = root;
+    while (current) {
+        const TreeNode& node = nodes[current];
+        if (key == node.value) return true;
+        current = key < node.value ? node.left : node.right;
+    }
+    return false;
+}
+
+template<typename T, typename Aggregate, typename Features>
+T CompactScapeGoatTree<T, Aggregate, Features>::getMin() {
+    if (!root) throw std::runtime_error("Tree is Empty");
+    Index current = root;
+    while (nodes[current].left) current = nodes[current].left;
+    return nodes[current].value;
+}
+
+template<typename T, typename Aggregate, typename Features>
+T CompactScapeGoatTree<T, Aggregate, Features>::getMax() {
+    if (!root) throw std::runtime_error("Tree is Empty");
+    Index current = root;
+    while (nodes[current].right) current = nodes[current].right;
+    return nodes[current].value;
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::rangeHelper(const Index node, T min, T max, Vector<T>& range) const {
+    if (!node) return;
+    const T& value = nodes[node].value;
+    if (value > min) rangeHelper(nodes[node].left, min, max, range);
+    if (value >= min && value <= max) range.push_back(value);
+    if (value < max) rangeHelper(nodes[node].right, min, max, range);
+}
+
+template<typename T, typename Aggregate, typename Features>
+Vector<T> CompactScapeGoatTree<T, Aggregate, Features>::valuesInRange(T min, T max) {
+    Vector<T> range;
+    rangeHelper(root, min, max, range);
+    return range;
+}
+
+template<typename T, typename Aggregate, typename Features>
+T CompactScapeGoatTree<T, Aggregate, Features>::getSuccessor(T value) const {
+    Index node = root;
+    Index successor = NIL;
+    while (node) {
+        if (value < nodes[node].value) {
+            successor = node;
+            node = nodes[node].left;
+        } else {
+            node = nodes[node].right;
+        }
+    }
+    if (!successor) throw std::runtime_error("No successor found");
+    return nodes[successor].value;
+}
+
+template<typename T, typename Aggregate, typename Features>
+T CompactScapeGoatTree<T, Aggregate, Features>::kthSmallestHelper(Index node, int k) const {
+    while (true) {
+        const int leftSize = static_cast<int>(countN(nodes[node].left));
+        if (k == leftSize + 1) return nodes[node].value;
+        if (k <= leftSize) {
+            node = nodes[node].left;
+        } else {
+            k -= leftSize + 1;
+            node = nodes[node].right;
+        }
+    }
+}
+
+template<typename T, typename Aggregate, typename Features>
+T CompactScapeGoatTree<T, Aggregate, Features>::kthSmallest(const int k) const {
+    static_assert(Features::size, "kthSmallest needs subtree sizes (NodeFeatures<..., true>)");
+    if (k < 1 || k > nNodes) throw std::out_of_range("k is out of bounds");
+    return kthSmallestHelper(root, k);
+}
+
+template<typename T, typename Aggregate, typename Features>
+T CompactScapeGoatTree<T, Aggregate, Features>::sumHelper(const Index node, T min, T max) const {
+    T sum{};
+    if (!node) return sum;
+    const T& value = nodes[node].value;
+    if (value >= min) sum += sumHelper(nodes[node].left, min, max);
+    if (value >= min && value <= max) sum += value;
+    if (value <= max) sum += sumHelper(nodes[node].right, min, max);
+    return sum;
+}
+
+template<typename T, typename Aggregate, typename Features>
+T CompactScapeGoatTree<T, Aggregate, Features>::sumInRange(T min, T max) const {
+    if constexpr (std::is_same_v<Aggregate, SumAggregate<T>>) return aggregateHelper(root, min, max);
+    else return sumHelper(root, min, max);
+}
+
+// =====================
+// Subtree aggregates
+// =====================
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::pull(const Index node) {
+    if constexpr (hasAggregate) {
+        TreeNode& n = nodes[node];
+        n.agg = Aggregate::combine(Aggregate::combine(aggOf(n.left), Aggregate::lift(n.value)), aggOf(n.right));
+    }
+}
+
+template<typename T, typename Aggregate, typename Features>
+auto CompactScapeGoatTree<T, Aggregate, Features>::aggOf(const Index node) const {
+    return node ? nodes[node].agg : Aggregate::identity();
+}
+
+template<typename T, typename Aggregate, typename Features>
+auto CompactScapeGoatTree<T, Aggregate, Features>::suffixAggregate(const Index node, const T& min) const {
+    if (!node) return Aggregate::identity();
+    const TreeNode& n = nodes[node];
+    if (n.value < min) return suffixAggregate(n.right, min);
+    return Aggregate::combine(Aggregate::combine(suffixAggregate(n.left, min), Aggregate::lift(n.value)), aggOf(n.right));
+}
+
+template<typename T, typename Aggregate, typename Features>
+auto CompactScapeGoatTree<T, Aggregate, Features>::prefixAggregate(const Index node, const T& max) const {
+    if (!node) return Aggregate::identity();
+    const TreeNode& n = nodes[node];
+    if (n.value > max) return prefixAggregate(n.left, max);
+    return Aggregate::combine(Aggregate::combine(aggOf(n.left), Aggregate::lift(n.value)), prefixAggregate(n.right, max));
+}
+
+template<typename T, typename Aggregate, typename Features>
+auto CompactScapeGoatTree<T, Aggregate, Features>::aggregateHelper(Index node, const T& min, const T& max) const {
+    while (node) {
+        if (nodes[node].value < min) node = nodes[node].right;
+        else if (nodes[node].value > max) node = nodes[node].left;
+        else break;
+    }
+    if (!node) return Aggregate::identity();
+    const TreeNode& n = nodes[node];
+    return Aggregate::combine(Aggregate::combine(suffixAggregate(n.left, min), Aggregate::lift(n.value)),
+                              prefixAggregate(n.right, max));
+}
+
+template<typename T, typename Aggregate, typename Features>
+template<typename Op>
+void CompactScapeGoatTree<T, Aggregate, Features>::foldHelper(const Index node, const T& min, const T& max,
+                                                    typename Op::value_type& acc) const {
+    if (!node) return;
+    const T& value = nodes[node].value;
+    if (value > min) foldHelper<Op>(nodes[node].left, min, max, acc);
+    if (value >= min && value <= max) acc = Op::combine(acc, Op::lift(value));
+    if (value < max) foldHelper<Op>(nodes[node].right, min, max, acc);
+}
+
+template<typename T, typename Aggregate, typename Features>
+template<typename Op>
+typename Op::value_type CompactScapeGoatTree<T, Aggregate, Features>::aggregateInRange(const T& min, const T& max) const {
+    if (max < min) return Op::identity();
+    if constexpr (std::is_same_v<Op, Aggregate>) {
+        return aggregateHelper(root, min, max);
+    } else {
+        typename Op::value_type acc = Op::identity();
+        foldHelper<Op>(root, min, max, acc);
+        return acc;
+    }
+}
+
+// =====================
+// Iteration
+// =====================
+
+template<typename T, typename Aggregate, typename Features>
+typename CompactScapeGoatTree<T, Aggregate, Features>::Index CompactScapeGoatTree<T, Aggregate, Features>::findSuccessor(Index node) const {
+    if (!node) return NIL;
+    if (nodes[node].right) {
+        Index suc = nodes[node].right;
+        while (nodes[suc].left) suc = nodes[suc].left;
+        return suc;
+    }
+    Index p = nodes[node].parent;
+    while (p && node == nodes[p].right) {
+        node = p;
+        p = nodes[p].parent;
+    }
+    return p;
+}
+
+template<typename T, typename Aggregate, typename Features>
+typename CompactScapeGoatTree<T, Aggregate, Features>::iterator CompactScapeGoatTree<T, Aggregate, Features>::begin() {
+    if (!root) return end();
+    if constexpr (!Features::parent) {
+        iterator it(this, NIL);
+        it.descendLeft(root);
+        return it;
+    } else {
+        Index curr = root;
+        while (nodes[curr].left) curr = nodes[curr].left;
+        return iterator(this, curr);
+    }
+}
+
+template<typename T, typename Aggregate, typename Features>
+typename CompactScapeGoatTree<T, Aggregate, Features>::iterator CompactScapeGoatTree<T, Aggregate, Features>::end() {
+    return iterator(nullptr, NIL);
+}
+
+// =====================
+// Display
+// =====================
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::displayPreOrder(const Index node, std::ostream& os) const {
+    if (!node) return;
+    os << nodes[node].value << " ";
+    displayPreOrder(nodes[node].left, os);
+    displayPreOrder(nodes[node].right, os);
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::displayInOrder(const Index node, std::ostream& os) const {
+    if (!node) return;
+    displayInOrder(nodes[node].left, os);
+    os << nodes[node].value << " ";
+    displayInOrder(nodes[node].right, os);
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::displayPostOrder(const Index node, std::ostream& os) const {
+    if (!node) return;
+    displayPostOrder(nodes[node].left, os);
+    displayPostOrder(nodes[node].right, os);
+    os << nodes[node].value << " ";
+}
+
+template<typename T, typename Aggregate, typename Features>
+std::string CompactScapeGoatTree<T, Aggregate, Features>::displayPreOrder() {
+    if (!root) return "Tree is empty.";
+    std::ostringstream oss;
+    displayPreOrder(root, oss);
+    return oss.str();
+}
+
+template<typename T, typename Aggregate, typename Features>
+std::string CompactScapeGoatTree<T, Aggregate, Features>::displayInOrder() {
+    if (!root) return "Tree is empty.";
+    std::ostringstream oss;
+    displayInOrder(root, oss);
+    return oss.str();
+}
+
+template<typename T, typename Aggregate, typename Features>
+std::string CompactScapeGoatTree<T, Aggregate, Features>::displayPostOrder() {
+    if (!root) return "Tree is empty.";
+    std::ostringstream oss;
+    displayPostOrder(root, oss);
+    return oss.str();
+}
+
+template<typename T, typename Aggregate, typename Features>
+std::string CompactScapeGoatTree<T, Aggregate, Features>::displayLevels() {
+    if (!root) return "Tree is Empty.";
+    std::string result;
+    Queue<Index> q;
+    q.push(root);
+    int level = 0;
+
+    while (!q.isEmpty()) {
+        result += "Level " + std::to_string(level++) + ": ";
+        const int nodesAtLevel = q.size();
+        for (int i = 0; i < nodesAtLevel; i++) {
+            const Index curr = q.front();
+            q.pop();
+
+            std::ostringstream oss;
+            oss << nodes[curr].value;
+            result += oss.str() + " ";
+
+            if (nodes[curr].left) q.push(nodes[curr].left);
+            if (nodes[curr].right) q.push(nodes[curr].right);
+        }
+        result += "\n";
+    }
+    return result;
+}
+
+template<typename T, typename Aggregate, typename Features>
+std::string CompactScapeGoatTree<T, Aggregate, Features>::isBalanced() const {
+    std::ostringstream out;
+
+    const double n = nNodes;
+    if (n == 0) {
+        out << "Tree empty. Of course it's balanced ";
+        return out.str();
+    }
+
+    const int height = findH(root);
+    const double bound = log(n) / log(1.5);
+
+    out << "Node count: " << n << "\n";
+    out << "Height: " << height << "\n";
+    out << "Height bound: " << bound << "\n";
+    out << "Total Rebuilds: " << rebuildCount << "\n\n";
+
+    if (height <= bound)
+        out << "^_____^ Tree is balanced. \nCongratulations, It's not a Linked List.\n";
+    else
+        out << "~_~ Tree is NOT balanced. A scapegoat must be sacrificed.\n";
+
+    return out.str();
+}
+
+// =====================
+// Operators
+// =====================
+
+template<typename T, typename Aggregate, typename Features>
+CompactScapeGoatTree<T, Aggregate, Features> CompactScapeGoatTree<T, Aggregate, Features>::operator+(const CompactScapeGoatTree& other) const {
+    T* array = new T[nNodes];
+    T* other_array = new T[other.nNodes];
+    int i = 0;
+    inorderTraversal(root, i, array);
+    int i2 = 0;
+    other.inorderTraversal(other.root, i2, other_array);
+    T* merged = new T[nNodes + other.nNodes];
+    const int n = static_cast<int>(std::set_union(array, array + nNodes, other_array, other_array + other.nNodes, merged) - merged);
+
+    CompactScapeGoatTree result;
+    result.assignArray(merged, n, false);
+    delete[] merged;
+    delete[] array;
+    delete[] other_array;
+    return result;
+}
+
+template<typename T, typename Aggregate, typename Features>
+CompactScapeGoatTree<T, Aggregate, Features>& CompactScapeGoatTree<T, Aggregate, Features>::operator=(const int value) {
+    if (value == 0) clear();
+    return *this;
+}
+
+template<typename T, typename Aggregate, typename Features>
+bool CompactScapeGoatTree<T, Aggregate, Features>::areTreesEqual(const CompactScapeGoatTree& other, const Index n1, const Index n2) const {
+    if (!n1 && !n2) return true;
+    if (!n1 || !n2) return false;
+    if (nodes[n1].value != other.nodes[n2].value) return false;
+    return areTreesEqual(other, nodes[n1].left, other.nodes[n2].left) &&
+           areTreesEqual(other, nodes[n1].right, other.nodes[n2].right);
+}
+
+template<typename T, typename Aggregate, typename Features>
+bool CompactScapeGoatTree<T, Aggregate, Features>::operator==(const CompactScapeGoatTree& tree) const {
+    return areTreesEqual(tree, root, tree.root);
+}
+
+template<typename T, typename Aggregate, typename Features>
+bool CompactScapeGoatTree<T, Aggregate, Features>::operator!=(const CompactScapeGoatTree& tree) const {
+    return !(*this == tree);
+}
+
+template<typename T, typename Aggregate, typename Features>
+bool CompactScapeGoatTree<T, Aggregate, Features>::operator!() const {
+    return root == NIL;
+}
+
+template<typename T, typename Aggregate, typename Features>
+bool CompactScapeGoatTree<T, Aggregate, Features>::operator[](T value) const {
+    return search(value);
+}
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::operator+(const T& value) { insert(value); }
+
+template<typename T, typename Aggregate, typename Features>
+void CompactScapeGoatTree<T, Aggregate, Features>::operator+=(const T& value) { insert(value); }
+
+template<typename T, typename Aggregate, typename Features>
+bool CompactScapeGoatTree<T, Aggregate, Features>::operator-(const T& value) { return deleteValue(value); }
+
+template<typename T, typename Aggregate, typename Features>
+bool CompactScapeGoatTree<T, Aggregate, Features>::operator-=(const T& value) { return deleteValue(value); }
+
+#endif //SCAPEGOATPROJECT_COMPACT_SCAPEGOAT_TREE_TPP
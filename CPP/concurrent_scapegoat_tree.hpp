@@ -0,0 +1,132 @@
+/**
+ * Flat-combining ScapeGoatTree for write-heavy multi-threaded use.
+ *
+ * A thread does not lock the tree for each operation. It posts its request
+ * (insert, delete or search) in a free slot and waits. Whichever waiting
+ * thread gets the combiner lock runs every posted request at once:
+ * - the requests are sorted by key
+ * - the distinct keys are looked up in one sorted sweep
+ * - the net additions go in through one insertBatch, the net removals through one deleteBatch
+ * Then every waiter gets its answer.
+ *
+ * Requests served in the same pass are concurrent, so they are linearized by key
+ * and, for equal keys, by slot. One lock handoff and at most one rebuild
+ * cover the whole pass.
+ */
+#ifndef SCAPEGOATPROJECT_CONCURRENT_SCAPEGOAT_TREE_HPP
+#define SCAPEGOATPROJECT_CONCURRENT_SCAPEGOAT_TREE_HPP
+#include <atomic>
+#include <cstdint>
+#include <exception>
+#include <mutex>
+#include <type_traits>
+#include "scapegoat_tree.hpp"
+
+/**
+ * How much work flat combining folded together (for tests/benchmarks).
+ */
+struct CombiningStats {
+    std::size_t passes = 0;   // combiner passes that served at least one request
+    std::size_t requests = 0; // requests served by those passes
+};
+
+template<typename T, typename Aggregate = NoAggregate>
+class ConcurrentScapeGoatTree {
+    using Tree = ScapeGoatTree<T, Aggregate>;
+    static constexpr unsigned int SLOTS = 64;
+    enum class Op : std::uint8_t { Insert, Delete, Search };
+    enum SlotState : std::uint8_t { Free, Claimed, Pending, Done };
+    /**
+     * One posted request. The owner fills op/value and sets Pending; the
+     * combiner fills result (or error, if the pass threw) and sets Done; the
+     * owner frees it after reading.
+     */
+    struct alignas(64) Slot {
+        std::atomic<std::uint8_t> state{Free};
+        Op op{};
+        bool result{};
+        T value{};
+        std::exception_ptr error;
+    };
+    struct Request {
+        T key;
+        unsigned int slot;
+    };
+
+    Tree tree;
+    /**
+     * Held by the thread that is combining, and by direct readers.
+     */
+    mutable std::mutex combiner;
+    Slot slots[SLOTS];
+    std::atomic<int> count{0};
+    CombiningStats stats;
+    // scratch buffers reused by every pass
+    Vector<Request> requests;
+    Vector<T> keys, additions, removals;
+    Vector<bool> found;
+
+    /**
+     * Posts a request and waits until some combiner (possibly this thread) served it.
+     */
+    bool submit(Op op, const T& value);
+    /**
+     * Serves every pending request as one sorted batch. Caller holds combiner.
+     * If the tree throws, every request of the pass is answered with the
+     * exception, which its owner rethrows.
+     */
+    void combine();
+    /**
+     * The pass itself: answers the collected requests and updates the tree.
+     */
+    void serve();
+
+public:
+    /**
+     * The inner tree records no undo history unless keepHistory is set; only
+     * locked() can undo, and nothing else would ever drain it.
+     */
+    explicit ConcurrentScapeGoatTree(const bool keepHistory = false) { tree.isUndoing = !keepHistory; }
+    ConcurrentScapeGoatTree(const ConcurrentScapeGoatTree&) = delete;
+    ConcurrentScapeGoatTree& operator=(const ConcurrentScapeGoatTree&) = delete;
+
+    /**
+     * Returns true if the key was not present yet. Like deleteValue and search,
+     * rethrows what the tree threw while serving the request.
+     */
+    bool insert(const T& value) { return submit(Op::Insert, value); }
+    /**
+     * Returns true if the key was present.
+     */
+    bool deleteValue(const T& value) { return submit(Op::Delete, value); }
+    [[nodiscard]] bool search(const T& key) { return submit(Op::Search, key); }
+    [[nodiscard]] int size() const { return count.load(); }
+
+    /**
+     * Runs fn(tree) under the combiner lock, for anything flat combining does
+     * not cover (range queries, splits, bulk loads). Requests posted meanwhile
+     * wait and are served together afterwards.
+     */
+    template<typename Fn>
+    auto locked(Fn fn) {
+        std::lock_guard guard(combiner);
+        const int before = tree.size();
+        if constexpr (std::is_void_v<decltype(fn(tree))>) {
+            fn(tree);
+            count += tree.size() - before;
+        } else {
+            auto result = fn(tree);
+            count += tree.size() - before;
+            return result;
+        }
+    }
+    /**
+     * Range queries read the tree directly under the combiner lock.
+     */
+    T sumInRange(T min, T max) const;
+    T kthSmallest(int k) const;
+    [[nodiscard]] CombiningStats combiningStats() const;
+};
+#include "concurrent_scapegoat_tree.tpp"
+
+#endif //SCAPEGOATPROJECT_CONCURRENT_SCAPEGOAT_TREE_HPP
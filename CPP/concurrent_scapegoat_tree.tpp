@@ -0,0 +1,138 @@
+#ifndef SCAPEGOATPROJECT_CONCURRENT_SCAPEGOAT_TREE_TPP
+#define SCAPEGOATPROJECT_CONCURRENT_SCAPEGOAT_TREE_TPP
+#include <algorithm>
+#include <thread>
+
+template<typename T, typename Aggregate>
+bool ConcurrentScapeGoatTree<T, Aggregate>::submit(const Op op, const T& value) {
+    static std::atomic<unsigned int> nextStart{0};
+    thread_local const unsigned int start = nextStart.fetch_add(1, std::memory_order_relaxed);
+    Slot* slot = nullptr;
+    for (unsigned int attempt = 0; !slot; attempt++) {
+        Slot& candidate = slots[(start + attempt) % SLOTS];
+        std::uint8_t idle = Free;
+        if (candidate.state.compare_exchange_strong(idle, Claimed, std::memory_order_acquire)) slot = &candidate;
+        else if (attempt % SLOTS == SLOTS - 1) std::this_thread::yield(); // every slot is taken
+    }
+    slot->op = op;
+    slot->value = value;
+    slot->state.store(Pending, std::memory_order_release);
+
+    while (slot->state.load(std::memory_order_acquire) != Done) {
+        if (std::unique_lock lock(combiner, std::try_to_lock); lock.owns_lock()) combine();
+        else std::this_thread::yield();
+    }
+    const bool result = slot->result;
+    const std::exception_ptr error = std::move(slot->error);
+    slot->error = nullptr;
+    slot->state.store(Free, std::memory_order_release);
+    if (error) std::rethrow_exception(error);
+    return result;
+}
+
+/**
+ * A pass that throws leaves the tree in whatever state the failed batch
+ * reached, so the size is re-read from it.
+ */
+template<typename T, typename Aggregate>
+void ConcurrentScapeGoatTree<T, Aggregate>::combine() {
+    requests.clear();
+    for (unsigned int i = 0; i < SLOTS; i++)
+        if (slots[i].state.load(std::memory_order_acquire) == Pending) requests.push_back({slots[i].value, i});
+    if (!requests.size()) return;
+    stats.passes++;
+    stats.requests += requests.size();
+    try {
+        serve();
+    } catch (...) {
+        const std::exception_ptr error = std::current_exception();
+        count = tree.size();
+        for (unsigned int i = 0; i < requests.size(); i++) {
+            Slot& slot = slots[requests[i].slot]; // serve() marks slots Done only once nothing can throw
+            slot.error = error;
+            slot.state.store(Done, std::memory_order_release);
+        }
+    }
+}
+
+/**
+ * Every distinct key is looked up once with matchKeys; its requests are then
+ * replayed against that presence bit, and only the net change reaches the tree.
+ */
+template<typename T, typename Aggregate>
+void ConcurrentScapeGoatTree<T, Aggregate>::serve() {
+    if (requests.size() == 1) { // nobody to combine with: skip the batch machinery
+        Slot& slot = slots[requests[0].slot];
+        const int before = tree.size();
+        if (slot.op == Op::Insert) tree.insert(slot.value);
+        else if (slot.op == Op::Delete) tree.deleteValue(slot.value);
+        slot.result = slot.op == Op::Search ? tree.search(slot.value) : tree.size() != before;
+        count += tree.size() - before;
+        slot.state.store(Done, std::memory_order_release);
+        return;
+    }
+    std::sort(&requests[0], &requests[0] + requests.size(), [](const Request& a, const Request& b) {
+        if (a.key < b.key) return true;
+        if (b.key < a.key) return false;
+        return a.slot < b.slot;
+    });
+
+    keys.clear();
+    for (unsigned int r = 0; r < requests.size(); r++)
+        if (r == 0 || keys[keys.size() - 1] < requests[r].key) keys.push_back(requests[r].key);
+    const int m = static_cast<int>(keys.size());
+    found.clear();
+    for (int k = 0; k < m; k++) found.push_back(false);
+    Tree::matchKeys(tree.root, &keys[0], 0, m, &found[0]);
+
+    additions.clear();
+    removals.clear();
+    unsigned int r = 0;
+    for (int k = 0; k < m; k++) {
+        bool present = found[k];
+        for (; r < requests.size() && !(keys[k] < requests[r].key); r++) {
+            Slot& slot = slots[requests[r].slot];
+            switch (slot.op) {
+                case Op::Search:
+                    slot.result = present;
+                    break;
+                case Op::Insert:
+                    slot.result = !present;
+                    present = true;
+                    break;
+                case Op::Delete:
+                    slot.result = present;
+                    present = false;
+                    break;
+            }
+        }
+        if (present && !found[k]) additions.push_back(keys[k]);
+        else if (!present && found[k]) removals.push_back(keys[k]);
+    }
+    if (additions.size()) tree.insertBatch(additions);
+    if (removals.size()) tree.deleteBatch(removals);
+    count += static_cast<int>(additions.size()) - static_cast<int>(removals.size());
+
+    for (unsigned int i = 0; i < requests.size(); i++)
+        slots[requests[i].slot].state.store(Done, std::memory_order_release);
+}
+
+template<typename T, typename Aggregate>
+T ConcurrentScapeGoatTree<T, Aggregate>::sumInRange(T min, T max) const {
+    std::lock_guard guard(combiner);
+    return tree.sumInRange(min, max);
+}
+
+template<typename T, typename Aggregate>
+T ConcurrentScapeGoatTree<T, Aggregate>::kthSmallest(const int k) const {
+    std::lock_guard guard(combiner);
+    return tree.kthSmallest(k);
+}
+
+template<typename T, typename Aggregate>
+CombiningStats ConcurrentScapeGoatTree<T, Aggregate>::combiningStats() const {
+    std::lock_guard guard(combiner);
+    return stats;
+}
+
+#endif //SCAPEGOATPROJECT_CONCURRENT_SCAPEGOAT_TREE_TPP
@@ -0,0 +1,110 @@
+/**
+ * Read-only copy of a ScapeGoatTree's keys, laid out for lookups.
+ *
+ * The keys sit in one cache-line-aligned array in Eytzinger (BFS) order: the
+ * root at index 1 and the children of k at 2k and 2k+1. A search is one
+ * comparison per level, with no branch on its outcome; the index it ends on
+ * encodes the answer. Sixteen 4-byte keys share a cache line, so the line four
+ * levels further down is prefetched while the current level is compared.
+ *
+ * Next to it the set keeps the keys in sorted order, each Eytzinger slot's
+ * rank, and (for arithmetic keys) a prefix-sum array, so rank, kthSmallest and
+ * sumInRange are O(1) once the descent is done.
+ *
+ * Build one with ScapeGoatTree::freeze(); it does not change afterwards.
+ */
+#ifndef SCAPEGOATPROJECT_FROZEN_SCAPEGOAT_SET_HPP
+#define SCAPEGOATPROJECT_FROZEN_SCAPEGOAT_SET_HPP
+#include <bit>
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include "task_pool.hpp"
+
+template<typename T, typename Aggregate>
+class ScapeGoatTree;
+
+template<typename T>
+class FrozenScapeGoatSet {
+    template<typename, typename>
+    friend class ScapeGoatTree;
+
+    static constexpr std::size_t LINE = 64;
+    /**
+     * Index step to the first descendant one cache line of keys away.
+     */
+    static constexpr std::size_t AHEAD = sizeof(T) >= LINE ? 1 : std::bit_floor(LINE / sizeof(T));
+
+    /**
+     * Integer prefix sums wrap around modulo 2^64, which is well defined, and
+     * the difference of two of them is exact whenever the range's sum fits in T.
+     */
+    using Sum = std::conditional_t<std::is_integral_v<T>, unsigned long long, T>;
+
+    int n = 0;
+    T* keys = nullptr;     // Eytzinger order in keys[1..n]; keys[0] is unused
+    int* rankOf = nullptr; // rankOf[k]: how many keys are smaller than keys[k]
+    T* sorted = nullptr;   // the same keys in ascending order
+    Sum* prefix = nullptr; // prefix[i]: sum of sorted[0, i); arithmetic keys only
+
+    /**
+     * Adopts the n sorted, distinct keys in values (allocated with new[]).
+     * The prefix sums are computed in chunks on pool when it is given.
+     */
+    FrozenScapeGoatSet(T* values, int n, TaskPool* pool, int chunks);
+    /**
+     * Writes the keys from sorted[i] on into the Eytzinger subtree at k;
+     * returns the rank after the last key it placed.
+     */
+    int place(std::size_t k, int i);
+    void buildPrefix(TaskPool* pool, int chunks);
+    /**
+     * Eytzinger index of the first key >= key (> key if Upper), 0 if none.
+     */
+    template<bool Upper>
+    [[nodiscard]] std::size_t descend(const T& key) const;
+    void release();
+
+public:
+    FrozenScapeGoatSet() = default;
+    /**
+     * Frozen sets are moved, not copied; freeze() the tree again for a copy.
+     */
+    FrozenScapeGoatSet(const FrozenScapeGoatSet&) = delete;
+    FrozenScapeGoatSet& operator=(const FrozenScapeGoatSet&) = delete;
+    FrozenScapeGoatSet(FrozenScapeGoatSet&& other) noexcept;
+    FrozenScapeGoatSet& operator=(FrozenScapeGoatSet&& other) noexcept;
+    ~FrozenScapeGoatSet() { release(); }
+
+    [[nodiscard]] bool search(const T& key) const;
+    /**
+     * Looks up keys[0, m) and sets found[i] for each. Probes descend eight at a
+     * time, so their cache misses overlap; for int keys an AVX2 build does the
+     * eight descents in one vector register.
+     */
+    void searchBatch(const T* probes, int m, bool* found) const;
+    /**
+     * The smallest key >= key, or nullptr if there is none.
+     */
+    [[nodiscard]] const T* lowerBound(const T& key) const;
+    /**
+     * Number of keys smaller than key.
+     */
+    [[nodiscard]] int rank(const T& key) const;
+    T kthSmallest(int k) const;
+    /**
+     * Sum of the keys in [min, max] as a difference of two prefix sums. For
+     * floating-point keys it can differ from the tree's sum in the last bits.
+     */
+    T sumInRange(T min, T max) const;
+    [[nodiscard]] int size() const { return n; }
+    bool operator!() const { return n == 0; }
+    /**
+     * Iterates the keys in ascending order.
+     */
+    const T* begin() const { return sorted; }
+    const T* end() const { return sorted + n; }
+};
+#include "frozen_scapegoat_set.tpp"
+
+#endif //SCAPEGOATPROJECT_FROZEN_SCAPEGOAT_SET_HPP
@@ -0,0 +1,215 @@
+#ifndef SCAPEGOATPROJECT_FROZEN_SCAPEGOAT_SET_TPP
+#define SCAPEGOATPROJECT_FROZEN_SCAPEGOAT_SET_TPP
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+namespace frozen_detail {
+/**
+ * Hint only: never faults, so addresses past the array are fine.
+ */
+inline void prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#endif
+}
+}
+
+template<typename T>
+FrozenScapeGoatSet<T>::FrozenScapeGoatSet(T* values, const int n, TaskPool* pool, const int chunks) : n(n), sorted(values) {
+    if (n == 0) return;
+    keys = static_cast<T*>(::operator new[]((n + 1) * sizeof(T), std::align_val_t{LINE}));
+    std::uninitialized_value_construct_n(keys, n + 1);
+    rankOf = new int[n + 1];
+    rankOf[0] = n;
+    place(1, 0);
+    if constexpr (std::is_arithmetic_v<T>) buildPrefix(pool, chunks);
+}
+
+template<typename T>
+int FrozenScapeGoatSet<T>::place(const std::size_t k, int i) {
+    if (k > static_cast<std::size_t>(n)) return i;
+    i = place(2 * k, i);
+    keys[k] = sorted[i];
+    rankOf[k] = i;
+    return place(2 * k + 1, i + 1);
+}
+
+/**
+ * Each chunk first sums its own keys from zero; the chunk totals then give
+ * every chunk the offset it adds in a second pass.
+ */
+template<typename T>
+void FrozenScapeGoatSet<T>::buildPrefix(TaskPool* pool, int chunks) {
+    prefix = new Sum[n + 1];
+    prefix[0] = Sum{};
+    if (!pool || chunks < 2) {
+        for (int i = 0; i < n; i++) prefix[i + 1] = prefix[i] + static_cast<Sum>(sorted[i]);
+        return;
+    }
+    auto chunkStart = [this, chunks](const int c) { return static_cast<int>(static_cast<long long>(n) * c / chunks); };
+    pool->forEach(0, chunks, 1, [&](const int c) {
+        Sum sum{};
+        for (int i = chunkStart(c); i < chunkStart(c + 1); i++) prefix[i + 1] = sum += static_cast<Sum>(sorted[i]);
+    });
+    Sum* offset = new Sum[chunks];
+    offset[0] = Sum{};
+    for (int c = 1; c < chunks; c++) offset[c] = offset[c - 1] + prefix[chunkStart(c)];
+    pool->forEach(1, chunks, 1, [&](const int c) {
+        for (int i = chunkStart(c); i < chunkStart(c + 1); i++) prefix[i + 1] += offset[c];
+    });
+    delete[] offset;
+}
+
+/**
+ * The loop ends below the leaves: every right turn appends a 1 bit to k and
+ * every left turn a 0 bit. Dropping the trailing right turns and the last left
+ * one leaves the node where the search last went left, i.e. the answer.
+ */
+template<typename T>
+template<bool Upper>
+std::size_t FrozenScapeGoatSet<T>::descend(const T& key) const {
+    std::size_t k = 1;
+    while (k <= static_cast<std::size_t>(n)) {
+        frozen_detail::prefetch(reinterpret_cast<const void*>(reinterpret_cast<std::uintptr_t>(keys) + AHEAD * k * sizeof(T)));
+        if constexpr (Upper) k = 2 * k + !(key < keys[k]);
+        else k = 2 * k + (keys[k] < key);
+    }
+    return k >> (std::countr_one(k) + 1);
+}
+
+template<typename T>
+void FrozenScapeGoatSet<T>::release() {
+    if (keys) {
+        std::destroy_n(keys, n + 1);
+        ::operator delete[](keys, std::align_val_t{LINE});
+    }
+    delete[] rankOf;
+    delete[] sorted;
+    delete[] prefix;
+    keys = sorted = nullptr;
+    rankOf = nullptr;
+    prefix = nullptr;
+    n = 0;
+}
+
+template<typename T>
+FrozenScapeGoatSet<T>::FrozenScapeGoatSet(FrozenScapeGoatSet&& other) noexcept
+    : n(std::exchange(other.n, 0)),
+      keys(std::exchange(other.keys, nullptr)),
+      rankOf(std::exchange(other.rankOf, nullptr)),
+      sorted(std::exchange(other.sorted, nullptr)),
+      prefix(std::exchange(other.prefix, nullptr)) {}
+
+template<typename T>
+FrozenScapeGoatSet<T>& FrozenScapeGoatSet<T>::operator=(FrozenScapeGoatSet&& other) noexcept {
+    if (this == &other) return *this;
+    release();
+    n = std::exchange(other.n, 0);
+    keys = std::exchange(other.keys, nullptr);
+    rankOf = std::exchange(other.rankOf, nullptr);
+    sorted = std::exchange(other.sorted, nullptr);
+    prefix = std::exchange(other.prefix, nullptr);
+    return *this;
+}
+
+// =====================
+// Lookups
+// =====================
+
+template<typename T>
+bool FrozenScapeGoatSet<T>::search(const T& key) const {
+    const std::size_t k = descend<false>(key);
+    return k && !(key < keys[k]);
+}
+
+/**
+ * A probe's first bit_width(n) - 1 steps stay inside the complete levels, so
+ * they need no bounds check; only the step into the last, partial level does.
+ */
+template<typename T>
+void FrozenScapeGoatSet<T>::searchBatch(const T* probes, const int m, bool* found) const {
+    constexpr int GROUP = 8;
+    const std::size_t size = n;
+    const int full = std::bit_width(size) - 1;
+    auto finish = [&](std::size_t k, const int at) {
+        k >>= std::countr_one(k) + 1;
+        found[at] = k && !(probes[at] < keys[k]);
+    };
+    int i = 0;
+    if (n == 0) {
+        std::fill(found, found + m, false);
+        return;
+    }
+#if defined(__AVX2__)
+    if constexpr (std::is_same_v<T, int>) {
+        if (n < (1 << 30)) { // indices stay positive int32 all the way down
+            const int* base = keys;
+            const __m256i one = _mm256_set1_epi32(1);
+            const __m256i past = _mm256_set1_epi32(n + 1);
+            for (; i + GROUP <= m; i += GROUP) {
+                const __m256i probe = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(probes + i));
+                __m256i k = one;
+                for (int level = 0; level < full; level++) {
+                    const __m256i right = _mm256_cmpgt_epi32(probe, _mm256_i32gather_epi32(base, k, 4));
+                    k = _mm256_sub_epi32(_mm256_add_epi32(k, k), right); // 2k, plus 1 where key < probe
+                }
+                const __m256i inside = _mm256_cmpgt_epi32(past, k);
+                const __m256i node = _mm256_mask_i32gather_epi32(_mm256_setzero_si256(), base, k, inside, 4);
+                const __m256i next = _mm256_sub_epi32(_mm256_add_epi32(k, k), _mm256_cmpgt_epi32(probe, node));
+                k = _mm256_blendv_epi8(k, next, inside);
+                alignas(32) int lanes[GROUP];
+                _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), k);
+                for (int g = 0; g < GROUP; g++) finish(static_cast<std::size_t>(lanes[g]), i + g);
+            }
+        }
+    }
+#endif
+    for (; i < m; i += GROUP) {
+        const int group = std::min(GROUP, m - i);
+        std::size_t k[GROUP];
+        std::fill(k, k + group, 1);
+        for (int level = 0; level < full; level++) {
+            for (int g = 0; g < group; g++) k[g] = 2 * k[g] + (keys[k[g]] < probes[i + g]);
+        }
+        for (int g = 0; g < group; g++) {
+            if (k[g] <= size) k[g] = 2 * k[g] + (keys[k[g]] < probes[i + g]);
+            finish(k[g], i + g);
+        }
+    }
+}
+
+template<typename T>
+const T* FrozenScapeGoatSet<T>::lowerBound(const T& key) const {
+    const std::size_t k = descend<false>(key);
+    return k ? &keys[k] : nullptr;
+}
+
+template<typename T>
+int FrozenScapeGoatSet<T>::rank(const T& key) const {
+    return n ? rankOf[descend<false>(key)] : 0;
+}
+
+template<typename T>
+T FrozenScapeGoatSet<T>::kthSmallest(const int k) const {
+    if (k < 1 || k > n) throw std::out_of_range("k is out of bounds");
+    return sorted[k - 1];
+}
+
+template<typename T>
+T FrozenScapeGoatSet<T>::sumInRange(T min, T max) const {
+    static_assert(std::is_arithmetic_v<T>, "sumInRange needs arithmetic keys");
+    if (max < min || n == 0) return T{};
+    return static_cast<T>(prefix[rankOf[descend<true>(max)]] - prefix[rankOf[descend<false>(min)]]);
+}
+
+#endif //SCAPEGOATPROJECT_FROZEN_SCAPEGOAT_SET_TPP
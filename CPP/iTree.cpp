@@ -330,7 +330,75 @@ void ITree::handleSplit(ScapeGoatTree<ElemenType> &A, ScapeGoatTree<ElemenType>
     cin >> val;
     if (!validateCinLine())return;
     cout << "\n";
-    cout << format("Tree Splitted Successfully. Tree A: values < {}. Tree B: values > B",val,val)<<endl;
+    // both slots receive a half, so the tree that was not selected gets replaced
+    const auto& other = &tree == &A ? B : A;
+    if (other.size() > 0) {
+        char answer;
+        cout << format("Tree {} is not empty; its {} values will be discarded. Continue? (y/n): ",
+                       &other == &A ? 'A' : 'B', other.size());
+        cin >> answer;
+        if (!validateCinLine() || (answer != 'y' && answer != 'Y')) {
+            printInfo("Split cancelled; both trees are unchanged.");
+            return;
+        }
+    }
+    auto [low, high] = tree.split(val);
+    A = std::move(low);
+    B = std::move(high);
+    cout << format("Tree Splitted Successfully. Tree A: values < {}. Tree B: values >= {}",val,val)<<endl;
+}
+
+void ITree::handleJoin(ScapeGoatTree<ElemenType> &A, ScapeGoatTree<ElemenType> &B) {
+    try {
+        A = ScapeGoatTree<ElemenType>::join(std::move(A), std::move(B));
+    } catch (const std::invalid_argument&) {
+        printError("ERROR: every value of Tree A must be smaller than every value of Tree B.");
+        return;
+    }
+    printInfo("Tree A after join (Tree B is now empty):");
+    cout << A.displayInOrder() << "\n";
+    printSuccess("SUCCESS: Join complete.");
+}
+
+/**
+ * Handles the set operations between Tree A and Tree B.
+ */
+void ITree::handleSetOperations(ScapeGoatTree<ElemenType> &A, ScapeGoatTree<ElemenType> &B, const opcodes op) {
+    printInfo("\nTree A:");
+    cout << A.displayInOrder() << "\n";
+
+    printInfo("Tree B:");
+    cout << B.displayInOrder() << "\n";
+
+    switch (op) {
+        case opcodes::INTERSECT: {
+            printInfo("A intersect B:");
+            cout << A.intersect(B).displayInOrder() << "\n";
+        } break;
+        case opcodes::DIFFERENCE: {
+            printInfo("A - B:");
+            cout << A.difference(B).displayInOrder() << "\n";
+        } break;
+        case opcodes::SYMDIFF: {
+            printInfo("A xor B:");
+            cout << A.symmetricDifference(B).displayInOrder() << "\n";
+        } break;
+        case opcodes::SUBSET: {
+            if (A.isSubsetOf(B)) printSuccess("A IS a subset of B");
+            else printError("A is NOT a subset of B");
+        } break;
+        case opcodes::DISJOINT: {
+            if (A.isDisjoint(B)) printSuccess("Trees are DISJOINT");
+            else printError("Trees are NOT disjoint");
+        } break;
+        case opcodes::UNION: {
+            A.unionWith(std::move(B));
+            printInfo("Tree A after union (Tree B is now empty):");
+            cout << A.displayInOrder() << "\n";
+            printSuccess("SUCCESS: Union complete.");
+        } break;
+        default: ;
+    }
 }
 
 /* ===================== Main UI ===================== */
@@ -376,6 +444,13 @@ void ITree::TreeUI() {
         {"Get Inorder Successor",opcodes::SUCC,            [](auto& A, auto& B, auto ){handleSucessor(A,B);}},
        {"Kth Smallest Element", opcodes::KTH,              [](auto& A, auto& B, auto ){handleKthSmallestElement(A,B);}},
        {"Split",               opcodes::SPLIT,              [](auto& A, auto& B, auto ){handleSplit(A,B);}},
+        {"Join A & B",          opcodes::JOIN,             [](auto& A, auto& B, auto ){handleJoin(A,B);}},
+        {"Intersect A & B",     opcodes::INTERSECT,        handleSetOperations},
+        {"Difference A - B",    opcodes::DIFFERENCE,       handleSetOperations},
+        {"Symmetric Difference",opcodes::SYMDIFF,          handleSetOperations},
+        {"Is A Subset of B",    opcodes::SUBSET,           handleSetOperations},
+        {"Are A & B Disjoint",  opcodes::DISJOINT,         handleSetOperations},
+        {"Union B into A",      opcodes::UNION,            handleSetOperations},
 
 
     };
@@ -10,7 +10,8 @@ typedef int ElemenType;
 
 enum class opcodes {INSERT, DELETEOP, SEARCH, DISPLAY_INORDER, DISPLAY_PREORDER,
     DISPLAY_POSTORDER, DISPLAY_LEVELS,EXIT,BALANCE,COMPARE,MERGE,EMPTY,BATCH_INSERT,BATCH_DELETE,CLEAR,
-    UNDO,REDO,SUMINRANGE,VALUESINRANGE,MIN,MAX,KTH,SUCC,SPLIT};
+    UNDO,REDO,SUMINRANGE,VALUESINRANGE,MIN,MAX,KTH,SUCC,SPLIT,
+    INTERSECT,DIFFERENCE,SYMDIFF,SUBSET,DISJOINT,UNION,JOIN};
 
 class ITree {
     /**
@@ -70,6 +71,11 @@ class ITree {
     static void handleKthSmallestElement(ScapeGoatTree<ElemenType> &A, ScapeGoatTree<ElemenType> &B);
     static void handleSucessor(ScapeGoatTree<ElemenType> &A, ScapeGoatTree<ElemenType> &B);
     static void handleSplit(ScapeGoatTree<ElemenType> &A, ScapeGoatTree<ElemenType> &B);
+    static void handleJoin(ScapeGoatTree<ElemenType> &A, ScapeGoatTree<ElemenType> &B);
+    /**
+     * Handles the set operations between Tree A and Tree B.
+     */
+    static void handleSetOperations(ScapeGoatTree<ElemenType> &A, ScapeGoatTree<ElemenType> &B, opcodes op);
 
 
 public:
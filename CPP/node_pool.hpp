@@ -0,0 +1,279 @@
+//
+// Created by DELL on 18/01/2026.
+//
+
+#ifndef SCAPEGOATPROJECT_NODE_POOL_HPP
+#define SCAPEGOATPROJECT_NODE_POOL_HPP
+#include <algorithm>
+#include <cstddef>
+#include <new>
+#include <utility>
+#include "vector.hpp"
+
+/**
+ * Allocation counters reported by a NodePool.
+ */
+struct PoolStats {
+    std::size_t nodesServed = 0;     // total nodes handed out by create()
+    std::size_t slabAllocations = 0; // heap allocations actually performed
+    std::size_t liveNodes = 0;       // nodes currently in use
+    std::size_t capacity = 0;        // node slots owned by the pool
+};
+
+/**
+ * Slab allocator for tree nodes.
+ *
+ * Nodes are carved out of large chunks (slabs) and recycled through an
+ * intrusive free list, so steady-state insert/delete churn never reaches malloc.
+ * A pool belongs to exactly one tree and is not thread-safe. Every slab is
+ * owned by exactly one pool: joining trees hands slabs over (adopt), and a
+ * split copies one half out instead of sharing them.
+ */
+template<typename NodeT>
+class NodePool {
+    union Slot {
+        Slot* next;                                   // free-list link while unused
+        alignas(NodeT) unsigned char storage[sizeof(NodeT)];
+    };
+    struct Slab {
+        Slot* slots{};
+        std::size_t count{};
+    };
+    static constexpr std::size_t FIRST_SLAB = 64;       // slots in the first slab
+    static constexpr std::size_t MAX_SLAB = 1u << 16;   // growth cap per slab
+
+    Vector<Slab> slabs;
+    Slot* freeList{};
+    Slot* freeTail{};  // last free slot, so another pool's list splices in O(1)
+    Slot* bump{};      // next never-used slot of the newest slab
+    Slot* bumpEnd{};
+    std::size_t nextSlab = FIRST_SLAB;
+    std::size_t freeCount = 0;
+    PoolStats stats;
+
+    /**
+     * Allocates a new slab with room for at least n slots and makes it the bump region.
+     */
+    void grow(std::size_t n) {
+        if (n < nextSlab) n = nextSlab;
+        Slab slab;
+        slab.slots = static_cast<Slot*>(::operator new(n * sizeof(Slot)));
+        slab.count = n;
+        slabs.push_back(slab);
+        // whatever was left of the old bump region goes to the free list
+        while (bump != bumpEnd) release(bump++);
+        bump = slab.slots;
+        bumpEnd = slab.slots + n;
+        stats.slabAllocations++;
+        stats.capacity += n;
+        if (nextSlab < MAX_SLAB) nextSlab *= 2;
+    }
+
+    void release(Slot* slot) {
+        if (!freeList) freeTail = slot;
+        slot->next = freeList;
+        freeList = slot;
+        freeCount++;
+    }
+
+    Slot* acquire() {
+        if (freeList) {
+            Slot* slot = freeList;
+            freeList = slot->next;
+            if (!freeList) freeTail = nullptr;
+            freeCount--;
+            return slot;
+        }
+        if (bump == bumpEnd) grow(nextSlab);
+        return bump++;
+    }
+
+    void releaseSlabs() {
+        for (unsigned int i = 0; i < slabs.size(); i++) ::operator delete(slabs[i].slots);
+        slabs = Vector<Slab>();
+        freeList = freeTail = bump = bumpEnd = nullptr;
+        freeCount = 0;
+        nextSlab = FIRST_SLAB;
+        stats.capacity = 0;
+        stats.liveNodes = 0;
+    }
+
+public:
+    NodePool() = default;
+    NodePool(const NodePool&) = delete;
+    NodePool& operator=(const NodePool&) = delete;
+
+    NodePool(NodePool&& other) noexcept { swap(other); }
+    NodePool& operator=(NodePool&& other) noexcept {
+        if (this != &other) {
+            releaseSlabs();
+            swap(other);
+        }
+        return *this;
+    }
+
+    /**
+     * Frees every slab. Node destructors are NOT run here; the owning tree does that.
+     */
+    ~NodePool() { releaseSlabs(); }
+
+    void swap(NodePool& other) noexcept {
+        std::swap(slabs, other.slabs);
+        std::swap(freeList, other.freeList);
+        std::swap(freeTail, other.freeTail);
+        std::swap(bump, other.bump);
+        std::swap(bumpEnd, other.bumpEnd);
+        std::swap(nextSlab, other.nextSlab);
+        std::swap(freeCount, other.freeCount);
+        std::swap(stats, other.stats);
+    }
+
+    /**
+     * Constructs a node in a recycled or fresh slot.
+     */
+    template<typename... Args>
+    NodeT* create(Args&&... args) {
+        Slot* slot = acquire();
+        stats.nodesServed++;
+        stats.liveNodes++;
+        return ::new (static_cast<void*>(slot->storage)) NodeT(std::forward<Args>(args)...);
+    }
+
+    /**
+     * Destroys a node and puts its slot back on the free list.
+     */
+    void destroy(NodeT* node) {
+        if (!node) return;
+        node->~NodeT();
+        release(reinterpret_cast<Slot*>(node));
+        stats.liveNodes--;
+    }
+
+    /**
+     * Takes over every slab of other, live nodes included, and leaves other empty.
+     * Nodes other created may afterwards be destroyed through this pool.
+     */
+    void adopt(NodePool& other) {
+        if (&other == this) return;
+        for (unsigned int i = 0; i < other.slabs.size(); i++) slabs.push_back(other.slabs[i]);
+        // keep the larger bump region, the smaller one's slots become free
+        if (bumpEnd - bump < other.bumpEnd - other.bump) {
+            std::swap(bump, other.bump);
+            std::swap(bumpEnd, other.bumpEnd);
+        }
+        while (other.bump != other.bumpEnd) release(other.bump++);
+        if (other.freeList) {
+            other.freeTail->next = freeList;
+            if (!freeList) freeTail = other.freeTail;
+            freeList = other.freeList;
+            freeCount += other.freeCount;
+        }
+        stats.capacity += other.stats.capacity;
+        stats.liveNodes += other.stats.liveNodes;
+
+        other.slabs = Vector<Slab>();
+        other.freeList = other.freeTail = other.bump = other.bumpEnd = nullptr;
+        other.freeCount = 0;
+        other.stats.capacity = 0;
+        other.stats.liveNodes = 0;
+    }
+
+    /**
+     * A run of contiguous slots handed out by claim(), not constructed yet.
+     */
+    class Block {
+        Slot* first{};
+        friend class NodePool;
+
+    public:
+        [[nodiscard]] void* at(const std::size_t i) const { return first[i].storage; }
+    };
+
+    /**
+     * Takes n never-used slots in one run and counts them as live nodes. The
+     * caller constructs the i-th with new (block.at(i)) NodeT(...); different
+     * slots may be constructed from different threads.
+     */
+    Block claim(const std::size_t n) {
+        if (static_cast<std::size_t>(bumpEnd - bump) < n) grow(n);
+        Block block;
+        block.first = bump;
+        bump += n;
+        stats.nodesServed += n;
+        stats.liveNodes += n;
+        return block;
+    }
+
+    /**
+     * Makes sure at least n more nodes can be created without touching the heap.
+     */
+    void reserve(std::size_t n) {
+        const std::size_t available = freeCount + static_cast<std::size_t>(bumpEnd - bump);
+        if (available >= n) return;
+        grow(n - available);
+    }
+
+    /**
+     * Returns every slab that holds no live node back to the heap.
+     */
+    void shrink_to_fit() {
+        if (stats.liveNodes == 0) {
+            const PoolStats kept = stats;
+            releaseSlabs();
+            stats.nodesServed = kept.nodesServed;
+            stats.slabAllocations = kept.slabAllocations;
+            return;
+        }
+        // the unused tail of the bump region counts as free
+        while (bump != bumpEnd) release(bump++);
+        bump = bumpEnd = nullptr;
+
+        const unsigned int nSlabs = slabs.size();
+        auto* order = new unsigned int[nSlabs];
+        auto* freeIn = new std::size_t[nSlabs]{};
+        for (unsigned int i = 0; i < nSlabs; i++) order[i] = i;
+        std::sort(order, order + nSlabs, [this](unsigned int a, unsigned int b) {
+            return std::less<Slot*>()(slabs[a].slots, slabs[b].slots);
+        });
+        // map every free slot to the slab it lives in
+        auto slabOf = [&](const Slot* slot) {
+            unsigned int lo = 0, hi = nSlabs;
+            while (hi - lo > 1) {
+                const unsigned int mid = (lo + hi) / 2;
+                if (std::less<const Slot*>()(slot, slabs[order[mid]].slots)) hi = mid;
+                else lo = mid;
+            }
+            return order[lo];
+        };
+        for (const Slot* s = freeList; s; s = s->next) freeIn[slabOf(s)]++;
+
+        // unlink slots of empty slabs from the free list, then drop the slabs
+        Slot** link = &freeList;
+        while (*link) {
+            if (const unsigned int idx = slabOf(*link); freeIn[idx] == slabs[idx].count) {
+                *link = (*link)->next;
+                freeCount--;
+            } else {
+                link = &(*link)->next;
+            }
+        }
+        // next is the slot's first member, so the last link field is the tail slot
+        freeTail = freeList ? reinterpret_cast<Slot*>(link) : nullptr;
+        Vector<Slab> kept;
+        for (unsigned int i = 0; i < nSlabs; i++) {
+            if (freeIn[i] == slabs[i].count) {
+                stats.capacity -= slabs[i].count;
+                ::operator delete(slabs[i].slots);
+            } else {
+                kept.push_back(slabs[i]);
+            }
+        }
+        slabs = std::move(kept);
+        delete[] order;
+        delete[] freeIn;
+    }
+
+    [[nodiscard]] const PoolStats& getStats() const { return stats; }
+};
+
+#endif //SCAPEGOATPROJECT_NODE_POOL_HPP
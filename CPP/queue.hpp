@@ -4,27 +4,36 @@
 
 #ifndef TREE_QUEUE_HPP
 #define TREE_QUEUE_HPP
+#include <utility>
 
-template<typename T>
-class QNode {
-    QNode* next{};
-    T value{};
-    explicit QNode(T value): value(value){}
-    template<typename>
-    friend class Queue;
-};
+/**
+ * FIFO queue in a ring buffer: push and pop never allocate while the queue
+ * stays within its capacity, which doubles when it fills up.
+ */
 template<typename T>
 class Queue {
-    QNode<T>* head{};
-    QNode<T>* tail{};
+    T* data{};
+    int capacity{};
+    int head{}; // index of the front element
     int nNodes{};
+
+    /**
+     * Moves the elements, front first, into a buffer of the given capacity.
+     */
+    void regrow(int newCapacity);
 public:
+    Queue() = default;
+    /**
+     * Destroys the queue and releases its buffer.
+     */
+    ~Queue() { delete[] data; }
+    Queue(const Queue&) = delete;
+    Queue& operator=(const Queue&) = delete;
+
     /**
-     * Destroys the queue and releases memory by popping all elements.
+     * Makes room for n elements up front, so that many pushes do not allocate.
      */
-    ~Queue() {  
-        while (!isEmpty()) pop();
-    }
+    void reserve(int n);
 
     /**
      * Adds a new value to the back of the queue.
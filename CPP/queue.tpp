@@ -11,22 +11,28 @@
 
 #include "queue.hpp"
 
+template<typename T>
+void Queue<T>::regrow(const int newCapacity) {
+    T* fresh = new T[newCapacity];
+    for (int i = 0; i < nNodes; i++) fresh[i] = std::move(data[(head + i) % capacity]);
+    delete[] data;
+    data = fresh;
+    capacity = newCapacity;
+    head = 0;
+}
+
+template<typename T>
+void Queue<T>::reserve(const int n) {
+    if (n > capacity) regrow(n);
+}
+
 /**
  * Adds a new value to the back of the queue.
  */
 template<typename T>
 void Queue<T>::push(T value) {
-    if (!head) {
-        auto newNode = new QNode<T>(value);
-        head = newNode;
-        tail = head;
-        nNodes++;
-        return;
-    }
-    QNode<T>* last = tail;
-    auto newNode = new QNode<T>(value);
-   last->next = newNode;
-    tail = newNode;
+    if (nNodes == capacity) regrow(capacity ? capacity * 2 : 16);
+    data[(head + nNodes) % capacity] = std::move(value);
     nNodes++;
 }
 
@@ -35,11 +41,8 @@ void Queue<T>::push(T value) {
  */
 template<typename T>
 void Queue<T>::pop() {
-    if (!head)return;
-    QNode<T>* curr = head;
-    head = curr->next;
-    delete curr;
-    if (!head) tail = nullptr;
+    if (!nNodes) return;
+    head = (head + 1) % capacity;
     nNodes--;
 }
 
@@ -48,7 +51,7 @@ void Queue<T>::pop() {
  */
 template<typename T>
 bool Queue<T>::isEmpty() const {
-    return !head;
+    return nNodes == 0;
 }
 
 /**
@@ -56,8 +59,8 @@ bool Queue<T>::isEmpty() const {
  */
 template<typename T>
 T Queue<T>::front() {
-    if (!head) return T{};
-    return head->value;
+    if (!nNodes) return T{};
+    return data[head];
 }
 
 /**
@@ -0,0 +1,120 @@
+/**
+ * ScapeGoatTree with lock-free readers (read-copy-update).
+ *
+ * Writers work on a private copy-on-write tree: every node a reader may see is
+ * frozen, so inserts and deletes copy their path and rebuilds build fresh
+ * subtrees. Once a write is done, its new root is published with a single
+ * atomic store. Readers pin the current version and walk it without locks.
+ *
+ * Replaced nodes are reclaimed by epoch: a reader announces the epoch it started
+ * in, and a node that left the tree at epoch d is freed only once every active
+ * reader started at or after d.
+ *
+ * Writers are serialized by a mutex that readers never touch. At most
+ * READER_SLOTS readers can be pinned at once; further readers spin until a slot frees.
+ */
+#ifndef SCAPEGOATPROJECT_RCU_SCAPEGOAT_TREE_HPP
+#define SCAPEGOATPROJECT_RCU_SCAPEGOAT_TREE_HPP
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+#include "scapegoat_tree.hpp"
+
+template<typename T, typename Aggregate = NoAggregate>
+class RcuScapeGoatTree {
+    using Tree = ScapeGoatTree<T, Aggregate>;
+    using TreeNode = typename Tree::TreeNode;
+    static constexpr unsigned int READER_SLOTS = 64;
+    /**
+     * One pinned reader: 0 when free, otherwise its start epoch + 1.
+     */
+    struct alignas(64) ReaderSlot {
+        std::atomic<std::uint64_t> pin{0};
+    };
+
+    Tree tree; // the writers' copy; only touched under writer, and never undone
+    std::mutex writer;
+    std::atomic<const TreeNode*> published{nullptr};
+    std::atomic<std::uint64_t> publishedEpoch{0};
+    mutable ReaderSlot readers[READER_SLOTS];
+
+    /**
+     * Makes the writer's tree visible to new readers and frees what no reader can reach.
+     */
+    void publish();
+
+public:
+    /**
+     * A pinned version of the tree. Every query on it sees the same version;
+     * the nodes stay valid until the guard is destroyed.
+     */
+    class ReadGuard {
+        std::atomic<std::uint64_t>* slot{};
+        const TreeNode* root{};
+        friend class RcuScapeGoatTree;
+        ReadGuard(std::atomic<std::uint64_t>* s, const TreeNode* r) : slot(s), root(r) {}
+
+    public:
+        using iterator = typename Tree::Snapshot::iterator;
+        ReadGuard(ReadGuard&& other) noexcept : slot(other.slot), root(other.root) { other.slot = nullptr; }
+        ReadGuard(const ReadGuard&) = delete;
+        ReadGuard& operator=(const ReadGuard&) = delete;
+        ReadGuard& operator=(ReadGuard&&) = delete;
+        ~ReadGuard() { if (slot) slot->store(0, std::memory_order_release); }
+
+        [[nodiscard]] bool search(const T& key) const { return Tree::searchIn(root, key); }
+        /**
+         * Smallest key greater than value; throws std::runtime_error if there is none.
+         */
+        T getSuccessor(const T& value) const;
+        T sumInRange(T min, T max) const { return Tree::sumIn(root, min, max); }
+        template<typename Op = Aggregate>
+        typename Op::value_type aggregateInRange(const T& min, const T& max) const {
+            return Tree::template aggregateIn<Op>(root, min, max);
+        }
+        T kthSmallest(int k) const;
+        [[nodiscard]] int size() const { return root ? static_cast<int>(root->size) : 0; }
+        iterator begin() const { return iterator(root); }
+        iterator end() const { return iterator(nullptr); }
+    };
+
+    RcuScapeGoatTree() { tree.isUndoing = true; } // nothing reads the writers' history
+    ~RcuScapeGoatTree() { tree.dropVersions(); }
+    RcuScapeGoatTree(const RcuScapeGoatTree&) = delete;
+    RcuScapeGoatTree& operator=(const RcuScapeGoatTree&) = delete;
+
+    /**
+     * Pins the current version without taking a lock. Hold the guard only as
+     * long as needed: nothing replaced after it was taken can be freed meanwhile.
+     */
+    ReadGuard read() const;
+
+    // one-shot reads, each on the version current at the call
+    [[nodiscard]] bool search(const T& key) const { return read().search(key); }
+    T getSuccessor(const T& value) const { return read().getSuccessor(value); }
+    T sumInRange(T min, T max) const { return read().sumInRange(min, max); }
+    T kthSmallest(int k) const { return read().kthSmallest(k); }
+    [[nodiscard]] int size() const { return read().size(); }
+
+    void insert(const T& value);
+    bool deleteValue(const T& value);
+    /**
+     * Inserts the whole batch, then publishes once.
+     */
+    void insertBatch(const Vector<T>& values);
+    void deleteBatch(const Vector<T>& values);
+    void clear();
+
+    /**
+     * Replaced nodes still waiting for readers to move on (for tests/benchmarks).
+     */
+    [[nodiscard]] std::size_t pendingReclaim();
+    [[nodiscard]] PoolStats poolStats();
+    /**
+     * Undo commands the writers' tree holds; stays 0 (for tests).
+     */
+    [[nodiscard]] unsigned int historySize();
+};
+#include "rcu_scapegoat_tree.tpp"
+
+#endif //SCAPEGOATPROJECT_RCU_SCAPEGOAT_TREE_HPP
@@ -0,0 +1,115 @@
+#ifndef SCAPEGOATPROJECT_RCU_SCAPEGOAT_TREE_TPP
+#define SCAPEGOATPROJECT_RCU_SCAPEGOAT_TREE_TPP
+#include <stdexcept>
+#include <thread>
+// =====================
+// Readers
+// =====================
+
+/**
+ * Claims a free slot and announces the published epoch before loading the
+ * root. Both are sequentially consistent, so a writer either sees the pin or
+ * has already published a root at least as new as the announced epoch.
+ */
+template<typename T, typename Aggregate>
+typename RcuScapeGoatTree<T, Aggregate>::ReadGuard RcuScapeGoatTree<T, Aggregate>::read() const {
+    static std::atomic<unsigned int> nextStart{0};
+    thread_local const unsigned int start = nextStart.fetch_add(1, std::memory_order_relaxed);
+    for (unsigned int attempt = 0;; attempt++) {
+        std::atomic<std::uint64_t>& pin = readers[(start + attempt) % READER_SLOTS].pin;
+        std::uint64_t idle = 0;
+        if (pin.compare_exchange_strong(idle, publishedEpoch.load() + 1))
+            return ReadGuard(&pin, published.load());
+        if (attempt % READER_SLOTS == READER_SLOTS - 1) std::this_thread::yield(); // every slot is taken
+    }
+}
+
+template<typename T, typename Aggregate>
+T RcuScapeGoatTree<T, Aggregate>::ReadGuard::getSuccessor(const T& value) const {
+    const TreeNode* successor = Tree::successorIn(root, value);
+    if (!successor) throw std::runtime_error("No successor found");
+    return successor->value;
+}
+
+template<typename T, typename Aggregate>
+T RcuScapeGoatTree<T, Aggregate>::ReadGuard::kthSmallest(const int k) const {
+    if (k < 1 || k > size()) throw std::out_of_range("k is out of bounds");
+    return Tree::kthSmallestHelper(root, k);
+}
+
+// =====================
+// Writers
+// =====================
+
+/**
+ * Nodes replaced before this version left the tree at an epoch <= version;
+ * they are freed unless a reader pinned an older version.
+ */
+template<typename T, typename Aggregate>
+void RcuScapeGoatTree<T, Aggregate>::publish() {
+    const std::uint64_t version = tree.publishVersion();
+    published.store(tree.root);
+    publishedEpoch.store(version);
+    std::uint64_t oldest = version;
+    for (const ReaderSlot& reader : readers) {
+        const std::uint64_t pin = reader.pin.load();
+        if (pin && pin - 1 < oldest) oldest = pin - 1;
+    }
+    tree.reclaimRetired(oldest);
+}
+
+template<typename T, typename Aggregate>
+void RcuScapeGoatTree<T, Aggregate>::insert(const T& value) {
+    std::lock_guard guard(writer);
+    tree.insert(value);
+    publish();
+}
+
+template<typename T, typename Aggregate>
+bool RcuScapeGoatTree<T, Aggregate>::deleteValue(const T& value) {
+    std::lock_guard guard(writer);
+    const bool removed = tree.deleteValue(value);
+    if (removed) publish();
+    return removed;
+}
+
+template<typename T, typename Aggregate>
+void RcuScapeGoatTree<T, Aggregate>::insertBatch(const Vector<T>& values) {
+    std::lock_guard guard(writer);
+    tree.insertBatch(values);
+    publish();
+}
+
+template<typename T, typename Aggregate>
+void RcuScapeGoatTree<T, Aggregate>::deleteBatch(const Vector<T>& values) {
+    std::lock_guard guard(writer);
+    tree.deleteBatch(values);
+    publish();
+}
+
+template<typename T, typename Aggregate>
+void RcuScapeGoatTree<T, Aggregate>::clear() {
+    std::lock_guard guard(writer);
+    tree.clear();
+    publish();
+}
+
+template<typename T, typename Aggregate>
+std::size_t RcuScapeGoatTree<T, Aggregate>::pendingReclaim() {
+    std::lock_guard guard(writer);
+    return tree.retired.size();
+}
+
+template<typename T, typename Aggregate>
+PoolStats RcuScapeGoatTree<T, Aggregate>::poolStats() {
+    std::lock_guard guard(writer);
+    return tree.poolStats();
+}
+
+template<typename T, typename Aggregate>
+unsigned int RcuScapeGoatTree<T, Aggregate>::historySize() {
+    std::lock_guard guard(writer);
+    return tree.historySize();
+}
+
+#endif //SCAPEGOATPROJECT_RCU_SCAPEGOAT_TREE_TPP
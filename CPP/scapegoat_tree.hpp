@@ -18,16 +18,39 @@
  * - Delete: O(log n) amortized, O(n) worst case during rebuild
  * - Search: O(log n) worst case (tree stays balanced)
  *
- * Space Complexity: O(n) for tree + O(n) temporary array during rebuild
+ * Space Complexity: O(n) for tree; rebuilds relink the existing nodes in place
+ *
+ * Nodes are allocated from a per-tree slab pool (see node_pool.hpp) and
+ * recycled through its free list instead of going through new/delete.
+ *
+ * snapshot() returns an O(1) read-only view. While one is alive, writes copy
+ * the nodes they would change (path copying) and rebuilds build fresh nodes;
+ * replaced nodes are freed once no live snapshot can see them.
+ *
+ * With setBackgroundRebuild, large rebuilds run on a worker thread instead:
+ * it builds a balanced copy from a snapshot, replays the writes made
+ * meanwhile, and the next insert/delete swaps it in. setIncrementalRebuild
+ * does the same work on the caller's thread, a bounded number of steps per
+ * insert/delete.
  */
 #ifndef SCAPEGOATTREE_SCAPEGOATTREE_HPP
 #define SCAPEGOATTREE_SCAPEGOATTREE_HPP
 
 #include <string>
 #include <cmath>
+#include <type_traits>
+#include <iterator>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <thread>
 #include "vector.hpp"
 #include "stack.hpp"
 #include "Node.hpp"
+#include "node_pool.hpp"
+#include "task_pool.hpp"
+#include "frozen_scapegoat_set.hpp"
 /**
  * Represents the type of operation performed on the tree for undo/redo purposes.
  */
@@ -49,11 +72,34 @@ struct Command {
     T value;     // Value associated with the operation
 };
 
-template<typename T>
+/**
+ * Aggregate selects an optional per-node subtree aggregate (see aggregates.hpp).
+ * With e.g. SumAggregate<T>, sumInRange/aggregateInRange run in O(log n).
+ */
+template<typename T, typename Aggregate>
+class RcuScapeGoatTree;
+template<typename T, typename Aggregate>
+class ConcurrentScapeGoatTree;
+template<typename T, typename Aggregate>
+class ShardedScapeGoatTree;
+template<typename T, typename Aggregate, typename Features>
+class CompactScapeGoatTree;
+
+template<typename T, typename Aggregate = NoAggregate>
 class ScapeGoatTree {
+    friend class RcuScapeGoatTree<T, Aggregate>;
+    friend class ConcurrentScapeGoatTree<T, Aggregate>;
+    friend class ShardedScapeGoatTree<T, Aggregate>;
+    template<typename, typename, typename>
+    friend class CompactScapeGoatTree; // shares the helpers that do not depend on the node layout
 
-    using TreeNode = Node<T>;
+    using TreeNode = Node<T, Aggregate>;
+    static constexpr bool hasAggregate = !std::is_same_v<Aggregate, NoAggregate>;
     TreeNode* root{};
+    /**
+     * Slab allocator every node of this tree is created from and returned to.
+     */
+    NodePool<TreeNode> pool;
     int nNodes{};
     int rebuildCount = 0;
     /**
@@ -67,10 +113,100 @@ class ScapeGoatTree {
     /**
      * Flag to prevent operations triggered by undo/redo from being recorded.
      * This avoids infinite recursion and keeps the undo history clean.
+     * Trees nobody undoes (rebuild jobs, the trees inside the concurrent
+     * wrappers) keep it set for good, so their history never grows.
      */
     bool isUndoing = false;
     int max_nodes = 0;
     double ALPHA = 2.0/3.0;
+    /**
+     * Scratch buffer holding the current descent path. It is reused by every
+     * insert/delete, so the hot paths never allocate once it has grown.
+     */
+    Vector<TreeNode*> path;
+    /**
+     * Number of nodes touched by insert/delete descents (for benchmarking).
+     */
+    std::size_t nodeVisits = 0;
+    /**
+     * Batches at least this fraction of the tree's size skip per-key inserts
+     * and are merged into the in-order sequence with a single rebuild.
+     */
+    double batchRebuildRatio = 0.05;
+    /**
+     * Threads a rebuild of at least PARALLEL_REBUILD_MIN nodes may use (1 = serial).
+     */
+    int rebuildThreads = 1;
+    /**
+     * Pool the parallel operations fork on; nullptr means TaskPool::shared().
+     */
+    TaskPool* executor = nullptr;
+
+    /**
+     * Source of snapshot epochs, shared by every tree so node births stay
+     * comparable when nodes move between trees (split/join/unionWith). 64 bits:
+     * an RCU tree publishes an epoch per write, and a wrapped clock would make
+     * old pins look newer than the nodes they still read.
+     */
+    inline static std::atomic<std::uint64_t> snapshotClock{0};
+    /**
+     * Birth stamp for new nodes: one past the epoch of this tree's latest snapshot.
+     */
+    std::uint64_t epoch = 0;
+    /**
+     * Nodes born before this epoch may be seen by a live snapshot and must not
+     * be modified (0 when no snapshot is alive).
+     */
+    std::uint64_t sharedBelow = 0;
+    struct SnapshotState;
+    /**
+     * Snapshots handed out by this tree; expired ones are dropped lazily.
+     */
+    Vector<std::weak_ptr<SnapshotState>> snapshots;
+    /**
+     * A node replaced while snapshots were alive, with the epoch it left the tree in.
+     */
+    struct Retired {
+        TreeNode* node{};
+        std::uint64_t death{};
+    };
+    Vector<Retired> retired;
+    /**
+     * Rebuilds of at least this many nodes go to a worker thread (0 = never).
+     */
+    int backgroundRebuildMin = 0;
+    /**
+     * Rebuilds of at least this many nodes move them into a fresh van Emde
+     * Boas block instead of relinking them in place (0 = never).
+     */
+    int compactRebuildMin = 0;
+    /**
+     * Steps of incremental rebuild work each insert/delete does; rebuilds of
+     * more than stepLimit() nodes are spread over later operations (0 = never).
+     */
+    int rebuildBudget = 0;
+    /**
+     * Set on an incremental job's fresh tree: replaying the log only does the
+     * small rebuilds, and the live tree takes care of larger ones after the swap.
+     */
+    bool isReplaying = false;
+    struct RebuildJob;
+    /**
+     * The background or incremental rebuild in flight, if any.
+     */
+    std::unique_ptr<RebuildJob> rebuildJob;
+    /**
+     * Frees the nodes of a tree replaced by a background rebuild, when they
+     * need destructors.
+     */
+    std::thread reaper;
+    /**
+     * Nodes an incremental rebuild replaced, freed a few per operation: loose
+     * retired nodes, and whole subtrees taken apart as they go.
+     */
+    Vector<Retired> condemned;
+    unsigned int condemnedAt = 0;
+    Stack<TreeNode*> condemnedTrees;
     // iterator class
     class iterator {
         TreeNode* curr;  // stores current node
@@ -99,6 +235,161 @@ class ScapeGoatTree {
         bool operator!=(const iterator& other) const { return curr != other.curr; }
     };
 
+    /**
+     * What a snapshot sees. keepAlive owns the nodes if the tree goes away first.
+     */
+    struct SnapshotState {
+        const TreeNode* root{};
+        int nNodes{};
+        std::uint64_t epoch{};
+        std::shared_ptr<void> keepAlive;
+    };
+    /**
+     * Pool and nodes left behind for live snapshots by a tree that was destroyed
+     * (or detached from them). Freed with the last of those snapshots; the tree
+     * is only walked then, and only when nodes need destructors.
+     */
+    struct Orphans {
+        NodePool<TreeNode> pool;
+        Stack<TreeNode*> trees; // the tree and condemned subtrees
+        Vector<Retired> loose;  // retired and condemned nodes
+        ~Orphans() {
+            if constexpr (!std::is_trivially_destructible_v<TreeNode>) {
+                for (unsigned int i = 0; i < loose.size(); i++) pool.destroy(loose[i].node);
+                Stack<TreeNode*>& todo = trees;
+                while (!todo.isEmpty()) {
+                    TreeNode* node = todo.pop();
+                    if (node->left) todo.push(node->left);
+                    if (node->right) todo.push(node->right);
+                    pool.destroy(node);
+                }
+            }
+        }
+    };
+
+    /**
+     * Creates a node stamped with the current epoch.
+     */
+    template<typename... Args>
+    TreeNode* makeNode(Args&&... args) {
+        TreeNode* node = pool.create(std::forward<Args>(args)...);
+        node->birth = epoch;
+        return node;
+    }
+    /**
+     * True if a live snapshot may see the node, so it must not be modified.
+     */
+    [[nodiscard]] bool isFrozen(const TreeNode* node) const { return node->birth < sharedBelow; }
+    /**
+     * Frees a node that left the tree, or parks it until no snapshot can see it.
+     */
+    void dispose(TreeNode* node);
+    /**
+     * Replaces the frozen nodes among path[0..depth) by private copies, so the
+     * caller can modify the recorded path in place.
+     */
+    void unsharePath(int depth);
+    /**
+     * Like flattenNodes, but frozen nodes are replaced by fresh copies first.
+     */
+    TreeNode* flattenOwned(TreeNode* node, TreeNode* head);
+    /**
+     * Forgets expired snapshots and frees retired nodes none of the rest can see.
+     */
+    void collectSnapshots();
+    /**
+     * Hands the pool and every node over to the live snapshots. With
+     * keepContents the tree first copies its contents into a fresh pool, so it
+     * stays usable with no node shared any more.
+     */
+    void orphanSnapshots(bool keepContents);
+    /**
+     * RCU support for RcuScapeGoatTree: freezes every node, so later writes copy
+     * instead of modifying, and returns the epoch of the version readers now see.
+     */
+    std::uint64_t publishVersion();
+    /**
+     * Frees the retired nodes that left the tree at or before oldestReader.
+     */
+    void reclaimRetired(std::uint64_t oldestReader);
+    /**
+     * With no reader left: frees every retired node and unfreezes the tree.
+     */
+    void dropVersions();
+
+    /**
+     * True if a rebuild of this many nodes is left to a rebuild job.
+     */
+    [[nodiscard]] bool deferRebuild(const int nodes) const {
+        return (backgroundRebuildMin && nodes >= backgroundRebuildMin) || (rebuildBudget && nodes > stepLimit());
+    }
+    /**
+     * Incremental mode: the most steps any one operation does, budget times the height bound.
+     */
+    [[nodiscard]] int stepLimit() const { return rebuildBudget * (getThreshold() + 1); }
+    /**
+     * Starts rebuilding the subtree of path[goat] (the whole tree for -1) as a
+     * job: on a worker thread, or step by step.
+     */
+    void startRebuild(int goat);
+    /**
+     * True while a rebuild job or condemned nodes wait for the next operation.
+     */
+    [[nodiscard]] bool rebuildWork() const {
+        return rebuildJob || condemnedAt < condemned.size() || !condemnedTrees.isEmpty();
+    }
+    /**
+     * Called before each insert/delete: frees some condemned nodes, swaps in a
+     * finished rebuild and lets go of the worker's view once it has been
+     * copied. In incremental mode it does the operation's share of the work instead.
+     */
+    void pollRebuild();
+    /**
+     * Incremental mode: advances the job by up to steps steps.
+     */
+    void advanceRebuild(int steps);
+    /**
+     * Frees up to steps condemned nodes.
+     */
+    void reclaimCondemned(int steps);
+    /**
+     * Condemned nodes each insert/delete frees in background mode.
+     */
+    static constexpr int RECLAIM_STEPS = 64;
+    /**
+     * Moves the pool into orphans together with every node in it that they
+     * must free: the tree, retired and condemned nodes.
+     */
+    void handOver(Orphans& orphans);
+    /**
+     * Lets go of the job's view; with no other snapshot alive, the nodes it
+     * kept are condemned instead of being freed all at once.
+     */
+    void releaseView();
+    /**
+     * Replays the writes the worker has not seen and swaps its tree in.
+     */
+    void finishRebuild();
+    /**
+     * Stops the worker and drops its work; the tree is left as it is. Nodes
+     * still condemned are freed now.
+     */
+    void cancelRebuild();
+    /**
+     * Forwards a write to the pending rebuild (no-op without one).
+     */
+    void logChange(OpType type, const T& value);
+    static void runRebuild(RebuildJob* job);
+
+    /**
+     * Read-only queries on a root, shared by the tree, its snapshots and RCU readers.
+     */
+    static bool searchIn(const TreeNode* node, const T& key);
+    static const TreeNode* successorIn(const TreeNode* node, const T& value);
+    static T sumIn(const TreeNode* node, T min, T max);
+    template<typename Op>
+    static typename Op::value_type aggregateIn(const TreeNode* node, const T& min, const T& max);
+
     /**
      * Calculates the height of a given node in the tree.
      */
@@ -108,25 +399,212 @@ class ScapeGoatTree {
      */
     static  unsigned int countN(const TreeNode* node);
     /**
-     * Finds the highest node that violates the alpha-weight-balance property.
+     * Walks the recorded insertion path bottom-up and returns the index of the
+     * first node that violates the alpha-weight-balance property, or -1.
      */
-    TreeNode* findTraitor(TreeNode* node);
+    int findTraitor(int depth) const;
     /**
-     * Recursively rebuilds a balanced BST from a sorted array of values.
+     * Builds a balanced BST from the sorted values array[start..end], in one
+     * block of slots laid out in van Emde Boas order.
      */
     TreeNode* rebuildTree(int start,int end,TreeNode* parent_node,T* array);
+    /**
+     * Threads the subtree's nodes into an in-order list through their right
+     * pointers, followed by head. Returns the first node of the list.
+     */
+    static TreeNode* flattenNodes(TreeNode* node, TreeNode* head);
+    /**
+     * Relinks the first n nodes of a right-threaded list into a perfectly
+     * balanced subtree, fixing size and parent. Advances head past them.
+     */
+    static TreeNode* buildFromList(int n, TreeNode*& head, TreeNode* parent_node);
+    /**
+     * Rebuilds the subtree rooted at node in place and returns its new root.
+     */
+    TreeNode* rebuildSubtree(TreeNode* node, TreeNode* parent_node);
+    /**
+     * Rebuilds, traversals and range queries over this many nodes fork when
+     * more than one thread is allowed.
+     */
+    static constexpr int PARALLEL_REBUILD_MIN = 1 << 15;
+    /**
+     * How many more levels of a parallel operation may fork, and on which pool.
+     */
+    struct Forks {
+        TaskPool* pool = nullptr;
+        int levels = 0;
+        [[nodiscard]] Forks next() const { return {pool, levels - 1}; }
+        explicit operator bool() const { return levels > 0; }
+    };
+    /**
+     * Levels of forking that split the work in at least threads tasks.
+     */
+    [[nodiscard]] Forks forksFor(int threads) const;
+    /**
+     * How many levels of a rebuild of n nodes may still fork; none runs it serially.
+     */
+    [[nodiscard]] Forks forkLevels(int n) const;
+    /**
+     * Hands first to the executor and runs second here, and waits for both.
+     * With no forks left both run here.
+     */
+    template<typename First, typename Second>
+    static void forkJoin(Forks forks, First&& first, Second&& second);
+    /**
+     * Writes the subtree's nodes (or values) in order to out. Every node's
+     * slot follows from its left subtree's size, so the halves are independent.
+     */
+    static void collectNodes(TreeNode* node, TreeNode** out, Forks forks);
+    static void collectValues(const TreeNode* node, T* out, Forks forks);
+    /**
+     * Parallel buildFromList: links n in-order nodes into the same balanced shape.
+     */
+    static TreeNode* linkNodes(TreeNode** nodes, int n, TreeNode* parent_node, Forks forks);
+    /**
+     * Builds the n values from array[start] as a balanced subtree; the node
+     * of rank r goes to slot slotOf[r] of block.
+     */
+    TreeNode* buildNodes(T* array, int start, int n, TreeNode* parent_node,
+                         typename NodePool<TreeNode>::Block block, const int* slotOf, Forks forks);
+    /**
+     * Slot of every rank of a balanced subtree of n nodes (the shape
+     * rebuildTree builds) in van Emde Boas order: the top half of the levels
+     * first, then each subtree hanging below them, each laid out the same way
+     * recursively. Any path of h nodes then spans about h / log2(B) blocks of
+     * B nodes, whatever B is. Allocated with new[].
+     */
+    static int* vebLayout(int n);
+    /**
+     * Gives the top levels levels of the balanced subtree of ranks
+     * [start, start + n) the slots from first on; returns how many it gave.
+     */
+    static int vebSlots(int start, int n, int levels, int first, int* slotOf);
+    /**
+     * Rebuilds the subtree into a fresh vebLayout block of into, moving each
+     * value out of its old node (copying it if a snapshot can still see the node).
+     * The old nodes go back to this tree's pool, or with discardPool, which
+     * the caller is about to drop whole, only have their destructors run.
+     */
+    TreeNode* relocateSubtree(TreeNode* node, TreeNode* parent_node, NodePool<TreeNode>& into, bool discardPool = false);
+    /**
+     * Sorts an array and drops duplicates; returns the new length.
+     */
+    static int sortUnique(T* array, int n);
+    /**
+     * sortUnique on up to rebuildThreads threads for large arrays. The keys
+     * may end up in a new array, which then replaces array (allocated with new[]).
+     */
+    int sortKeys(T*& array, int n) const;
+    /**
+     * Merge sort of src[0, n): both halves are sorted in parallel, then merged
+     * in parallel. The result ends up in other if toOther, else in src.
+     */
+    static void parallelSort(T* src, T* other, int n, Forks forks, bool toOther);
+    /**
+     * Moves the merge of two sorted runs to out, splitting it at the middle key
+     * of the longer run so both sides can run in parallel.
+     */
+    static void parallelMerge(T* a, int na, T* b, int nb, T* out, Forks forks);
+    /**
+     * Moves the distinct keys of the sorted src to dst; returns how many there are.
+     */
+    static int parallelUnique(T* src, int n, T* dst, Forks forks);
+    /**
+     * Replaces the contents with the n sorted, distinct values in array in O(n).
+     * The values are moved out of the array.
+     */
+    void assignArray(T* array, int n, bool recordUndo);
+    /**
+     * Bulk insertBatch path: sorts the batch, merges it into the tree's in-order
+     * node list and rebuilds once in O(n + m log m).
+     */
+    void mergeBatch(const Vector<T>& values);
+    /**
+     * Bulk deleteBatch path: sorts the victims, removes them from the tree's
+     * in-order node list by linear set difference and rebuilds once.
+     */
+    void subtractBatch(const Vector<T>& values);
+    /**
+     * Which keys a linear merge of two sorted arrays keeps (bit flags).
+     */
+    enum MergeKeep : int { KeepLeft = 1, KeepBoth = 2, KeepRight = 4 };
+    /**
+     * Linear merge of two sorted, distinct arrays. Writes the kept keys to out
+     * (if not null) and returns how many there are.
+     */
+    static int mergeKeys(const T* a, int na, const T* b, int nb, int keep, T* out);
+    /**
+     * Marks found[i] for every keys[i] in [lo, hi) present in the subtree. Each
+     * node splits the probe range, so m sorted keys cost O(m log(n/m)).
+     */
+    static void matchKeys(const TreeNode* node, const T* keys, int lo, int hi, bool* found);
+    /**
+     * Below this many probes a batched descent walks each one on its own: the
+     * nodes they still share are few and already cached, and the recursion
+     * costs more than it saves.
+     */
+    static constexpr int BATCH_SPLIT_MIN = 16;
+    /**
+     * Batched descent behind searchBatch/findBatch/successorBatch: sorted
+     * keys[lo, hi) are split at every node, so a node shared by many probes
+     * is compared once per range, not once per key, and the probes reach the
+     * lower levels in key order. match(i, node) is called for each key equal
+     * to a node's. With Successors, end(i, successor) is called instead with
+     * the smallest node above each key (nullptr if none).
+     */
+    template<bool Successors, typename Match, typename End>
+    static void descendBatch(TreeNode* node, const T* keys, int lo, int hi, TreeNode* successor, Match& match, End& end);
+    /**
+     * Runs descendBatch over keys[0, m), sorting a copy first unless they are
+     * sorted already. Callbacks get indices into keys.
+     */
+    template<bool Successors, typename Match, typename End>
+    void lookupBatch(const T* keys, int m, Match match, End end) const;
+    /**
+     * Cost model: true when probing the large tree with the small one's keys
+     * beats a linear merge of both.
+     */
+    static bool preferSearch(int small, int large);
+    /**
+     * Returns the tree's keys as a new sorted array of nNodes elements.
+     */
+    T* sortedKeys() const;
+    /**
+     * Splits a subtree into the keys < key and the keys >= key by relinking the
+     * nodes on one root-to-leaf path. Sizes and aggregates are fixed on the way up.
+     */
+    static void splitNodes(TreeNode* node, const T& key, TreeNode*& less, TreeNode*& greaterEq);
+    /**
+     * Unlinks the smallest (or largest) node of a subtree and returns it.
+     */
+    static TreeNode* detachExtreme(TreeNode*& subRoot, bool smallest);
+    /**
+     * Hangs all of donor's keys, which lie entirely above (or below) ours, into
+     * this tree along one spine. When that spine needs rebalancing, the rebuilt
+     * subtree holds at least donor's keys and at most the whole tree: O(n) at worst.
+     */
+    void graft(ScapeGoatTree& donor, bool donorAbove);
+    /**
+     * Pushes one command of the given type per value in the subtree (for undo).
+     */
+    void recordValues(const TreeNode* node, OpType type);
     /**
      * Performs an in-order traversal to populate a sorted array with node values.
      */
     void inorderTraversal(const TreeNode*node, int &i,T*& array) const;
     /**
-     * Recursively deletes all nodes in the subtree using post-order traversal.
+     * Recursively returns all nodes in the subtree to the pool using post-order traversal.
+     */
+    void postorderTraversal(TreeNode* node);
+    /**
+     * Clones a subtree node for node (pre-order), copying values, sizes and
+     * aggregates as they are. Nodes come from this tree's pool.
      */
-    static void postorderTraversal(const TreeNode* node);
+    TreeNode* cloneSubtree(const TreeNode* node, TreeNode* parent_node);
     /**
-     * Performs a pre-order traversal for internal processing.
+     * Makes this (empty) tree a structural copy of other in O(n).
      */
-    void preorderTraversal(const TreeNode* node);
+    void copyFrom(const ScapeGoatTree& other);
     /**
      * Formats the tree in pre-order.
      */
@@ -152,12 +630,60 @@ class ScapeGoatTree {
      */
     bool areTreesEqual(const TreeNode* n1, const TreeNode* n2) const;
     /**
-     * Initiates a subtree rebuild starting from the scapegoat node.
+     * Descends towards value recording the path. Returns the depth at which a
+     * new node would hang, or -1 if the value is already present.
+     */
+    int descend(const T& value);
+    /**
+     * Hangs a detached node below the end of the recorded path and rebalances.
+     */
+    void attach(TreeNode* newNode, int depth);
+    /**
+     * Initiates a subtree rebuild starting from the scapegoat node on the recorded path.
+     */
+    void restructure_subtree(int depth);
+    static T sumHelper(const TreeNode* node,T min,T max);
+    /**
+     * Recomputes a node's aggregate from its children (no-op without an aggregate).
      */
-    void restructure_subtree(TreeNode *newNode);
-    T sumHelper(TreeNode* node,T min,T max);
+    static void pull(TreeNode* node);
+    /**
+     * Aggregate of a (possibly empty) subtree.
+     */
+    static auto aggOf(const TreeNode* node);
+    /**
+     * Aggregate of all keys >= min in the subtree; walks a single path.
+     */
+    static auto suffixAggregate(const TreeNode* node, const T& min);
+    /**
+     * Aggregate of all keys <= max in the subtree; walks a single path.
+     */
+    static auto prefixAggregate(const TreeNode* node, const T& max);
+    /**
+     * Aggregate of all keys in [min, max] using the stored subtree aggregates.
+     */
+    static auto aggregateHelper(const TreeNode* node, const T& min, const T& max);
+    /**
+     * Folds an arbitrary monoid over the keys in [min, max] by visiting them (O(k)).
+     */
+    template<typename Op>
+    static void foldHelper(const TreeNode* node, const T& min, const T& max, typename Op::value_type& acc);
     void rangeHelper(TreeNode* node,T min,T max,Vector<T>& range);
-    T kthSmallestHelper(TreeNode *node, int k) const;
+    /**
+     * Number of keys below key (or up to it, if inclusive): the in-order rank
+     * of the first key not counted.
+     */
+    static int countBelow(const TreeNode* node, const T& key, bool inclusive);
+    /**
+     * Sum of the subtree's keys with in-order ranks in [lo, hi), added up in
+     * the same order as sumHelper.
+     */
+    static T sumRanks(const TreeNode* node, int lo, int hi, Forks forks);
+    /**
+     * Writes the subtree's keys with in-order ranks in [lo, hi) to out.
+     */
+    static void copyRanks(const TreeNode* node, int lo, int hi, T* out, Forks forks);
+    static T kthSmallestHelper(const TreeNode *node, int k);
   static TreeNode* findSuccessor(TreeNode* node);
 
 
@@ -165,20 +691,176 @@ class ScapeGoatTree {
 
 public:
 
+    /**
+     * Read-only view of the tree at the time snapshot() was called. Copies
+     * share the same view; it is safe to read from another thread while the
+     * tree keeps changing. Nodes are never walked through parent pointers.
+     */
+    class Snapshot {
+        std::shared_ptr<const SnapshotState> state;
+        friend class ScapeGoatTree;
+        explicit Snapshot(std::shared_ptr<const SnapshotState> s) : state(std::move(s)) {}
+
+    public:
+        /**
+         * An empty view.
+         */
+        Snapshot() : state(std::make_shared<SnapshotState>()) {}
+        /**
+         * In-order iterator keeping its own stack of ancestors.
+         */
+        class iterator {
+            const TreeNode* curr{};
+            Stack<const TreeNode*> ancestors;
+            void descendLeft(const TreeNode* node) {
+                while (node) {
+                    ancestors.push(node);
+                    node = node->left;
+                }
+                curr = ancestors.isEmpty() ? nullptr : ancestors.pop();
+            }
+
+        public:
+            explicit iterator(const TreeNode* root) { descendLeft(root); }
+            const T& operator*() const { return curr->value; }
+            iterator& operator++() {
+                descendLeft(curr->right);
+                return *this;
+            }
+            bool operator!=(const iterator& other) const { return curr != other.curr; }
+            bool operator==(const iterator& other) const { return curr == other.curr; }
+        };
+
+        [[nodiscard]] bool search(const T& key) const;
+        /**
+         * Sum of the keys in [min, max]; O(log n) with SumAggregate.
+         */
+        T sumInRange(T min, T max) const;
+        template<typename Op = Aggregate>
+        typename Op::value_type aggregateInRange(const T& min, const T& max) const;
+        T kthSmallest(int k) const;
+        [[nodiscard]] int size() const { return state->nNodes; }
+        bool operator!() const { return state->nNodes == 0; }
+        iterator begin() const { return iterator(state->root); }
+        iterator end() const { return iterator(nullptr); }
+    };
+
+    /**
+     * Returns an O(1) read-only snapshot sharing structure with the tree.
+     */
+    Snapshot snapshot();
+    /**
+     * Copies the keys into a read-only FrozenScapeGoatSet laid out for fast
+     * lookups (see frozen_scapegoat_set.hpp). O(n); large trees collect their
+     * keys and prefix sums on the executor once setRebuildThreads is set.
+     */
+    FrozenScapeGoatSet<T> freeze() const;
+    /**
+     * Number of snapshots of this tree that are still alive (for tests/benchmarks).
+     */
+    [[nodiscard]] unsigned int liveSnapshots();
+
     /**
      * Default constructor for an empty Scapegoat Tree.
      */
     ScapeGoatTree();
 ScapeGoatTree(double alpha);
+    /**
+     * Builds a balanced tree from an unsorted range: sort + dedupe + O(n) build.
+     */
+    template<std::forward_iterator It>
+    ScapeGoatTree(It first, It last);
+    /**
+     * Builds a balanced tree from a sorted range in O(n).
+     * Duplicates are dropped; throws std::invalid_argument if the range is not sorted.
+     */
+    template<std::forward_iterator It>
+    static ScapeGoatTree fromSorted(It first, It last);
+    /**
+     * Bulk load of an unsorted range on up to threads threads: parallel sort,
+     * parallel dedupe and parallel build. The tree keeps threads as its
+     * setRebuildThreads value.
+     */
+    template<std::forward_iterator It>
+    static ScapeGoatTree fromUnsorted(It first, It last, int threads);
+    /**
+     * Replaces the contents with a sorted range in O(n).
+     * With recordUndo the swap is one undoable batch; without it the undo/redo history is cleared.
+     * Throws std::invalid_argument if the range is not sorted; use assign for unsorted input.
+     */
+    template<std::forward_iterator It>
+    void assignSorted(It first, It last, bool recordUndo = true);
+    /**
+     * Replaces the contents with an unsorted range (sorted and deduplicated
+     * first, in parallel with setRebuildThreads).
+     */
+    template<std::forward_iterator It>
+    void assign(It first, It last, bool recordUndo = true);
     /**
      * Inserts a new value into the tree and maintains balance if needed.
      */
     void insert(T value);
 
     /**
-     * Inserts multiple values from a Vector into the tree.
+     * Inserts multiple values from a Vector into the tree. Large batches
+     * (see setBatchRebuildRatio) are merged in with a single rebuild.
      */
     void insertBatch( const Vector<T> &values);
+    /**
+     * Sets the batch-size/tree-size ratio at which batch operations switch to
+     * the merge-and-rebuild path. 0 always merges; a huge value never does.
+     */
+    void setBatchRebuildRatio(const double ratio) { if (ratio >= 0) batchRebuildRatio = ratio; }
+    [[nodiscard]] double getBatchRebuildRatio() const { return batchRebuildRatio; }
+    /**
+     * Lets large rebuilds (the deletion rebuild, big scapegoats, bulk loads,
+     * operator+ and set operations) flatten and build their two halves as
+     * separate tasks on the executor, split in at least threads pieces. The
+     * result has exactly the shape a serial rebuild gives. 1 (the default)
+     * keeps everything serial.
+     */
+    void setRebuildThreads(const int threads) { if (threads >= 1) rebuildThreads = threads; }
+    [[nodiscard]] int getRebuildThreads() const { return rebuildThreads; }
+    /**
+     * Runs the parallel operations on pool's workers instead of the shared
+     * pool; nullptr goes back to TaskPool::shared(). The pool must outlive
+     * the tree, and every tree built from it (set operations, splits).
+     */
+    void setExecutor(TaskPool* pool) { executor = pool; }
+    [[nodiscard]] TaskPool* getExecutor() const { return executor; }
+    /**
+     * Rebuilds of at least minNodes nodes (the deletion rebuild, or a scapegoat
+     * subtree that large) are done on a worker thread, so insert/delete only
+     * pay for their own descent. Until the result is swapped in, further large
+     * rebuilds are skipped and the height bound is relaxed. 0 turns it off and
+     * drops a pending rebuild.
+     */
+    void setBackgroundRebuild(int minNodes);
+    /**
+     * Spreads rebuilds over later operations instead: every insert/delete does
+     * budget steps of a pending rebuild (copying, linking or replaying one node
+     * each) and frees at most budget replaced nodes. Rebuilds of at most
+     * budget * log n nodes run inline, and while a job is pending, an insert
+     * whose path is more than twice the height bound does that many more steps
+     * of it. So no operation does more than O(budget * log n) steps, and the
+     * height stays near its bound even under sorted inserts. Lookups always
+     * see the live tree. 0 turns it off and drops a pending rebuild.
+     */
+    void setIncrementalRebuild(int budget);
+    /**
+     * Rebuilds of at least minNodes nodes (big scapegoats, the deletion
+     * rebuild) move the subtree into one fresh block in van Emde Boas order,
+     * as compact() does for the whole tree, instead of relinking the nodes
+     * where they are. Costs a value move per node. 0 (the default) keeps
+     * rebuilds in place.
+     */
+    void setCompactRebuild(const int minNodes) { if (minNodes >= 0) compactRebuildMin = minNodes; }
+    [[nodiscard]] int getCompactRebuild() const { return compactRebuildMin; }
+    [[nodiscard]] bool rebuildPending() const { return rebuildJob != nullptr; }
+    /**
+     * Blocks until the pending rebuild (if any) is swapped in.
+     */
+    void waitForRebuild();
 
     /**
      * Removes a value from the tree and maintains balance if needed.
@@ -186,7 +868,8 @@ ScapeGoatTree(double alpha);
     bool deleteValue(T value);
 
     /**
-     * Removes multiple values from a Vector from the tree.
+     * Removes multiple values from a Vector from the tree. Large batches
+     * (see setBatchRebuildRatio) are removed with a single rebuild.
      */
     void deleteBatch(const Vector<T> &values);
 
@@ -195,6 +878,26 @@ ScapeGoatTree(double alpha);
      */
     [[nodiscard]] bool search(const T & key) const;
     TreeNode* find_node(T& key) const;
+    /**
+     * Sets found[i] for each of keys[0, m) in one pass: the keys are sorted
+     * (skipped when they already are) and every node splits them, so the
+     * levels they share are walked once. O(m log(n/m)) for sorted keys.
+     */
+    void searchBatch(const T* keys, int m, bool* found) const;
+    /**
+     * Like searchBatch, storing each key's node (nullptr if absent) in out.
+     */
+    void findBatch(const T* keys, int m, TreeNode** out) const;
+    /**
+     * getSuccessor for each of keys[0, m) in one pass; found[i] is false (and
+     * successors[i] untouched) where the key has no successor.
+     */
+    void successorBatch(const T* keys, int m, T* successors, bool* found) const;
+
+    /**
+     * Number of keys in the tree.
+     */
+    [[nodiscard]] int size() const { return nNodes; }
 
     /**
      * Removes all nodes from the tree and resets its state.
@@ -202,15 +905,90 @@ ScapeGoatTree(double alpha);
     void clear();
     void undo();
     void redo();
-    T sumInRange(T min, T max);
+    /**
+     * Number of recorded undo and redo commands (batch markers included).
+     */
+    [[nodiscard]] unsigned int historySize() const { return undoStack.size() + redoStack.size(); }
+    /**
+     * Turns undo/redo recording off, dropping the history, or back on.
+     */
+    void setUndoHistory(const bool keep) {
+        isUndoing = !keep;
+        if (keep) return;
+        undoStack.clear();
+        redoStack.clear();
+    }
+    /**
+     * Sum of the keys in [min, max]: O(log n) with SumAggregate, O(k) otherwise.
+     */
+    T sumInRange(T min, T max) const;
+    /**
+     * Folds the monoid Op over the keys in [min, max]. O(log n) when Op is the
+     * tree's own Aggregate, otherwise every key in the range is visited.
+     */
+    template<typename Op = Aggregate>
+    typename Op::value_type aggregateInRange(const T& min, const T& max) const;
     T getMin();
     T getMax();
     Vector<T> valuesInRange(T min,T max);
+    /**
+     * sumInRange on up to threads threads. The size fields turn [min, max]
+     * into a run of in-order ranks, which is cut into disjoint subtrees whose
+     * partial sums are combined in the serial order. With SumAggregate the
+     * serial query is O(log n) already and is used as is.
+     */
+    T sumInRangeParallel(T min, T max, int threads) const;
+    /**
+     * valuesInRange on up to threads threads: each key's slot in the result
+     * is its rank minus the rank of min, so subtrees fill disjoint parts of it.
+     */
+    Vector<T> valuesInRangeParallel(T min, T max, int threads) const;
     T getSuccessor(T value) const;
     T kthSmallest(int k) const;
+    /**
+     * Moves the keys < value into the first tree and the keys >= value into the
+     * second; value need not be present. Relinks one path in O(height), then
+     * copies the smaller half into a pool of its own, balanced, so neither half
+     * keeps the other's memory alive: O(height + smaller half) in all, which is
+     * O(n) for a split near the median. A live snapshot adds an O(n) copy. The
+     * larger half keeps max_nodes, so the deletion rule rebuilds it later if
+     * needed. This tree is left empty.
+     */
     std::pair<ScapeGoatTree, ScapeGoatTree> split(T value);
+    /**
+     * Concatenates two trees where every key of left is smaller than every key of
+     * right. Relinking is O(height), but if the smaller tree's root lands too
+     * deep, the lowest unbalanced subtree above it is rebuilt. That subtree can be
+     * most of the result, so the bound is O(n + m), not O(height); a live snapshot
+     * of either input also costs a copy of it. Both inputs are left empty.
+     * Throws std::invalid_argument if the key ranges overlap.
+     */
+    static ScapeGoatTree join(ScapeGoatTree&& left, ScapeGoatTree&& right);
     int updateSize(TreeNode*& node);
     void changeAlpha(const double alpha){if (alpha > 1 or alpha < 0.5)return; ALPHA=alpha;}
+    /**
+     * Pre-allocates room for n more nodes so the next n inserts never hit the heap.
+     */
+    void reserve(std::size_t n) { pool.reserve(n); }
+    /**
+     * Releases node slabs that no longer hold any live node.
+     */
+    void shrink_to_fit() { pool.shrink_to_fit(); }
+    /**
+     * Moves every node into one block in van Emde Boas order, so searches
+     * and successor walks touch few cache lines and pages again after heavy
+     * churn scattered the nodes. Finishes a pending rebuild first and releases
+     * the slabs left empty. O(n) time, n extra node slots while it runs.
+     */
+    void compact();
+    /**
+     * Returns the node pool's allocation counters.
+     */
+    [[nodiscard]] const PoolStats& poolStats() const { return pool.getStats(); }
+    /**
+     * Returns how many nodes insert/delete descents have visited so far.
+     */
+    [[nodiscard]] std::size_t getNodeVisits() const { return nodeVisits; }
     /**
      * Returns a string report indicating if the tree is currently balanced.
      */
@@ -226,7 +1004,8 @@ ScapeGoatTree(double alpha);
     static iterator end();
 
     /**
-     * Copy constructor for deep copying another ScapeGoatTree.
+     * Copy constructor: clones the node structure in O(n) with one slab
+     * allocation. Settings and counters are kept; the undo history is not.
      */
     ScapeGoatTree(const ScapeGoatTree &Otree);
 
@@ -270,6 +1049,38 @@ ScapeGoatTree(double alpha);
      */
     ScapeGoatTree operator+(const ScapeGoatTree &other) const;
 
+    /**
+     * Keys present in both trees. Probes the larger tree with the smaller one's
+     * keys when the sizes are lopsided, otherwise merges linearly.
+     */
+    ScapeGoatTree intersect(const ScapeGoatTree& other) const;
+
+    /**
+     * Keys of this tree that are not in other.
+     */
+    ScapeGoatTree difference(const ScapeGoatTree& other) const;
+
+    /**
+     * Keys in exactly one of the two trees (always a linear merge).
+     */
+    ScapeGoatTree symmetricDifference(const ScapeGoatTree& other) const;
+
+    /**
+     * Checks if every key of this tree is also in other.
+     */
+    [[nodiscard]] bool isSubsetOf(const ScapeGoatTree& other) const;
+
+    /**
+     * Checks if the two trees share no key.
+     */
+    [[nodiscard]] bool isDisjoint(const ScapeGoatTree& other) const;
+
+    /**
+     * Moves other's keys into this tree, reusing its nodes instead of copying.
+     * other is left empty. The added keys form one undoable batch.
+     */
+    void unionWith(ScapeGoatTree&& other);
+
     /**
      * Assignment operator for deep copying.
      */
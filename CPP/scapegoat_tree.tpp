@@ -4,6 +4,11 @@
 
 #ifndef TREE_SCAPEGOATTREE_TPP
 #define TREE_SCAPEGOATTREE_TPP
+#include <type_traits>
+#include <algorithm>
+#include <bit>
+#include <limits>
+#include <stdexcept>
 #include "queue.hpp"
 #include "sstream"
 //==================================IMPLEMENTATION========================================================
@@ -14,39 +19,91 @@
 /**
  * Default constructor for an empty Scapegoat Tree.
  */
-template<typename T>
-ScapeGoatTree<T>::ScapeGoatTree() = default;
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::ScapeGoatTree() = default;
 
-template<typename T>
-ScapeGoatTree<T>::ScapeGoatTree(const double alpha)  {
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::ScapeGoatTree(const double alpha)  {
     if (alpha > 1 or alpha < 0.5)return;
     ALPHA = alpha;
 }
 
+/**
+ * Builds a balanced tree from an unsorted range: sort + dedupe + O(n) build.
+ */
+template<typename T, typename Aggregate>
+template<std::forward_iterator It>
+ScapeGoatTree<T, Aggregate>::ScapeGoatTree(It first, It last) {
+    assign(first, last, false);
+}
+
+/**
+ * Builds a balanced tree from a sorted range in O(n).
+ */
+template<typename T, typename Aggregate>
+template<std::forward_iterator It>
+ScapeGoatTree<T, Aggregate> ScapeGoatTree<T, Aggregate>::fromSorted(It first, It last) {
+    ScapeGoatTree tree;
+    tree.assignSorted(first, last, false);
+    return tree;
+}
+
+template<typename T, typename Aggregate>
+template<std::forward_iterator It>
+ScapeGoatTree<T, Aggregate> ScapeGoatTree<T, Aggregate>::fromUnsorted(It first, It last, const int threads) {
+    ScapeGoatTree tree;
+    tree.setRebuildThreads(threads);
+    tree.assign(first, last, false);
+    return tree;
+}
+
 /**
  * Copy constructor for deep copying another ScapeGoatTree.
  */
-template<typename T>
-ScapeGoatTree<T>::ScapeGoatTree(const ScapeGoatTree &Otree) {
-    if (!Otree.root) return;
-    preorderTraversal(Otree.root);
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::ScapeGoatTree(const ScapeGoatTree &Otree) {
+    copyFrom(Otree);
 }
 /**
  * Destructor that cleans up all nodes in the tree.
  */
-template<typename T>
-ScapeGoatTree<T>::~ScapeGoatTree() {
-    postorderTraversal(root);
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::~ScapeGoatTree() {
+    cancelRebuild();
+    orphanSnapshots(false); // live snapshots keep the nodes they can see
+    // the pool frees its slabs wholesale; only non-trivial values need a walk
+    if constexpr (!std::is_trivially_destructible_v<TreeNode>) postorderTraversal(root);
     max_nodes = 0;
+    if (reaper.joinable()) reaper.join();
 }
 /**
  * Move constructor for transferring ownership from another ScapeGoatTree.
  */
-template<typename T>
-ScapeGoatTree<T>::ScapeGoatTree(ScapeGoatTree &&other) noexcept
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::ScapeGoatTree(ScapeGoatTree &&other) noexcept
     : root(other.root),
+pool(std::move(other.pool)),
 nNodes(other.nNodes),
-max_nodes(other.max_nodes) {
+rebuildCount(other.rebuildCount),
+max_nodes(other.max_nodes),
+ALPHA(other.ALPHA),
+batchRebuildRatio(other.batchRebuildRatio),
+rebuildThreads(other.rebuildThreads),
+executor(other.executor),
+epoch(other.epoch),
+sharedBelow(other.sharedBelow),
+snapshots(std::move(other.snapshots)),
+retired(std::move(other.retired)),
+backgroundRebuildMin(other.backgroundRebuildMin),
+compactRebuildMin(other.compactRebuildMin),
+rebuildBudget(other.rebuildBudget),
+rebuildJob(std::move(other.rebuildJob)),
+reaper(std::move(other.reaper)),
+condemned(std::move(other.condemned)),
+condemnedAt(other.condemnedAt),
+condemnedTrees(std::move(other.condemnedTrees)) {
+    other.condemnedAt = 0;
+    other.sharedBelow = 0;
     other.root = nullptr;
     other.nNodes = 0;
     other.max_nodes = 0;
@@ -59,109 +116,399 @@ max_nodes(other.max_nodes) {
 /**
  * Initiates a subtree rebuild starting from the scapegoat node.
  */
-template <typename T>
-void ScapeGoatTree<T>::restructure_subtree(TreeNode *newNode) {
-    //find the scapegoat  node
-    TreeNode* goat = findTraitor(newNode->parent);
-    if (goat == nullptr) return;
-    T* temp_array = new T[nNodes];
-    int i = 0;
-    //flatten the tree into a sorted array
-    inorderTraversal(goat, i, temp_array);
-    const int sub_size = i; // size of subtree
-    //rebuild the subtree
-    TreeNode* balanced = rebuildTree(0, sub_size- 1, goat->parent, temp_array);
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::restructure_subtree(const int depth) {
+    //find the scapegoat node on the insertion path
+    const int g = findTraitor(depth);
+    if (g < 0) return;
+    TreeNode* goat = path[g];
+    if (deferRebuild(static_cast<int>(goat->size))) {
+        if (isReplaying) return; // left to the live tree, after the swap
+        // rebuild the goat's subtree in a rebuild job
+        if (!rebuildJob) {
+            startRebuild(g);
+            return;
+        }
+        // only one runs at a time; meanwhile only paths twice as deep as
+        // the bound are dealt with: an incremental job is hurried along by a
+        // bounded number of steps, a background one is not waited for
+        if (depth <= 2 * getThreshold()) return;
+        if (rebuildBudget) {
+            advanceRebuild(stepLimit());
+            return;
+        }
+    }
+    TreeNode* parent = g > 0 ? path[g - 1] : nullptr;
+    const bool wasLeft = parent && goat == parent->left;
+    //relink the subtree's own nodes into a balanced shape
+    TreeNode* balanced = rebuildSubtree(goat, parent);
     rebuildCount++;
     //reattach the rebuilt subtree
-    if (!goat->parent) root = balanced; // if goat is root then update root
-    else if (goat == goat->parent->left) goat->parent->left = balanced; //if goat is left child then update left pointer
-    else goat->parent->right = balanced; //if goat is right child then update right pointer
-    postorderTraversal(goat);// delete old subtree
-    delete[] temp_array;
+    if (!parent) root = balanced; // if goat is root then update root
+    else if (wasLeft) parent->left = balanced; //if goat is left child then update left pointer
+    else parent->right = balanced; //if goat is right child then update right pointer
 }
 
 /**
- * Inserts a new value into the tree and maintains balance if needed.
+ * Descends towards value recording the path. Returns the depth at which a new
+ * node would hang, or -1 if the value is already in the tree.
  */
-template<typename T>
-void ScapeGoatTree<T>::insert(T value) {
-    // Record the operation for undo if not currently undoing/redoing
-    if (!isUndoing) {
-        undoStack.push({OpType::Insert, value});
-    }
-    Vector<TreeNode*> path;
-    if (!root) {
-        root = new TreeNode(value, nullptr);
-        nNodes++;
-        if (nNodes > max_nodes) max_nodes = nNodes;
-        return;
-    }
-
+template<typename T, typename Aggregate>
+int ScapeGoatTree<T, Aggregate>::descend(const T& value) {
+    path.clear();
     TreeNode* current = root;
-    TreeNode* parent = nullptr;
-    int depth = 0;
-
     while (current) {
         path.push_back(current);
-        parent = current;
-        ++current->size;
-        depth++;
         if (value < current->value)
             current = current->left;
         else if (value > current->value)
             current = current->right;
         else {
-            // value already exists, backtrack size increment
-            for (int i = 0; i < path.size(); i++) {
-                --path[i]->size;
-            }
-            // If the value already exists, we didn't actually change the tree,
-            // so we remove the command from the undo stack.
-            if (!isUndoing) {
-                undoStack.pop();
-            }
-            return;
+            // value already exists, nothing was touched
+            nodeVisits += path.size();
+            return -1;
         }
     }
-    auto* newNode = new TreeNode(value, parent);
-    if (value < parent->value)
+    nodeVisits += path.size();
+    return static_cast<int>(path.size());
+}
+
+/**
+ * Hangs a detached node below the end of the recorded path and rebalances if needed.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::attach(TreeNode* newNode, const int depth) {
+    logChange(OpType::Insert, newNode->value);
+    for (int i = 0; i < depth; i++) ++path[i]->size;
+
+    TreeNode* parent = depth > 0 ? path[depth - 1] : nullptr;
+    newNode->parent = parent;
+    newNode->left = newNode->right = nullptr;
+    newNode->size = 1;
+    if (!parent)
+        root = newNode;
+    else if (newNode->value < parent->value)
         parent->left = newNode;
     else
         parent->right = newNode;
 
+    if constexpr (hasAggregate) {
+        pull(newNode);
+        for (int i = depth - 1; i >= 0; i--) pull(path[i]);
+    }
+
     nNodes++;
     if (nNodes > max_nodes) max_nodes = nNodes;
 
     if (depth + 1 <= getThreshold()) return;
-    restructure_subtree(newNode);
+    restructure_subtree(depth);
+}
+
+/**
+ * Inserts a new value into the tree and maintains balance if needed.
+ * One descent records the path; sizes are only bumped once we know the value is new.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::insert(T value) {
+    if (rebuildWork()) pollRebuild();
+    if (snapshots.size()) collectSnapshots();
+    const int depth = descend(value);
+    if (depth < 0) return;
+    // Record the operation for undo if not currently undoing/redoing
+    if (!isUndoing) undoStack.push({OpType::Insert, value});
+    if (sharedBelow) unsharePath(depth);
+    attach(makeNode(std::move(value), nullptr), depth);
 }
 /**
  * Inserts multiple values from a Vector into the tree.
  */
-template<typename T>
-    void ScapeGoatTree<T>::insertBatch(const Vector<T>& values) {
+template<typename T, typename Aggregate>
+    void ScapeGoatTree<T, Aggregate>::insertBatch(const Vector<T>& values) {
+    if (snapshots.size()) collectSnapshots();
     // Group multiple insertions into a single undo/redo unit
     if (!isUndoing) undoStack.push({OpType::BatchStart, T()});
 
-    for (int i = 0; i < values.size(); i++) {
-        insert(values[i]);
+    if (values.size() > 0 && values.size() >= batchRebuildRatio * nNodes) {
+        mergeBatch(values);
+    } else {
+        for (unsigned int i = 0; i < values.size(); i++) {
+            insert(values[i]);
+        }
     }
     if (!isUndoing) undoStack.push({OpType::BatchEnd, T()});
 }
 
+/**
+ * Linear merge of the sorted batch with the tree's in-order node list (as operator+
+ * does with values), then one rebuild. Existing nodes are relinked, not copied.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::mergeBatch(const Vector<T>& values) {
+    cancelRebuild(); // this rebuilds everything anyway
+    int m = static_cast<int>(values.size());
+    T* batch = new T[m];
+    for (int i = 0; i < m; i++) batch[i] = values[i];
+    m = sortKeys(batch, m);
+
+    TreeNode* list = flattenOwned(root, nullptr);
+    TreeNode dummy(T{});          // head sentinel for the merged list
+    TreeNode* tail = &dummy;
+    int idx = 0, added = 0;
+    pool.reserve(m);
+    while (list || idx < m) {
+        if (list && (idx == m || list->value < batch[idx])) {
+            tail->right = list; // existing node comes first
+            list = list->right;
+        } else {
+            if (list && !(batch[idx] < list->value)) { // duplicate, keep the existing node
+                tail->right = list;
+                list = list->right;
+            } else {
+                if (!isUndoing) undoStack.push({OpType::Insert, batch[idx]});
+                tail->right = makeNode(std::move(batch[idx]), nullptr);
+                added++;
+            }
+            idx++;
+        }
+        tail = tail->right;
+    }
+    tail->right = nullptr;
+
+    nNodes += added;
+    TreeNode* head = dummy.right;
+    root = buildFromList(nNodes, head, nullptr);
+    rebuildCount++;
+    max_nodes = nNodes;
+    delete[] batch;
+}
+
 /**
  * Removes multiple values from a Vector from the tree.
  */
-template<typename T>
-void ScapeGoatTree<T>::deleteBatch(const  Vector<T>& values) {
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::deleteBatch(const  Vector<T>& values) {
+    if (snapshots.size()) collectSnapshots();
     // Group multiple deletions into a single undo/redo unit
     if (!isUndoing) undoStack.push({OpType::BatchStart, T()});
-    for (int i = 0; i < values.size(); i++) {
-        deleteValue(values[i]);
+    if (values.size() > 0 && values.size() >= batchRebuildRatio * nNodes) {
+        subtractBatch(values);
+    } else {
+        for (unsigned int i = 0; i < values.size(); i++) {
+            deleteValue(values[i]);
+        }
     }
     if (!isUndoing) undoStack.push({OpType::BatchEnd, T()});
 }
 
+/**
+ * Linear set difference of the tree's in-order node list and the sorted victims,
+ * then one rebuild. Only keys that were actually removed are recorded for undo.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::subtractBatch(const Vector<T>& values) {
+    if (!root) return;
+    cancelRebuild(); // this rebuilds everything anyway
+    int m = static_cast<int>(values.size());
+    T* victims = new T[m];
+    for (int i = 0; i < m; i++) victims[i] = values[i];
+    m = sortUnique(victims, m);
+
+    TreeNode* list = flattenOwned(root, nullptr);
+    TreeNode* head = nullptr;
+    TreeNode** tail = &head;
+    int idx = 0;
+    while (list) {
+        TreeNode* next = list->right;
+        while (idx < m && victims[idx] < list->value) idx++; // victims not in the tree
+        if (idx < m && !(list->value < victims[idx])) {
+            if (!isUndoing) undoStack.push({OpType::Delete, list->value});
+            pool.destroy(list);
+            nNodes--;
+            idx++;
+        } else {
+            *tail = list; // survivor keeps its place in order
+            tail = &list->right;
+        }
+        list = next;
+    }
+    *tail = nullptr;
+
+    root = buildFromList(nNodes, head, nullptr);
+    rebuildCount++;
+    max_nodes = nNodes;
+    delete[] victims;
+}
+
+
+// =====================
+// Bulk construction
+// =====================
+
+/**
+ * Sorts an array and drops duplicates; returns the new length.
+ */
+template<typename T, typename Aggregate>
+int ScapeGoatTree<T, Aggregate>::sortUnique(T* array, const int n) {
+    if (!std::is_sorted(array, array + n)) std::sort(array, array + n);
+    int idx = 0;
+    for (int i = 0; i < n; i++) {
+        if (idx > 0 && !(array[idx - 1] < array[i])) continue;
+        if (idx != i) array[idx] = std::move(array[i]);
+        idx++;
+    }
+    return idx;
+}
+
+template<typename T, typename Aggregate>
+int ScapeGoatTree<T, Aggregate>::sortKeys(T*& array, int n) const {
+    const Forks forks = forkLevels(n);
+    if (!forks) return sortUnique(array, n);
+    T* sorted = new T[n];
+    if (!std::is_sorted(array, array + n)) parallelSort(array, sorted, n, forks, false);
+    n = parallelUnique(array, n, sorted, forks);
+    delete[] array;
+    array = sorted;
+    return n;
+}
+
+/**
+ * Each level sorts its halves into the buffer it does not merge into, so no
+ * level copies back.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::parallelSort(T* src, T* other, const int n, const Forks forks, const bool toOther) {
+    if (!forks || n < PARALLEL_REBUILD_MIN) {
+        std::sort(src, src + n);
+        if (toOther) std::move(src, src + n, other);
+        return;
+    }
+    const int half = n / 2;
+    forkJoin(forks,
+             [=] { parallelSort(src, other, half, forks.next(), !toOther); },
+             [=] { parallelSort(src + half, other + half, n - half, forks.next(), !toOther); });
+    T* from = toOther ? src : other;
+    parallelMerge(from, half, from + half, n - half, toOther ? other : src, forks);
+}
+
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::parallelMerge(T* a, int na, T* b, int nb, T* out, const Forks forks) {
+    if (!forks || na + nb < PARALLEL_REBUILD_MIN) {
+        std::merge(std::make_move_iterator(a), std::make_move_iterator(a + na),
+                   std::make_move_iterator(b), std::make_move_iterator(b + nb), out);
+        return;
+    }
+    if (na < nb) {
+        std::swap(a, b);
+        std::swap(na, nb);
+    }
+    const int ma = na / 2;
+    const int mb = static_cast<int>(std::lower_bound(b, b + nb, a[ma]) - b);
+    out[ma + mb] = std::move(a[ma]);
+    forkJoin(forks,
+             [=] { parallelMerge(a, ma, b, mb, out, forks.next()); },
+             [=] { parallelMerge(a + ma + 1, na - ma - 1, b + mb, nb - mb, out + ma + mb + 1, forks.next()); });
+}
+
+/**
+ * Two passes over the same 2^levels chunks: count the keys each keeps, then
+ * move them to the offsets the counts add up to. Whether a chunk's first key
+ * is kept is decided in the first pass, before anything is moved.
+ */
+template<typename T, typename Aggregate>
+int ScapeGoatTree<T, Aggregate>::parallelUnique(T* src, const int n, T* dst, const Forks forks) {
+    const int chunks = 1 << forks.levels;
+    auto* offset = new int[chunks + 1]{};
+    auto* keepFirst = new bool[chunks];
+    auto chunkStart = [n, chunks](const int c) { return static_cast<int>(static_cast<long long>(n) * c / chunks); };
+    auto count = [&](const int c) {
+        const int lo = chunkStart(c), hi = chunkStart(c + 1);
+        int kept = 0;
+        for (int i = lo; i < hi; i++)
+            if (i == 0 || src[i - 1] < src[i]) kept++;
+        keepFirst[c] = lo < hi && (lo == 0 || src[lo - 1] < src[lo]);
+        offset[c + 1] = kept;
+    };
+    forks.pool->forEach(0, chunks, 1, count);
+    for (int c = 0; c < chunks; c++) offset[c + 1] += offset[c];
+    auto place = [&](const int c) {
+        const int lo = chunkStart(c), hi = chunkStart(c + 1);
+        int out = offset[c];
+        const T* last = nullptr; // the previous key, wherever it is now
+        for (int i = lo; i < hi; i++) {
+            if (i == lo ? keepFirst[c] : *last < src[i]) {
+                dst[out] = std::move(src[i]);
+                last = &dst[out++];
+            } else {
+                last = &src[i];
+            }
+        }
+    };
+    forks.pool->forEach(0, chunks, 1, place);
+    const int unique = offset[chunks];
+    delete[] offset;
+    delete[] keepFirst;
+    return unique;
+}
+
+/**
+ * Replaces the contents with n sorted, distinct values in O(n), in the style of rebuildTree.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::assignArray(T* array, const int n, const bool recordUndo) {
+    if (recordUndo) {
+        // one batch: delete the old contents, insert the new ones
+        undoStack.push({OpType::BatchStart, T()});
+        recordValues(root, OpType::Delete);
+        for (int i = 0; i < n; i++) undoStack.push({OpType::Insert, array[i]});
+        undoStack.push({OpType::BatchEnd, T()});
+    } else {
+        // the old history no longer describes this tree
+        undoStack.clear();
+        redoStack.clear();
+    }
+    clear();
+    pool.shrink_to_fit(); // the new nodes get one fresh block; hand the old slabs back first
+    root = rebuildTree(0, n - 1, nullptr, array);
+    nNodes = n;
+    max_nodes = n;
+}
+
+/**
+ * Pushes one command of the given type per value in the subtree (for undo).
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::recordValues(const TreeNode* node, const OpType type) {
+    if (!node) return;
+    recordValues(node->left, type);
+    undoStack.push({type, node->value});
+    recordValues(node->right, type);
+}
+
+/**
+ * Replaces the contents with a sorted range in O(n); the order is checked,
+ * not restored, and equal neighbours are dropped.
+ */
+template<typename T, typename Aggregate>
+template<std::forward_iterator It>
+void ScapeGoatTree<T, Aggregate>::assignSorted(It first, It last, const bool recordUndo) {
+    if (!std::is_sorted(first, last)) throw std::invalid_argument("assignSorted needs a sorted range");
+    assign(first, last, recordUndo);
+}
+
+/**
+ * Replaces the contents with an unsorted range (sorted and deduplicated first).
+ */
+template<typename T, typename Aggregate>
+template<std::forward_iterator It>
+void ScapeGoatTree<T, Aggregate>::assign(It first, It last, const bool recordUndo) {
+    const int n = static_cast<int>(std::distance(first, last));
+    T* array = new T[n];
+    std::copy(first, last, array);
+    // sortKeys only sorts when the input turns out not to be sorted
+    const int unique = sortKeys(array, n);
+    assignArray(array, unique, recordUndo);
+    delete[] array;
+}
 
 // =====================
 // Delete
@@ -169,93 +516,95 @@ void ScapeGoatTree<T>::deleteBatch(const  Vector<T>& values) {
 
 /**
  * Removes a value from the tree and maintains balance if needed.
+ * One descent finds the node and records the path whose sizes shrink.
  */
-template<typename T>
-bool ScapeGoatTree<T>::deleteValue(T value) {
+template<typename T, typename Aggregate>
+bool ScapeGoatTree<T, Aggregate>::deleteValue(T value) {
+    if (rebuildWork()) pollRebuild();
+    if (snapshots.size()) collectSnapshots();
+    path.clear();
     TreeNode* node = root;
-    TreeNode* parent = nullptr;
 
     // Step 1: Search for the node
     while (node != nullptr and node->value != value) {
-        parent = node;
+        path.push_back(node);
         if (value < node->value)
             node = node->left;
         else
             node = node->right;
     }
+    nodeVisits += path.size();
 
     // Value not found
     if (!node) return false;
+    nodeVisits++;
 
     // Record the operation for undo if not currently undoing/redoing
     if (not isUndoing) {
         undoStack.push({OpType::Delete, value});
     }
-    bool originalIsUndoing = isUndoing;
-    isUndoing = true;
-    // Case 1: Leaf node
-    if (!node->left && !node->right) {
-        // Decrement size for all nodes on the path
-        TreeNode* temp = root;
-        while (temp != node) {
-            --temp->size;
-            if (value < temp->value) temp = temp->left;
-            else temp = temp->right;
-        }
-        if (!parent) {
-            root = nullptr;
-        }
-        else if (parent->left == node) {
-            parent->left = nullptr;
-        }
-        else {
-            parent->right = nullptr;
+    logChange(OpType::Delete, value);
+    const unsigned int ancestors = path.size();
+    // the node and, with two children, the chain down to its inorder successor
+    path.push_back(node);
+    if (node->left && node->right) {
+        TreeNode* suc = node->right;
+        path.push_back(suc);
+        while (suc->left != nullptr) {
+            suc = suc->left;
+            path.push_back(suc);
+            nodeVisits++;
         }
-        delete node;
     }
-
-    // Case 2: One child
-    else if(node->left && !node->right || !node->left && node->right) {
-        // Decrement size for all nodes on the path
-        TreeNode* temp = root;
-        while (temp != node) {
-            --temp->size;
-            if (value < temp->value) temp = temp->left;
-            else temp = temp->right;
-        }
-        TreeNode* child = nullptr;
-
-        if (node->left != nullptr)
-            child = node->left;
-        else
-            child = node->right;
-
-        child->parent = parent;
-
-        if (!parent) {
-            root = child;
-        }
-        else if (parent->left == node) {
-            parent->left = child;
-        }
-        else {
-            parent->right = child;
+    // with live snapshots, everything about to change is copied first
+    if (sharedBelow) unsharePath(static_cast<int>(path.size()));
+    node = path[ancestors];
+    TreeNode* parent = ancestors ? path[ancestors - 1] : nullptr;
+    TreeNode* replacement = nullptr;
+
+    // Case 1 & 2: Leaf or one child, the child (if any) moves up
+    if (path.size() == ancestors + 1) {
+        replacement = node->left ? node->left : node->right;
+    }
+    // Case 3: Two children, the inorder successor is relinked into the node's place
+    else {
+        TreeNode* suc = path[path.size() - 1];
+        TreeNode* sucParent = path[path.size() - 2];
+        // every node between the node and the successor loses it
+        for (unsigned int i = ancestors + 1; i + 1 < path.size(); i++) --path[i]->size;
+        // Unlink the successor, its right child moves up
+        if (sucParent == node) node->right = suc->right;
+        else sucParent->left = suc->right;
+        if (suc->right) suc->right->parent = sucParent;
+        // The successor takes over the node's links instead of copying values around
+        suc->left = node->left;
+        suc->right = node->right;
+        if (suc->left) suc->left->parent = suc;
+        if (suc->right) suc->right->parent = suc;
+        suc->size = node->size - 1;
+        replacement = suc;
+        if constexpr (hasAggregate) {
+            // aggregates are fixed bottom-up: the successor's old ancestors first
+            for (unsigned int i = path.size() - 1; i > ancestors + 1; i--) pull(path[i - 1]);
+            pull(suc);
         }
-
-        delete node;
     }
-    // Case 3: Two children
-    else if (node->left && node->right) {
-        // Find inorder successor (smallest in right subtree)
-        TreeNode* suc = node->right;
-        while (suc->left != nullptr)
-            suc = suc->left;
 
-        T successorValue = suc->value;
-        deleteValue(successorValue);
-        node->value = successorValue;
-        isUndoing = originalIsUndoing;
-        return true;
+    // Decrement size for all nodes on the path
+    for (unsigned int i = 0; i < ancestors; i++) --path[i]->size;
+    if (replacement) replacement->parent = parent;
+    if (!parent) {
+        root = replacement;
+    }
+    else if (parent->left == node) {
+        parent->left = replacement;
+    }
+    else {
+        parent->right = replacement;
+    }
+    pool.destroy(node);
+    if constexpr (hasAggregate) {
+        for (unsigned int i = ancestors; i > 0; i--) pull(path[i - 1]);
     }
 
     // Update node count
@@ -266,7 +615,6 @@ bool ScapeGoatTree<T>::deleteValue(T value) {
     } else {
         DeletionRebuild();
     }
-    isUndoing = originalIsUndoing;
     return true;
 }
 
@@ -277,8 +625,8 @@ bool ScapeGoatTree<T>::deleteValue(T value) {
 /**
  * Calculates the height of a given node in the tree.
  */
-template<typename T>
-int ScapeGoatTree<T>::findH(const TreeNode *node) {
+template<typename T, typename Aggregate>
+int ScapeGoatTree<T, Aggregate>::findH(const TreeNode *node) {
     if (!node) return -1;
     const int max = findH(node->left) > findH(node->right) ? findH(node->left) :findH(node->right);
    return 1+ max;
@@ -287,282 +635,1518 @@ int ScapeGoatTree<T>::findH(const TreeNode *node) {
 /**
  * Counts the total number of nodes in the subtree rooted at the given node.
  */
-template<typename T>
-unsigned int ScapeGoatTree<T>::countN(const TreeNode *node) {
+template<typename T, typename Aggregate>
+unsigned int ScapeGoatTree<T, Aggregate>::countN(const TreeNode *node) {
     if (!node) return 0;
     return node->size;
 }
 
 /**
- * Finds the highest node that violates the alpha-weight-balance property.
+ * Walks the recorded insertion path bottom-up and returns the index of the
+ * first node that violates the alpha-weight-balance property, or -1.
  */
-template<typename T>
-ScapeGoatTree<T>::TreeNode* ScapeGoatTree<T>::findTraitor(TreeNode *node) {
-    while (node != nullptr) {
+template<typename T, typename Aggregate>
+int ScapeGoatTree<T, Aggregate>::findTraitor(const int depth) const {
+    for (int i = depth - 1; i >= 0; i--) {
+        const TreeNode* node = path[i];
         const int left = countN(node->left);
         const int right = countN(node->right);
-        int size = node->size;
+        const int size = node->size;
 
         if (left > ALPHA * size || right > ALPHA * size)
-            return node;
-
-        node = node->parent;
+            return i;
     }
-    return nullptr;
+    return -1;
 }
 
 /**
- * Recursively rebuilds a balanced BST from a sorted array of values.
+ * Every node is placed straight into its van Emde Boas slot.
  */
-template<typename T>
-ScapeGoatTree<T>::TreeNode* ScapeGoatTree<T>::rebuildTree(const int start, const int end, TreeNode* parent_node,T* array) {
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::TreeNode* ScapeGoatTree<T, Aggregate>::rebuildTree(const int start, const int end, TreeNode* parent_node,T* array) {
     if (start > end) return nullptr; // base case
-    int mid = (start + end) / 2; // find mid index
-    auto* Nroot = new TreeNode(array[mid], parent_node); // create node with mid value
-    Nroot->left = rebuildTree(start, mid - 1, Nroot, array); // build left subtree
-    Nroot->right = rebuildTree(mid + 1, end, Nroot, array);// build right subtree
-    Nroot->size = 1 + countN(Nroot->left) + countN(Nroot->right);// update size
+    const int n = end - start + 1;
+    const int* slotOf = vebLayout(n);
+    TreeNode* built = buildNodes(array + start, 0, n, parent_node, pool.claim(n), slotOf, forkLevels(n));
+    delete[] slotOf;
+    return built;
+}
+
+template<typename T, typename Aggregate>
+int* ScapeGoatTree<T, Aggregate>::vebLayout(const int n) {
+    auto* slotOf = new int[n];
+    vebSlots(0, n, std::bit_width(static_cast<unsigned int>(n)), 0, slotOf);
+    return slotOf;
+}
+
+/**
+ * The subtrees below the top part are found by walking it down once more;
+ * each is laid out with the levels the top part left over.
+ */
+template<typename T, typename Aggregate>
+int ScapeGoatTree<T, Aggregate>::vebSlots(const int start, const int n, const int levels, const int first, int* slotOf) {
+    if (n <= 0 || levels <= 0) return 0;
+    if (levels == 1) {
+        slotOf[start + (n - 1) / 2] = first;
+        return 1;
+    }
+    const int top = levels / 2;
+    int used = vebSlots(start, n, top, first, slotOf);
+    auto below = [&](auto&& self, const int from, const int count, const int depth) -> void {
+        if (count <= 0) return;
+        if (depth == top) {
+            used += vebSlots(from, count, levels - top, first + used, slotOf);
+            return;
+        }
+        const int leftCount = (count - 1) / 2;
+        self(self, from, leftCount, depth + 1);
+        self(self, from + leftCount + 1, count - 1 - leftCount, depth + 1);
+    };
+    below(below, start, n, 0);
+    return used;
+}
+
+/**
+ * Threads the subtree's nodes into an in-order list through their right pointers.
+ * Left pointers are left stale; buildFromList overwrites them.
+ */
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::TreeNode* ScapeGoatTree<T, Aggregate>::flattenNodes(TreeNode* node, TreeNode* head) {
+    if (!node) return head;
+    node->right = flattenNodes(node->right, head); // everything after node
+    return flattenNodes(node->left, node);          // everything before node
+}
+
+/**
+ * Relinks the first n nodes of a right-threaded list into a perfectly balanced subtree.
+ * Splits like rebuildTree (left half gets (n-1)/2 nodes), so both produce the same shape.
+ */
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::TreeNode* ScapeGoatTree<T, Aggregate>::buildFromList(const int n, TreeNode*& head, TreeNode* parent_node) {
+    if (n <= 0) return nullptr; // base case
+    const int leftCount = (n - 1) / 2;
+    TreeNode* left = buildFromList(leftCount, head, nullptr); // build left subtree first
+    TreeNode* Nroot = head; // next node in order becomes the root
+    head = head->right;
+    Nroot->left = left;
+    if (left) left->parent = Nroot;
+    Nroot->parent = parent_node;
+    Nroot->right = buildFromList(n - 1 - leftCount, head, Nroot); // build right subtree
+    Nroot->size = n;
+    pull(Nroot);
     return Nroot;
 }
+
+/**
+ * Rebuilds the subtree rooted at node in place: no allocation and no value
+ * copies, unless it is large enough to be moved into a van Emde Boas block.
+ */
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::TreeNode* ScapeGoatTree<T, Aggregate>::rebuildSubtree(TreeNode* node, TreeNode* parent_node) {
+    const int n = static_cast<int>(node->size);
+    if (compactRebuildMin && n >= compactRebuildMin) return relocateSubtree(node, parent_node, pool);
+    if (const Forks forks = forkLevels(n); forks && !sharedBelow) {
+        auto** nodes = new TreeNode*[n];
+        collectNodes(node, nodes, forks);
+        TreeNode* rebuilt = linkNodes(nodes, n, parent_node, forks);
+        delete[] nodes;
+        return rebuilt;
+    }
+    TreeNode* head = flattenOwned(node, nullptr);
+    return buildFromList(n, head, parent_node);
+}
+
+/**
+ * The old nodes are gone before the new ones are linked. With discardPool
+ * (compact() with nothing else alive in this pool) each old node only has its
+ * destructor run, so the moves may fork: the slabs go away with the pool.
+ */
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::TreeNode* ScapeGoatTree<T, Aggregate>::relocateSubtree(TreeNode* node, TreeNode* parent_node,
+                                                                                    NodePool<TreeNode>& into, const bool discardPool) {
+    const int n = static_cast<int>(node->size);
+    const Forks forks = forkLevels(n);
+    auto** nodes = new TreeNode*[n];
+    collectNodes(node, nodes, forks);
+    const int* slotOf = vebLayout(n);
+    const typename NodePool<TreeNode>::Block block = into.claim(n);
+    auto move = [&](const int lo, const int hi) {
+        for (int i = lo; i < hi; i++) {
+            TreeNode* old = nodes[i];
+            auto* fresh = isFrozen(old) ? ::new (block.at(slotOf[i])) TreeNode(old->value)
+                                        : ::new (block.at(slotOf[i])) TreeNode(std::move(old->value));
+            fresh->birth = epoch;
+            if (discardPool) old->~TreeNode();
+            else dispose(old);
+            nodes[i] = fresh;
+        }
+    };
+    if (forks && discardPool) {
+        const int chunks = 1 << forks.levels;
+        forks.pool->forEach(0, chunks, 1, [&](const int c) {
+            move(static_cast<int>(static_cast<long long>(n) * c / chunks), static_cast<int>(static_cast<long long>(n) * (c + 1) / chunks));
+        });
+    } else {
+        move(0, n);
+    }
+    delete[] slotOf;
+    TreeNode* rebuilt = linkNodes(nodes, n, parent_node, forks);
+    delete[] nodes;
+    return rebuilt;
+}
+
+/**
+ * Without snapshots or retired nodes the tree is the pool's only user, so
+ * the copy goes to a new pool and the old slabs are freed whole instead of
+ * sorting out which of them emptied.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::compact() {
+    waitForRebuild();
+    cancelRebuild(); // no job is left; this frees the condemned nodes
+    if (snapshots.size()) collectSnapshots();
+    if (!root) {
+        pool.shrink_to_fit();
+    } else if (sharedBelow || retired.size()) {
+        root = relocateSubtree(root, nullptr, pool);
+        pool.shrink_to_fit();
+    } else {
+        NodePool<TreeNode> fresh;
+        root = relocateSubtree(root, nullptr, fresh, true);
+        pool = std::move(fresh);
+    }
+}
+
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::Forks ScapeGoatTree<T, Aggregate>::forksFor(const int threads) const {
+    if (threads <= 1) return {};
+    return {executor ? executor : &TaskPool::shared(), static_cast<int>(std::bit_width(static_cast<unsigned int>(threads - 1)))};
+}
+
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::Forks ScapeGoatTree<T, Aggregate>::forkLevels(const int n) const {
+    return n < PARALLEL_REBUILD_MIN ? Forks{} : forksFor(rebuildThreads);
+}
+
+template<typename T, typename Aggregate>
+template<typename First, typename Second>
+void ScapeGoatTree<T, Aggregate>::forkJoin(const Forks forks, First&& first, Second&& second) {
+    if (!forks) {
+        first();
+        second();
+        return;
+    }
+    forks.pool->join(std::forward<First>(first), std::forward<Second>(second));
+}
+
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::collectNodes(TreeNode* node, TreeNode** out, const Forks forks) {
+    if (!node) return;
+    TreeNode** at = out + countN(node->left);
+    *at = node;
+    forkJoin(static_cast<int>(node->size) >= PARALLEL_REBUILD_MIN ? forks : Forks{},
+             [=] { collectNodes(node->left, out, forks.next()); },
+             [=] { collectNodes(node->right, at + 1, forks.next()); });
+}
+
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::collectValues(const TreeNode* node, T* out, const Forks forks) {
+    if (!node) return;
+    T* at = out + countN(node->left);
+    *at = node->value;
+    forkJoin(static_cast<int>(node->size) >= PARALLEL_REBUILD_MIN ? forks : Forks{},
+             [=] { collectValues(node->left, out, forks.next()); },
+             [=] { collectValues(node->right, at + 1, forks.next()); });
+}
+
+/**
+ * The two halves write different fields of node, so they need no locking.
+ */
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::TreeNode* ScapeGoatTree<T, Aggregate>::linkNodes(TreeNode** nodes, const int n, TreeNode* parent_node, const Forks forks) {
+    if (n <= 0) return nullptr;
+    const int leftCount = (n - 1) / 2;
+    TreeNode* node = nodes[leftCount];
+    node->parent = parent_node;
+    node->size = n;
+    forkJoin(n >= PARALLEL_REBUILD_MIN ? forks : Forks{},
+             [=] { node->left = linkNodes(nodes, leftCount, node, forks.next()); },
+             [=] { node->right = linkNodes(nodes + leftCount + 1, n - 1 - leftCount, node, forks.next()); });
+    pull(node);
+    return node;
+}
+
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::TreeNode* ScapeGoatTree<T, Aggregate>::buildNodes(T* array, const int start, const int n, TreeNode* parent_node,
+                                                                             const typename NodePool<TreeNode>::Block block, const int* slotOf, const Forks forks) {
+    if (n <= 0) return nullptr;
+    const int leftCount = (n - 1) / 2;
+    auto* node = ::new (block.at(slotOf[start + leftCount])) TreeNode(std::move(array[start + leftCount]), parent_node);
+    node->birth = epoch;
+    node->size = n;
+    forkJoin(n >= PARALLEL_REBUILD_MIN ? forks : Forks{},
+             [=, this] { node->left = buildNodes(array, start, leftCount, node, block, slotOf, forks.next()); },
+             [=, this] { node->right = buildNodes(array, start + leftCount + 1, n - 1 - leftCount, node, block, slotOf, forks.next()); });
+    pull(node);
+    return node;
+}
+
 /**
  * Checks if a rebuild is needed after a deletion and performs it if necessary.
  */
-template<typename T>
-void ScapeGoatTree<T>::DeletionRebuild(){
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::DeletionRebuild(){
         if (nNodes < 0.5 * max_nodes&& nNodes > 0) {  // α = 0.5 for deletion
-            auto temp_array = new T[nNodes];
-            int i = 0;
-            inorderTraversal(root, i, temp_array);
-           const TreeNode* oldRoot = root;
-            root = rebuildTree(0, nNodes - 1, nullptr, temp_array);
+            if (deferRebuild(nNodes)) {
+                if (!isReplaying) startRebuild(-1); // max_nodes is reset when the rebuilt tree lands
+                return;
+            }
+            root = rebuildSubtree(root, nullptr);
             rebuildCount++;
-            postorderTraversal(oldRoot);
             max_nodes = nNodes;
-            delete[] temp_array;
         }
         }
 /**
  * Returns a pointer to the root node of the tree.
  */
-template<typename T>
-const ScapeGoatTree<T>::TreeNode *ScapeGoatTree<T>::getRoot() {
+template<typename T, typename Aggregate>
+const ScapeGoatTree<T, Aggregate>::TreeNode *ScapeGoatTree<T, Aggregate>::getRoot() {
     return root;
 }
 
 // =====================
-// Traversals
+// Traversals
+// =====================
+
+/**
+ * Performs an in-order traversal to populate a sorted array with node values.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::inorderTraversal(const TreeNode* node, int& i, T*& array) const {
+if (!node) return;
+    if (const Forks forks = forkLevels(static_cast<int>(node->size))) {
+        collectValues(node, array + i, forks);
+        i += static_cast<int>(node->size);
+        return;
+    }
+    inorderTraversal(node->left, i,array);
+   array[i++]= node->value;
+    inorderTraversal(node->right, i,array);
+}
+
+/**
+ * Recursively returns all nodes in the subtree to the pool using post-order traversal.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::postorderTraversal(TreeNode* node) {
+    if (!node) return;
+    postorderTraversal(node->left);
+    postorderTraversal(node->right);
+    dispose(node);
+}
+
+/**
+ * Clones a subtree in pre-order, keeping sizes and aggregates.
+ */
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::TreeNode* ScapeGoatTree<T, Aggregate>::cloneSubtree(const TreeNode* node, TreeNode* parent_node) {
+    if (!node) return nullptr;
+    TreeNode* copy = makeNode(node->value, parent_node);
+    copy->size = node->size;
+    if constexpr (hasAggregate) copy->agg = node->agg;
+    copy->left = cloneSubtree(node->left, copy);
+    copy->right = cloneSubtree(node->right, copy);
+    return copy;
+}
+
+/**
+ * Copies other's shape as is: no inserts, no rebuilds and no undo commands.
+ * reserve() first, so a fresh tree gets all its nodes from a single slab.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::copyFrom(const ScapeGoatTree& other) {
+    pool.reserve(other.nNodes);
+    root = cloneSubtree(other.root, nullptr);
+    nNodes = other.nNodes;
+    max_nodes = other.max_nodes;
+    rebuildCount = other.rebuildCount;
+    ALPHA = other.ALPHA;
+    batchRebuildRatio = other.batchRebuildRatio;
+    backgroundRebuildMin = other.backgroundRebuildMin;
+    compactRebuildMin = other.compactRebuildMin;
+    rebuildBudget = other.rebuildBudget;
+    rebuildThreads = other.rebuildThreads;
+    executor = other.executor;
+}
+
+// =====================
+// Display (internal)
+// =====================1
+
+/**
+ * Formats the tree in pre-order.
+ */
+template<typename T, typename Aggregate>
+// diplay order w ostream (output stream)
+void ScapeGoatTree<T, Aggregate>::displayPreOrder(const TreeNode* node, std::ostream& os) {
+    if (!node) return;  // lw mfesh node bn return
+    os << node->value << " ";
+    displayPreOrder(node->left, os);
+    displayPreOrder(node->right, os);
+}
+
+/**
+ * Formats the tree in in-order.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::displayInOrder(const TreeNode* node, std::ostream& os) {
+    if (!node) return;
+    displayInOrder(node->left, os);
+    os << node->value << " ";
+    displayInOrder(node->right, os);
+}
+
+/**
+ * Formats the tree in post-order.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::displayPostOrder(const TreeNode* node, std::ostream& os) {
+    if (!node) return;
+    displayPostOrder(node->left, os);
+    displayPostOrder(node->right, os);
+    os << node->value << " ";
+}
+
+// =====================
+// Display (public)
+// =====================
+
+/**
+ * Returns a string representing the tree in pre-order traversal.
+ */
+template<typename T, typename Aggregate>
+std::string ScapeGoatTree<T, Aggregate>::displayPreOrder() {
+    if (!root) return "Tree is empty.";
+    std::ostringstream oss;
+    displayPreOrder(root, oss);
+    return oss.str();
+}
+
+/**
+ * Returns a string representing the tree in in-order traversal.
+ */
+template<typename T, typename Aggregate>
+std::string ScapeGoatTree<T, Aggregate>::displayInOrder() {
+    if (!root) return "Tree is empty.";
+    std::ostringstream oss;
+    displayInOrder(root, oss);
+    return oss.str();
+}
+
+/**
+ * Returns a string representing the tree in post-order traversal.
+ */
+template<typename T, typename Aggregate>
+std::string ScapeGoatTree<T, Aggregate>::displayPostOrder() {
+    if (!root) return "Tree is empty.";
+    std::ostringstream oss;
+    displayPostOrder(root, oss);
+    return oss.str();
+}
+
+/**
+ * Returns a string representing the tree in level-order traversal.
+ */
+template<typename T, typename Aggregate>
+std::string ScapeGoatTree<T, Aggregate>::displayLevels() {
+    if (!root) return "Tree is Empty.";
+    std::string result;
+    Queue<TreeNode*> q;
+    q.push(root);
+    int level =0;
+
+    while (!q.isEmpty()) {
+        result += "Level " + std::to_string(level++) + ": ";    // mn int l string b3dha bnro7 ll lvl ele ablo
+        const int nodesAtLevel = q.size();
+        for (int i = 0; i < nodesAtLevel; i++) {
+            TreeNode* curr = q.front(); // current node
+            q.pop(); // pop 3shan nshof el node ele b3dha
+
+            std::ostringstream oss;
+            oss << curr->value;
+            result += oss.str() + " ";  // str 3shan n7wlo string
+
+            if (curr->left)  q.push(curr->left);
+            if (curr->right) q.push(curr->right);
+        }
+        result += "\n";
+    }
+    return result;
+}
+
+
+
+// =====================
+// Operators
+// =====================
+
+/**
+ * Creates a new tree containing elements from both trees using linear merge.
+ */
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate> ScapeGoatTree<T, Aggregate>::operator+(const ScapeGoatTree& other)const  {
+    ScapeGoatTree result;
+    result.rebuildThreads = rebuildThreads;
+    result.executor = executor;
+    T* array = new T[nNodes];
+    T* other_array = new T[other.nNodes];
+    int i = 0;
+    inorderTraversal(root, i, array);
+    int i2 = 0;
+    other.inorderTraversal(other.root, i2, other_array);
+    T* temp_array = new T[nNodes + other.nNodes];
+    int idx = 0, idx1 = 0, idx2 = 0;
+
+    // Linear Merge (O(N+M)) to keep the array sorted
+    /**
+         * if first is smaller then take it
+         * and increment the indicies for the merged list and the current array
+         * else if second is smaller then take it and increment the indicies for the merged list and the current array
+         * else (duplicates) take one of them and skip the duplicate in the other array
+         */
+    while (idx1 < nNodes && idx2 < other.nNodes) { //run as long as both arrays have elements
+        if (array[idx1] < other_array[idx2]) temp_array[idx++] = array[idx1++];
+        else if (array[idx1] > other_array[idx2]) temp_array[idx++] = other_array[idx2++];
+        else { // duplicates
+            temp_array[idx++] = array[idx1++];
+            idx2++;
+        }
+    }
+    while (idx1 < nNodes) temp_array[idx++] = array[idx1++]; //append remaining elements from first array
+    while (idx2 < other.nNodes) temp_array[idx++] = other_array[idx2++]; //append remaining elements from second array
+
+    //Rebuild  (O(N+M))
+    result.root = result.rebuildTree(0, idx - 1, nullptr, temp_array);
+    result.nNodes = idx;
+    result.max_nodes = idx;
+    delete[] temp_array;
+    delete[] array;
+    delete[] other_array;
+    return result;
+}
+
+// =====================
+// Snapshots
+// =====================
+
+/**
+ * Takes an O(1) snapshot: every node currently in the tree becomes frozen.
+ */
+template<typename T, typename Aggregate>
+typename ScapeGoatTree<T, Aggregate>::Snapshot ScapeGoatTree<T, Aggregate>::snapshot() {
+    if (snapshots.size()) collectSnapshots();
+    auto state = std::make_shared<SnapshotState>();
+    state->root = root;
+    state->nNodes = nNodes;
+    state->epoch = snapshotClock.fetch_add(1, std::memory_order_relaxed);
+    epoch = state->epoch + 1; // nodes created from now on are invisible to it
+    sharedBelow = epoch;
+    snapshots.push_back(state);
+    return Snapshot(std::move(state));
+}
+
+template<typename T, typename Aggregate>
+unsigned int ScapeGoatTree<T, Aggregate>::liveSnapshots() {
+    if (snapshots.size()) collectSnapshots();
+    return snapshots.size();
+}
+
+/**
+ * Frees a node that left the tree, or parks it until no snapshot can see it.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::dispose(TreeNode* node) {
+    if (isFrozen(node)) retired.push_back({node, epoch});
+    else pool.destroy(node);
+}
+
+/**
+ * Path copying: a frozen node on the path is replaced by a private copy that
+ * takes over its children. Only parent pointers of shared nodes are touched,
+ * and snapshots never read those.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::unsharePath(const int depth) {
+    for (int i = 0; i < depth; i++) {
+        TreeNode* node = path[i];
+        if (!isFrozen(node)) continue;
+        TreeNode* parent = i > 0 ? path[i - 1] : nullptr;
+        TreeNode* copy = makeNode(node->value, parent);
+        copy->left = node->left;
+        copy->right = node->right;
+        copy->size = node->size;
+        if constexpr (hasAggregate) copy->agg = node->agg;
+        if (copy->left) copy->left->parent = copy;
+        if (copy->right) copy->right->parent = copy;
+        if (!parent) root = copy;
+        else if (parent->left == node) parent->left = copy;
+        else parent->right = copy;
+        retired.push_back({node, epoch});
+        path[i] = copy;
+    }
+}
+
+/**
+ * Threads the subtree into an in-order list like flattenNodes. With live
+ * snapshots, frozen nodes are swapped for fresh copies so a rebuild never
+ * relinks a node a snapshot can still see.
+ */
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::TreeNode* ScapeGoatTree<T, Aggregate>::flattenOwned(TreeNode* node, TreeNode* head) {
+    if (!sharedBelow) return flattenNodes(node, head);
+    if (!node) return head;
+    TreeNode* left = node->left;
+    TreeNode* right = node->right;
+    TreeNode* mine = node;
+    if (isFrozen(node)) {
+        mine = makeNode(node->value);
+        retired.push_back({node, epoch});
+    }
+    mine->right = flattenOwned(right, head); // everything after node
+    return flattenOwned(left, mine);          // everything before node
+}
+
+/**
+ * A retired node is visible to the snapshots taken in [birth, death); once none
+ * of those is alive it goes back to the pool.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::collectSnapshots() {
+    bool expired = false;
+    for (unsigned int i = 0; i < snapshots.size() && !expired; i++) expired = snapshots[i].expired();
+    if (!expired) return;
+
+    Vector<std::weak_ptr<SnapshotState>> alive;
+    Vector<std::uint64_t> epochs;
+    sharedBelow = 0;
+    for (unsigned int i = 0; i < snapshots.size(); i++) {
+        if (const auto state = snapshots[i].lock()) {
+            alive.push_back(snapshots[i]);
+            epochs.push_back(state->epoch);
+            if (state->epoch + 1 > sharedBelow) sharedBelow = state->epoch + 1;
+        }
+    }
+    snapshots = std::move(alive);
+
+    Vector<Retired> kept;
+    for (unsigned int i = 0; i < retired.size(); i++) {
+        bool visible = false;
+        for (unsigned int j = 0; j < epochs.size() && !visible; j++)
+            visible = retired[i].node->birth <= epochs[j] && epochs[j] < retired[i].death;
+        if (visible) kept.push_back(retired[i]);
+        else pool.destroy(retired[i].node);
+    }
+    retired = std::move(kept);
+}
+
+/**
+ * Gives the pool, the live nodes and the retired ones to the live snapshots,
+ * which free them together when the last of them goes. Nothing is walked here.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::orphanSnapshots(const bool keepContents) {
+    if (snapshots.size()) collectSnapshots();
+    if (!snapshots.size()) return;
+
+    auto orphans = std::make_shared<Orphans>();
+    handOver(*orphans);
+    for (unsigned int i = 0; i < snapshots.size(); i++)
+        if (const auto state = snapshots[i].lock()) state->keepAlive = orphans;
+    snapshots = Vector<std::weak_ptr<SnapshotState>>();
+    sharedBelow = 0;
+
+    const TreeNode* old = root;
+    root = nullptr;
+    if (keepContents) {
+        // the orphans stay alive until we return, so the old nodes are safe to read
+        pool.reserve(nNodes);
+        root = cloneSubtree(old, nullptr);
+    } else {
+        nNodes = 0;
+        max_nodes = 0;
+    }
+}
+
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::handOver(Orphans& orphans) {
+    orphans.loose = std::move(retired);
+    retired = Vector<Retired>();
+    for (; condemnedAt < condemned.size(); condemnedAt++) orphans.loose.push_back(condemned[condemnedAt]);
+    condemned = Vector<Retired>();
+    condemnedAt = 0;
+    orphans.trees = std::move(condemnedTrees);
+    condemnedTrees = Stack<TreeNode*>();
+    if (root) orphans.trees.push(root);
+    orphans.pool = std::move(pool);
+}
+
+template<typename T, typename Aggregate>
+bool ScapeGoatTree<T, Aggregate>::Snapshot::search(const T& key) const {
+    return searchIn(state->root, key);
+}
+
+template<typename T, typename Aggregate>
+T ScapeGoatTree<T, Aggregate>::Snapshot::sumInRange(T min, T max) const {
+    return sumIn(state->root, min, max);
+}
+
+template<typename T, typename Aggregate>
+template<typename Op>
+typename Op::value_type ScapeGoatTree<T, Aggregate>::Snapshot::aggregateInRange(const T& min, const T& max) const {
+    return aggregateIn<Op>(state->root, min, max);
+}
+
+template<typename T, typename Aggregate>
+T ScapeGoatTree<T, Aggregate>::Snapshot::kthSmallest(const int k) const {
+    if (k < 1 || k > state->nNodes) throw std::out_of_range("k is out of bounds");
+    return kthSmallestHelper(state->root, k);
+}
+
+template<typename T, typename Aggregate>
+FrozenScapeGoatSet<T> ScapeGoatTree<T, Aggregate>::freeze() const {
+    T* values = new T[nNodes];
+    int i = 0;
+    inorderTraversal(root, i, values);
+    const Forks forks = forkLevels(nNodes);
+    return FrozenScapeGoatSet<T>(values, nNodes, forks.pool, 1 << forks.levels);
+}
+
+/**
+ * Bumps the epoch exactly like snapshot(), without tracking a SnapshotState:
+ * the caller tracks its readers and calls reclaimRetired itself.
+ */
+template<typename T, typename Aggregate>
+std::uint64_t ScapeGoatTree<T, Aggregate>::publishVersion() {
+    const std::uint64_t version = snapshotClock.fetch_add(1, std::memory_order_relaxed);
+    epoch = version + 1;
+    sharedBelow = epoch;
+    return version;
+}
+
+/**
+ * Deaths only grow along the retired list, so the freeable nodes are a prefix.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::reclaimRetired(const std::uint64_t oldestReader) {
+    unsigned int freed = 0;
+    while (freed < retired.size() && retired[freed].death <= oldestReader) pool.destroy(retired[freed++].node);
+    if (!freed) return;
+    // slide the survivors down in place; pop_back only reallocates to shrink
+    const unsigned int kept = retired.size() - freed;
+    for (unsigned int i = 0; i < kept; i++) retired[i] = retired[freed + i];
+    while (retired.size() > kept) retired.pop_back();
+}
+
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::dropVersions() {
+    for (unsigned int i = 0; i < retired.size(); i++) pool.destroy(retired[i].node);
+    retired = Vector<Retired>();
+    sharedBelow = 0;
+}
+
+// =====================
+// Background and incremental rebuild
+// =====================
+
+/**
+ * State of a rebuild in flight. It rebuilds the subtree holding the keys in
+ * (lo, hi), or the whole tree when unbounded. The writer appends every change
+ * in that range to log under lock; whoever builds fresh (the worker, or the
+ * writer a few steps per operation) replays the log until it is empty.
+ */
+template<typename T, typename Aggregate>
+struct ScapeGoatTree<T, Aggregate>::RebuildJob {
+    Snapshot view;          // keeps from alive; frozen for the writer
+    const TreeNode* from{}; // root of the subtree being rebuilt, in view
+    bool hasLo = false, hasHi = false;
+    T lo{}, hi{};
+    ScapeGoatTree fresh;    // the balanced replacement
+    std::mutex lock;
+    Queue<Command<T>> log;  // writes not replayed on fresh yet, reserved up front
+    std::atomic<bool> copied{false}, ready{false}, abort{false};
+    bool released = false;  // view dropped by the writer
+    std::thread worker;
+
+    // incremental mode: fresh's nodes are made in key order, then linked
+    struct Span {
+        int lo, hi;  // nodes[lo, hi) form one subtree
+        bool linked; // children already done
+    };
+    typename Snapshot::iterator next{nullptr};
+    std::unique_ptr<TreeNode*[]> nodes;
+    int total = 0, made = 0;
+    Stack<Span> spans;
+
+    [[nodiscard]] bool covers(const T& key) const { return (!hasLo || lo < key) && (!hasHi || key < hi); }
+    ~RebuildJob() {
+        if constexpr (!std::is_trivially_destructible_v<TreeNode>)
+            if (nodes) for (int i = 0; i < made; i++) fresh.pool.destroy(nodes[i]);
+    }
+};
+
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::setBackgroundRebuild(const int minNodes) {
+    if (minNodes < 0) return;
+    if (!minNodes || rebuildBudget) cancelRebuild(); // an incremental job cannot carry on
+    backgroundRebuildMin = minNodes;
+    rebuildBudget = 0;
+}
+
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::setIncrementalRebuild(const int budget) {
+    if (budget < 0) return;
+    if (!budget || backgroundRebuildMin) cancelRebuild(); // nor can a background one
+    rebuildBudget = budget;
+    backgroundRebuildMin = 0;
+}
+
+/**
+ * The key range comes from the recorded path above the goat. The view freezes
+ * the whole tree, so until the goat's keys are copied the writer path-copies
+ * like with any snapshot.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::startRebuild(const int goat) {
+    if (rebuildJob) return;
+    rebuildJob = std::make_unique<RebuildJob>();
+    RebuildJob& job = *rebuildJob;
+    job.view = snapshot();
+    job.from = goat < 0 ? root : path[goat];
+    for (int i = 0; i < goat; i++) {
+        if (path[i]->right == path[i + 1]) {
+            job.hasLo = true;
+            job.lo = path[i]->value;
+        } else {
+            job.hasHi = true;
+            job.hi = path[i]->value;
+        }
+    }
+    job.total = static_cast<int>(countN(job.from));
+    job.fresh.ALPHA = ALPHA;
+    job.fresh.epoch = epoch;
+    job.fresh.rebuildThreads = rebuildThreads;
+    job.fresh.executor = executor;
+    job.fresh.isUndoing = true; // the history stays with this tree
+    if (rebuildBudget) {
+        job.nodes.reset(new TreeNode*[job.total]);
+        job.fresh.pool.reserve(job.total);
+        job.fresh.rebuildBudget = rebuildBudget;
+        job.fresh.isReplaying = true;
+        // copying and linking take about 3 * total steps, and each operation
+        // meanwhile logs at most one write
+        job.log.reserve(3 * job.total / rebuildBudget + 16);
+        job.next = typename Snapshot::iterator(job.from);
+        return;
+    }
+    job.worker = std::thread(runRebuild, &job);
+}
+
+/**
+ * Copies the subtree's keys, builds the balanced tree in O(n), then replays the
+ * log in rounds. ready is set under the lock with nothing left to replay.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::runRebuild(RebuildJob* job) {
+    const int n = job->total;
+    T* keys = new T[n];
+    int i = 0;
+    for (typename Snapshot::iterator it(job->from); it != typename Snapshot::iterator(nullptr); ++it) keys[i++] = *it;
+    job->copied.store(true, std::memory_order_release);
+    if (!job->abort.load(std::memory_order_relaxed)) job->fresh.assignArray(keys, n, false);
+    delete[] keys;
+
+    Vector<Command<T>> batch;
+    while (!job->abort.load(std::memory_order_relaxed)) {
+        batch.clear();
+        {
+            std::lock_guard guard(job->lock);
+            if (job->log.isEmpty()) {
+                job->ready.store(true, std::memory_order_release);
+                return;
+            }
+            for (; !job->log.isEmpty(); job->log.pop()) batch.push_back(job->log.front());
+        }
+        for (unsigned int c = 0; c < batch.size(); c++) {
+            if (batch[c].type == OpType::Insert) job->fresh.insert(batch[c].value);
+            else job->fresh.deleteValue(batch[c].value);
+        }
+    }
+}
+
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::pollRebuild() {
+    if (rebuildBudget) {
+        reclaimCondemned(rebuildBudget);
+        if (rebuildJob) advanceRebuild(rebuildBudget);
+        return;
+    }
+    reclaimCondemned(RECLAIM_STEPS);
+    if (!rebuildJob) return;
+    if (rebuildJob->ready.load(std::memory_order_acquire)) finishRebuild();
+    else if (!rebuildJob->released && rebuildJob->copied.load(std::memory_order_acquire)) releaseView();
+}
+
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::reclaimCondemned(const int steps) {
+    for (int i = 0; i < steps; i++) {
+        if (condemnedAt < condemned.size()) {
+            pool.destroy(condemned[condemnedAt++].node);
+        } else if (!condemnedTrees.isEmpty()) {
+            TreeNode* node = condemnedTrees.pop();
+            if (node->left) condemnedTrees.push(node->left);
+            if (node->right) condemnedTrees.push(node->right);
+            pool.destroy(node);
+        } else {
+            break;
+        }
+    }
+    if (condemnedAt && condemnedAt == condemned.size()) {
+        condemned = Vector<Retired>();
+        condemnedAt = 0;
+    }
+}
+
+/**
+ * Each step copies one key, releases the view, links one subtree (children
+ * first, in the shape buildFromList makes) or replays one logged write.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::advanceRebuild(const int steps) {
+    RebuildJob& job = *rebuildJob;
+    for (int step = 0; step < steps; step++) {
+        if (job.made < job.total) {
+            job.nodes[job.made++] = job.fresh.makeNode(*job.next);
+            ++job.next;
+        } else if (!job.released) {
+            releaseView();
+            if (job.total) job.spans.push({0, job.total, false});
+        } else if (!job.spans.isEmpty()) {
+            const typename RebuildJob::Span span = job.spans.pop();
+            const int mid = span.lo + (span.hi - span.lo - 1) / 2;
+            if (!span.linked) {
+                job.spans.push({span.lo, span.hi, true});
+                if (mid + 1 < span.hi) job.spans.push({mid + 1, span.hi, false});
+                if (span.lo < mid) job.spans.push({span.lo, mid, false});
+                continue;
+            }
+            TreeNode* node = job.nodes[mid];
+            node->left = span.lo < mid ? job.nodes[span.lo + (mid - span.lo - 1) / 2] : nullptr;
+            node->right = mid + 1 < span.hi ? job.nodes[mid + 1 + (span.hi - mid - 2) / 2] : nullptr;
+            if (node->left) node->left->parent = node;
+            if (node->right) node->right->parent = node;
+            node->size = span.hi - span.lo;
+            pull(node);
+        } else if (job.nodes) {
+            job.fresh.root = job.total ? job.nodes[(job.total - 1) / 2] : nullptr;
+            job.fresh.nNodes = job.fresh.max_nodes = job.total;
+            job.nodes.reset();
+        } else if (!job.log.isEmpty()) {
+            const Command<T> change = job.log.front();
+            job.log.pop();
+            if (change.type == OpType::Insert) job.fresh.insert(change.value);
+            else job.fresh.deleteValue(change.value);
+        } else {
+            finishRebuild();
+            return;
+        }
+    }
+}
+
+/**
+ * In incremental mode with no other snapshot alive, the nodes kept for the view
+ * are condemned, so they are freed at the budget's pace instead of all at once.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::releaseView() {
+    rebuildJob->view = Snapshot();
+    rebuildJob->released = true;
+    if (!rebuildBudget) return;
+    for (unsigned int i = 0; i < snapshots.size(); i++)
+        if (!snapshots[i].expired()) return;
+    if (condemnedAt == condemned.size()) {
+        condemned = std::move(retired);
+        condemnedAt = 0;
+    } else {
+        for (unsigned int i = 0; i < retired.size(); i++) condemned.push_back(retired[i]);
+    }
+    retired = Vector<Retired>();
+    snapshots = Vector<std::weak_ptr<SnapshotState>>();
+    sharedBelow = 0;
+}
+
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::logChange(const OpType type, const T& value) {
+    if (!rebuildJob || !rebuildJob->covers(value)) return;
+    std::lock_guard guard(rebuildJob->lock);
+    rebuildJob->log.push({type, value});
+}
+
+/**
+ * Replays whatever is left of the log (at most the writes since the worker's
+ * last round) and swaps fresh in.
+ *
+ * A subtree job looks its range up again: the first node inside it on the way
+ * down roots every key of the range. If that subtree holds keys outside the
+ * range too (a rebuild or a delete above reshaped it), the job is dropped.
+ * Otherwise it holds exactly fresh's keys, so sizes and aggregates above stay
+ * valid and one pointer is swapped; the old nodes are condemned.
+ *
+ * The old nodes of a whole tree go to live snapshots if there are any.
+ * Otherwise an incremental rebuild condemns them, and a background one hands
+ * them to the reaper thread, which frees them and their slabs.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::finishRebuild() {
+    RebuildJob& job = *rebuildJob;
+    if (job.worker.joinable()) job.worker.join();
+    ScapeGoatTree& fresh = job.fresh;
+    for (; !job.log.isEmpty(); job.log.pop()) {
+        const Command<T> change = job.log.front();
+        if (change.type == OpType::Insert) fresh.insert(change.value);
+        else fresh.deleteValue(change.value);
+    }
+    if (!job.released) releaseView();
+    if (snapshots.size()) collectSnapshots();
+
+    if (job.hasLo || job.hasHi) {
+        path.clear();
+        TreeNode* node = root;
+        while (node && !job.covers(node->value)) {
+            path.push_back(node);
+            node = job.hasHi && !(node->value < job.hi) ? node->left : node->right;
+        }
+        const TreeNode* first = node;
+        const TreeNode* last = node;
+        while (first && first->left) first = first->left;
+        while (last && last->right) last = last->right;
+        if (node && job.covers(first->value) && job.covers(last->value) && static_cast<int>(node->size) == fresh.nNodes) {
+            if (sharedBelow) unsharePath(static_cast<int>(path.size()));
+            TreeNode* parent = path.size() ? path[path.size() - 1] : nullptr;
+            fresh.root->parent = parent;
+            if (!parent) root = fresh.root;
+            else if (parent->left == node) parent->left = fresh.root;
+            else parent->right = fresh.root;
+            pool.adopt(fresh.pool);
+            if (!sharedBelow) {
+                condemnedTrees.push(node);
+            } else {
+                // a snapshot may see some of them: retire what it can
+                Stack<TreeNode*> todo;
+                todo.push(node);
+                while (!todo.isEmpty()) {
+                    TreeNode* old = todo.pop();
+                    if (old->left) todo.push(old->left);
+                    if (old->right) todo.push(old->right);
+                    dispose(old);
+                }
+            }
+            fresh.root = nullptr;
+            fresh.nNodes = 0;
+            rebuildCount++;
+        }
+        rebuildJob.reset();
+        return;
+    }
+
+    orphanSnapshots(false);
+    if (root && rebuildBudget) {
+        condemnedTrees.push(root);
+        pool.adopt(fresh.pool);
+    } else if (root) {
+        if (reaper.joinable()) reaper.join();
+        auto orphans = std::make_shared<Orphans>();
+        handOver(*orphans);
+        reaper = std::thread([orphans = std::move(orphans)]() mutable { orphans.reset(); });
+        pool = std::move(fresh.pool);
+    } else {
+        pool = std::move(fresh.pool);
+    }
+    root = fresh.root;
+    nNodes = fresh.nNodes;
+    max_nodes = fresh.max_nodes;
+    fresh.root = nullptr;
+    fresh.nNodes = 0;
+    fresh.max_nodes = 0;
+    retired = Vector<Retired>();
+    sharedBelow = 0;
+    rebuildCount++;
+    rebuildJob.reset();
+}
+
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::waitForRebuild() {
+    if (!rebuildJob) return;
+    if (rebuildBudget) {
+        while (rebuildJob) advanceRebuild(rebuildBudget);
+        return;
+    }
+    rebuildJob->worker.join();
+    if (rebuildJob->ready.load(std::memory_order_acquire)) finishRebuild();
+    else rebuildJob.reset();
+}
+
+/**
+ * Waits for the worker to notice; a build that has started runs to its end.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::cancelRebuild() {
+    if (rebuildJob) {
+        rebuildJob->abort.store(true, std::memory_order_relaxed);
+        if (rebuildJob->worker.joinable()) rebuildJob->worker.join();
+        rebuildJob.reset();
+    }
+    while (rebuildWork()) reclaimCondemned(std::numeric_limits<int>::max());
+}
+
+template<typename T, typename Aggregate>
+bool ScapeGoatTree<T, Aggregate>::searchIn(const TreeNode* node, const T& key) {
+    while (node != nullptr) {
+        if (key == node->value) return true;
+        node = key < node->value ? node->left : node->right; // one select instead of a second branch
+    }
+    return false;
+}
+
+template<typename T, typename Aggregate>
+const typename ScapeGoatTree<T, Aggregate>::TreeNode* ScapeGoatTree<T, Aggregate>::successorIn(const TreeNode* node,
+                                                                                            const T& value) {
+    const TreeNode* successor = nullptr;
+    while (node) {
+        if (value < node->value) {
+            successor = node;
+            node = node->left;
+        } else {
+            node = node->right;
+        }
+    }
+    return successor;
+}
+
+template<typename T, typename Aggregate>
+T ScapeGoatTree<T, Aggregate>::sumIn(const TreeNode* node, T min, T max) {
+    if constexpr (std::is_same_v<Aggregate, SumAggregate<T>>) return aggregateHelper(node, min, max);
+    else return sumHelper(node, min, max);
+}
+
+template<typename T, typename Aggregate>
+template<typename Op>
+typename Op::value_type ScapeGoatTree<T, Aggregate>::aggregateIn(const TreeNode* node, const T& min, const T& max) {
+    if (max < min) return Op::identity();
+    if constexpr (std::is_same_v<Op, Aggregate>) {
+        return aggregateHelper(node, min, max);
+    } else {
+        typename Op::value_type acc = Op::identity();
+        foldHelper<Op>(node, min, max, acc);
+        return acc;
+    }
+}
+
+// =====================
+// Set algebra
 // =====================
 
 /**
- * Performs an in-order traversal to populate a sorted array with node values.
+ * Linear merge of two sorted, distinct arrays keeping the keys selected by keep.
  */
-template<typename T>
-void ScapeGoatTree<T>::inorderTraversal(const TreeNode* node, int& i, T*& array) const {
-if (!node) return;
-    inorderTraversal(node->left, i,array);
-   array[i++]= node->value;
-    inorderTraversal(node->right, i,array);
+template<typename T, typename Aggregate>
+int ScapeGoatTree<T, Aggregate>::mergeKeys(const T* a, const int na, const T* b, const int nb,
+                                           const int keep, T* out) {
+    int idx = 0, idx1 = 0, idx2 = 0;
+    auto take = [&](const T& value, const int flag) {
+        if (!(keep & flag)) return;
+        if (out) out[idx] = value;
+        idx++;
+    };
+    while (idx1 < na && idx2 < nb) {
+        if (a[idx1] < b[idx2]) take(a[idx1++], KeepLeft);
+        else if (b[idx2] < a[idx1]) take(b[idx2++], KeepRight);
+        else { // in both
+            take(a[idx1++], KeepBoth);
+            idx2++;
+        }
+    }
+    while (idx1 < na) take(a[idx1++], KeepLeft);
+    while (idx2 < nb) take(b[idx2++], KeepRight);
+    return idx;
 }
 
 /**
- * Recursively deletes all nodes in the subtree using post-order traversal.
+ * Each node binary-searches its key among the probes it was handed and passes
+ * the smaller ones left and the larger ones right.
  */
-template<typename T>
-void ScapeGoatTree<T>::postorderTraversal(const TreeNode* node) {
-    if (!node) return;
-    postorderTraversal(node->left);
-    postorderTraversal(node->right);
-    delete node;
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::matchKeys(const TreeNode* node, const T* keys, const int lo, const int hi,
+                                            bool* found) {
+    if (!node || lo >= hi) return;
+    const int pos = static_cast<int>(std::lower_bound(keys + lo, keys + hi, node->value) - keys);
+    int rightLo = pos;
+    if (pos < hi && !(node->value < keys[pos])) {
+        found[pos] = true;
+        rightLo++;
+    }
+    matchKeys(node->left, keys, lo, pos, found);
+    matchKeys(node->right, keys, rightLo, hi, found);
 }
 
 /**
- * Performs a pre-order traversal for internal processing.
+ * The single-key walks branch like search(), without touching memory beyond
+ * the nodes on the path; a successor is then found by climbing back from the
+ * last node, whose ancestors are still in cache.
  */
-template<typename T>
-void ScapeGoatTree<T>::preorderTraversal(const TreeNode* node) {
-    if (!node) return;
-    insert(node->value);
-    preorderTraversal(node->left);
-    preorderTraversal(node->right);
+template<typename T, typename Aggregate>
+template<bool Successors, typename Match, typename End>
+void ScapeGoatTree<T, Aggregate>::descendBatch(TreeNode* node, const T* keys, const int lo, const int hi,
+                                               TreeNode* successor, Match& match, End& end) {
+    if (lo >= hi) return;
+    if (!node) {
+        if constexpr (Successors) for (int i = lo; i < hi; i++) end(i, successor);
+        return;
+    }
+    if (hi - lo <= BATCH_SPLIT_MIN) { // too few probes left to share much: walk each one on its own
+        for (int i = lo; i < hi; i++) {
+            const T& key = keys[i];
+            TreeNode* curr = node;
+            if constexpr (Successors) {
+                TreeNode* last = nullptr;
+                while (curr) {
+                    last = curr;
+                    curr = key < curr->value ? curr->left : curr->right;
+                }
+                end(i, key < last->value ? last : findSuccessor(last));
+            } else {
+                while (curr) {
+                    if (key == curr->value) {
+                        match(i, curr);
+                        break;
+                    }
+                    curr = key < curr->value ? curr->left : curr->right;
+                }
+            }
+        }
+        return;
+    }
+    const int pos = static_cast<int>(std::lower_bound(keys + lo, keys + hi, node->value) - keys);
+    int above = pos;
+    if constexpr (!Successors) while (above < hi && !(node->value < keys[above])) match(above++, node);
+    descendBatch<Successors>(node->left, keys, lo, pos, node, match, end);
+    descendBatch<Successors>(node->right, keys, above, hi, successor, match, end);
 }
 
-// =====================
-// Display (internal)
-// =====================1
-
 /**
- * Formats the tree in pre-order.
+ * Unsorted keys are sorted through a permutation, so results still land at
+ * the caller's indices; equal keys stay next to each other and all get theirs.
  */
-template<typename T>
-// diplay order w ostream (output stream)
-void ScapeGoatTree<T>::displayPreOrder(const TreeNode* node, std::ostream& os) {
-    if (!node) return;  // lw mfesh node bn return
-    os << node->value << " ";
-    displayPreOrder(node->left, os);
-    displayPreOrder(node->right, os);
+template<typename T, typename Aggregate>
+template<bool Successors, typename Match, typename End>
+void ScapeGoatTree<T, Aggregate>::lookupBatch(const T* keys, const int m, Match match, End end) const {
+    if (m <= 0) return;
+    if (std::is_sorted(keys, keys + m)) {
+        descendBatch<Successors>(root, keys, 0, m, nullptr, match, end);
+        return;
+    }
+    int* order = new int[m];
+    for (int i = 0; i < m; i++) order[i] = i;
+    std::sort(order, order + m, [keys](const int a, const int b) { return keys[a] < keys[b]; });
+    T* sorted = new T[m];
+    for (int i = 0; i < m; i++) sorted[i] = keys[order[i]];
+    auto matchAt = [&](const int i, TreeNode* node) { match(order[i], node); };
+    auto endAt = [&](const int i, TreeNode* successor) { end(order[i], successor); };
+    descendBatch<Successors>(root, sorted, 0, m, nullptr, matchAt, endAt);
+    delete[] sorted;
+    delete[] order;
 }
 
-/**
- * Formats the tree in in-order.
- */
-template<typename T>
-void ScapeGoatTree<T>::displayInOrder(const TreeNode* node, std::ostream& os) {
-    if (!node) return;
-    displayInOrder(node->left, os);
-    os << node->value << " ";
-    displayInOrder(node->right, os);
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::searchBatch(const T* keys, const int m, bool* found) const {
+    std::fill(found, found + std::max(m, 0), false);
+    lookupBatch<false>(keys, m, [found](const int i, TreeNode*) { found[i] = true; }, [](int, TreeNode*) {});
 }
 
-/**
- * Formats the tree in post-order.
- */
-template<typename T>
-void ScapeGoatTree<T>::displayPostOrder(const TreeNode* node, std::ostream& os) {
-    if (!node) return;
-    displayPostOrder(node->left, os);
-    displayPostOrder(node->right, os);
-    os << node->value << " ";
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::findBatch(const T* keys, const int m, TreeNode** out) const {
+    std::fill(out, out + std::max(m, 0), nullptr);
+    lookupBatch<false>(keys, m, [out](const int i, TreeNode* node) { out[i] = node; }, [](int, TreeNode*) {});
 }
 
-// =====================
-// Display (public)
-// =====================
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::successorBatch(const T* keys, const int m, T* successors, bool* found) const {
+    lookupBatch<true>(keys, m, [](int, TreeNode*) {}, [successors, found](const int i, TreeNode* successor) {
+        found[i] = successor != nullptr;
+        if (successor) successors[i] = successor->value;
+    });
+}
 
 /**
- * Returns a string representing the tree in pre-order traversal.
+ * Probing costs about m log(n/m) comparisons against n + m for the merge.
  */
-template<typename T>
-std::string ScapeGoatTree<T>::displayPreOrder() {
-    if (!root) return "Tree is empty.";
-    std::ostringstream oss;
-    displayPreOrder(root, oss);
-    return oss.str();
+template<typename T, typename Aggregate>
+bool ScapeGoatTree<T, Aggregate>::preferSearch(const int small, const int large) {
+    if (small == 0) return true;
+    const double ratio = static_cast<double>(large) / small;
+    return 2.0 * small * std::log2(ratio + 1.0) < small + large;
 }
 
 /**
- * Returns a string representing the tree in in-order traversal.
+ * Returns the tree's keys as a new sorted array of nNodes elements.
  */
-template<typename T>
-std::string ScapeGoatTree<T>::displayInOrder() {
-    if (!root) return "Tree is empty.";
-    std::ostringstream oss;
-    displayInOrder(root, oss);
-    return oss.str();
+template<typename T, typename Aggregate>
+T* ScapeGoatTree<T, Aggregate>::sortedKeys() const {
+    T* array = new T[nNodes];
+    int i = 0;
+    inorderTraversal(root, i, array);
+    return array;
 }
 
 /**
- * Returns a string representing the tree in post-order traversal.
+ * Keys present in both trees.
  */
-template<typename T>
-std::string ScapeGoatTree<T>::displayPostOrder() {
-    if (!root) return "Tree is empty.";
-    std::ostringstream oss;
-    displayPostOrder(root, oss);
-    return oss.str();
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate> ScapeGoatTree<T, Aggregate>::intersect(const ScapeGoatTree& other) const {
+    const ScapeGoatTree& small = nNodes <= other.nNodes ? *this : other;
+    const ScapeGoatTree& large = nNodes <= other.nNodes ? other : *this;
+    ScapeGoatTree result;
+    result.rebuildThreads = rebuildThreads;
+    result.executor = executor;
+    T* keys = small.sortedKeys();
+    int n = 0;
+    if (preferSearch(small.nNodes, large.nNodes)) {
+        bool* found = new bool[small.nNodes]{};
+        matchKeys(large.root, keys, 0, small.nNodes, found);
+        for (int i = 0; i < small.nNodes; i++)
+            if (found[i]) keys[n++] = std::move(keys[i]);
+        result.assignArray(keys, n, false);
+        delete[] found;
+    } else {
+        T* other_keys = large.sortedKeys();
+        T* merged = new T[small.nNodes];
+        n = mergeKeys(keys, small.nNodes, other_keys, large.nNodes, KeepBoth, merged);
+        result.assignArray(merged, n, false);
+        delete[] merged;
+        delete[] other_keys;
+    }
+    delete[] keys;
+    return result;
 }
 
 /**
- * Returns a string representing the tree in level-order traversal.
+ * Keys of this tree that are not in other. Only a much larger other is probed;
+ * otherwise the result is O(n) anyway and a merge is cheapest.
  */
-template<typename T>
-std::string ScapeGoatTree<T>::displayLevels() {
-    if (!root) return "Tree is Empty.";
-    std::string result;
-    Queue<TreeNode*> q;
-    q.push(root);
-    int level =0;
-
-    while (!q.isEmpty()) {
-        result += "Level " + std::to_string(level++) + ": ";    // mn int l string b3dha bnro7 ll lvl ele ablo
-        const int nodesAtLevel = q.size();
-        for (int i = 0; i < nodesAtLevel; i++) {
-            TreeNode* curr = q.front(); // current node
-            q.pop(); // pop 3shan nshof el node ele b3dha
-
-            std::ostringstream oss;
-            oss << curr->value;
-            result += oss.str() + " ";  // str 3shan n7wlo string
-
-            if (curr->left)  q.push(curr->left);
-            if (curr->right) q.push(curr->right);
-        }
-        result += "\n";
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate> ScapeGoatTree<T, Aggregate>::difference(const ScapeGoatTree& other) const {
+    ScapeGoatTree result;
+    result.rebuildThreads = rebuildThreads;
+    result.executor = executor;
+    T* keys = sortedKeys();
+    int n = 0;
+    if (nNodes <= other.nNodes && preferSearch(nNodes, other.nNodes)) {
+        bool* found = new bool[nNodes]{};
+        matchKeys(other.root, keys, 0, nNodes, found);
+        for (int i = 0; i < nNodes; i++)
+            if (!found[i]) keys[n++] = std::move(keys[i]);
+        result.assignArray(keys, n, false);
+        delete[] found;
+    } else {
+        T* other_keys = other.sortedKeys();
+        T* merged = new T[nNodes];
+        n = mergeKeys(keys, nNodes, other_keys, other.nNodes, KeepLeft, merged);
+        result.assignArray(merged, n, false);
+        delete[] merged;
+        delete[] other_keys;
     }
+    delete[] keys;
     return result;
 }
 
+/**
+ * Keys in exactly one of the two trees.
+ */
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate> ScapeGoatTree<T, Aggregate>::symmetricDifference(const ScapeGoatTree& other) const {
+    ScapeGoatTree result;
+    result.rebuildThreads = rebuildThreads;
+    result.executor = executor;
+    T* keys = sortedKeys();
+    T* other_keys = other.sortedKeys();
+    T* merged = new T[nNodes + other.nNodes];
+    const int n = mergeKeys(keys, nNodes, other_keys, other.nNodes, KeepLeft | KeepRight, merged);
+    result.assignArray(merged, n, false);
+    delete[] merged;
+    delete[] other_keys;
+    delete[] keys;
+    return result;
+}
 
+/**
+ * Checks if every key of this tree is also in other.
+ */
+template<typename T, typename Aggregate>
+bool ScapeGoatTree<T, Aggregate>::isSubsetOf(const ScapeGoatTree& other) const {
+    if (nNodes > other.nNodes) return false;
+    T* keys = sortedKeys();
+    bool subset = true;
+    if (preferSearch(nNodes, other.nNodes)) {
+        bool* found = new bool[nNodes]{};
+        matchKeys(other.root, keys, 0, nNodes, found);
+        for (int i = 0; i < nNodes && subset; i++) subset = found[i];
+        delete[] found;
+    } else {
+        T* other_keys = other.sortedKeys();
+        subset = mergeKeys(keys, nNodes, other_keys, other.nNodes, KeepLeft, nullptr) == 0;
+        delete[] other_keys;
+    }
+    delete[] keys;
+    return subset;
+}
 
-// =====================
-// Operators
-// =====================
+/**
+ * Checks if the two trees share no key.
+ */
+template<typename T, typename Aggregate>
+bool ScapeGoatTree<T, Aggregate>::isDisjoint(const ScapeGoatTree& other) const {
+    const ScapeGoatTree& small = nNodes <= other.nNodes ? *this : other;
+    const ScapeGoatTree& large = nNodes <= other.nNodes ? other : *this;
+    T* keys = small.sortedKeys();
+    bool disjoint = true;
+    if (preferSearch(small.nNodes, large.nNodes)) {
+        bool* found = new bool[small.nNodes]{};
+        matchKeys(large.root, keys, 0, small.nNodes, found);
+        for (int i = 0; i < small.nNodes && disjoint; i++) disjoint = !found[i];
+        delete[] found;
+    } else {
+        T* other_keys = large.sortedKeys();
+        disjoint = mergeKeys(keys, small.nNodes, other_keys, large.nNodes, KeepBoth, nullptr) == 0;
+        delete[] other_keys;
+    }
+    delete[] keys;
+    return disjoint;
+}
 
 /**
- * Creates a new tree containing elements from both trees using linear merge.
+ * Takes over other's node pool, then either hangs a small other's nodes in one
+ * by one or merges both node lists and rebuilds once. Duplicates of keys we
+ * already hold go back to the pool.
  */
-template<typename T>
-ScapeGoatTree<T> ScapeGoatTree<T>::operator+(const ScapeGoatTree& other)const  {
-    ScapeGoatTree result;
-    T* array = new T[nNodes];
-    T* other_array = new T[other.nNodes];
-    int i = 0;
-    inorderTraversal(root, i, array);
-    int i2 = 0;
-    other.inorderTraversal(other.root, i2, other_array);
-    T* temp_array = new T[nNodes + other.nNodes];
-    int idx = 0, idx1 = 0, idx2 = 0;
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::unionWith(ScapeGoatTree&& other) {
+    if (this == &other || !other.root) return;
+    // nodes change owner below, so nothing may stay shared with a snapshot
+    cancelRebuild();
+    other.cancelRebuild();
+    orphanSnapshots(true);
+    other.orphanSnapshots(true);
+    pool.adopt(other.pool);
+    TreeNode* list = flattenNodes(other.root, nullptr);
+    const int m = other.nNodes;
+    other.root = nullptr;
+    other.nNodes = 0;
+    other.max_nodes = 0;
+    other.undoStack.clear(); // its history described nodes it no longer has
+    other.redoStack.clear();
 
-    // Linear Merge (O(N+M)) to keep the array sorted
-    /**
-         * if first is smaller then take it
-         * and increment the indicies for the merged list and the current array
-         * else if second is smaller then take it and increment the indicies for the merged list and the current array
-         * else (duplicates) take one of them and skip the duplicate in the other array
-         */
-    while (idx1 < nNodes && idx2 < other.nNodes) { //run as long as both arrays have elements
-        if (array[idx1] < other_array[idx2]) temp_array[idx++] = array[idx1++];
-        else if (array[idx1] > other_array[idx2]) temp_array[idx++] = other_array[idx2++];
-        else { // duplicates
-            temp_array[idx++] = array[idx1++];
-            idx2++;
+    if (!isUndoing) undoStack.push({OpType::BatchStart, T()});
+    if (m < nNodes && preferSearch(m, nNodes)) {
+        while (list) {
+            TreeNode* next = list->right;
+            if (const int depth = descend(list->value); depth < 0) {
+                pool.destroy(list);
+            } else {
+                if (!isUndoing) undoStack.push({OpType::Insert, list->value});
+                if (sharedBelow) unsharePath(depth); // a background rebuild may have started
+                attach(list, depth);
+            }
+            list = next;
         }
-    }
-    while (idx1 < nNodes) temp_array[idx++] = array[idx1++]; //append remaining elements from first array
-    while (idx2 < other.nNodes) temp_array[idx++] = other_array[idx2++]; //append remaining elements from second array
+    } else {
+        TreeNode* mine = flattenNodes(root, nullptr);
+        TreeNode* head = nullptr;
+        TreeNode** tail = &head;
+        int added = 0;
+        while (mine || list) {
+            if (list && (!mine || list->value < mine->value)) {
+                if (!isUndoing) undoStack.push({OpType::Insert, list->value});
+                *tail = list;
+                list = list->right;
+                added++;
+            } else {
+                if (list && !(mine->value < list->value)) { // duplicate, keep ours
+                    TreeNode* next = list->right;
+                    pool.destroy(list);
+                    list = next;
+                }
+                *tail = mine;
+                mine = mine->right;
+            }
+            tail = &(*tail)->right;
+        }
+        *tail = nullptr;
 
-    //Rebuild  (O(N+M))
-    result.root = result.rebuildTree(0, idx - 1, nullptr, temp_array);
-    result.nNodes = idx;
-    result.max_nodes = idx;
-    delete[] temp_array;
-    delete[] array;
-    delete[] other_array;
-    return result;
+        nNodes += added;
+        root = buildFromList(nNodes, head, nullptr);
+        rebuildCount++;
+        max_nodes = nNodes;
+    }
+    if (!isUndoing) undoStack.push({OpType::BatchEnd, T()});
 }
 
 /**
  * Assignment operator for deep copying another tree.
  */
-template<typename T>
-ScapeGoatTree<T>& ScapeGoatTree<T>::operator=(const ScapeGoatTree& other) {
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>& ScapeGoatTree<T, Aggregate>::operator=(const ScapeGoatTree& other) {
     if (this == &other) return *this;
-    postorderTraversal(root);
-    max_nodes = 0;
-    if (other.root) preorderTraversal(other.root);
+    clear();
+    // the old history describes contents that are gone
+    undoStack.clear();
+    redoStack.clear();
+    copyFrom(other);
     return *this;
 }
 
 /**
  * Move assignment operator for transferring ownership.
  */
-template<typename T>
-ScapeGoatTree<T>& ScapeGoatTree<T>::operator=(ScapeGoatTree&& other) noexcept {
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>& ScapeGoatTree<T, Aggregate>::operator=(ScapeGoatTree&& other) noexcept {
     if (this == &other) return *this;
-    postorderTraversal(root);
+    cancelRebuild();
+    orphanSnapshots(false);
+    if constexpr (!std::is_trivially_destructible_v<TreeNode>) postorderTraversal(root);
+    if (reaper.joinable()) reaper.join();
     root = other.root;
+    pool = std::move(other.pool);
     nNodes = other.nNodes;
+    rebuildCount = other.rebuildCount;
     max_nodes = other.max_nodes;
-
+    ALPHA = other.ALPHA;
+    batchRebuildRatio = other.batchRebuildRatio;
+    epoch = other.epoch;
+    sharedBelow = other.sharedBelow;
+    snapshots = std::move(other.snapshots);
+    retired = std::move(other.retired);
+    backgroundRebuildMin = other.backgroundRebuildMin;
+    compactRebuildMin = other.compactRebuildMin;
+    rebuildBudget = other.rebuildBudget;
+    rebuildThreads = other.rebuildThreads;
+    executor = other.executor;
+    rebuildJob = std::move(other.rebuildJob);
+    reaper = std::move(other.reaper);
+    condemned = std::move(other.condemned);
+    condemnedAt = other.condemnedAt;
+    condemnedTrees = std::move(other.condemnedTrees);
+    other.condemnedAt = 0;
+
+    other.sharedBelow = 0;
     other.root = nullptr;
     other.nNodes = 0;
     other.max_nodes = 0;
@@ -573,33 +2157,33 @@ ScapeGoatTree<T>& ScapeGoatTree<T>::operator=(ScapeGoatTree&& other) noexcept {
 /**
  * Overloaded plus operator for inserting a value.
  */
-template<typename T>
-void ScapeGoatTree<T>::operator+(const T& value) { insert(value); }
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::operator+(const T& value) { insert(value); }
 
 /**
  * Overloaded addition assignment operator for inserting a value.
  */
-template<typename T>
-void ScapeGoatTree<T>::operator+=(const T& value) { insert(value); }
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::operator+=(const T& value) { insert(value); }
 
 /**
  * Overloaded subtraction assignment operator for deleting a value.
  */
-template<typename T>
-bool ScapeGoatTree<T>::operator-=(const T& value) { return deleteValue(value); }
+template<typename T, typename Aggregate>
+bool ScapeGoatTree<T, Aggregate>::operator-=(const T& value) { return deleteValue(value); }
 
 /**
  * Overloaded subscript operator to search for a value in the tree.
  */
-template<typename T>
-bool ScapeGoatTree<T>::operator[](T value) const {
+template<typename T, typename Aggregate>
+bool ScapeGoatTree<T, Aggregate>::operator[](T value) const {
     return search(value);
 }
 /**
  * Clears the current tree if the assigned value is 0.
  */
-template<typename T>
-ScapeGoatTree<T>& ScapeGoatTree<T>::operator=(const int value) {
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>& ScapeGoatTree<T, Aggregate>::operator=(const int value) {
     if (value == 0) {
         clear();
     }
@@ -608,15 +2192,15 @@ ScapeGoatTree<T>& ScapeGoatTree<T>::operator=(const int value) {
 /**
  * Checks if two trees are equal by comparing their structures and values.
  */
-template<typename T>
-bool ScapeGoatTree<T>::operator==(const ScapeGoatTree& tree) const {
+template<typename T, typename Aggregate>
+bool ScapeGoatTree<T, Aggregate>::operator==(const ScapeGoatTree& tree) const {
     return areTreesEqual(root, tree.root);
 }
 /**
  * Compares two subtrees for structural and value equality.
  */
-template<typename T>
-bool ScapeGoatTree<T>::areTreesEqual(const TreeNode* n1, const TreeNode* n2) const {
+template<typename T, typename Aggregate>
+bool ScapeGoatTree<T, Aggregate>::areTreesEqual(const TreeNode* n1, const TreeNode* n2) const {
     // Both null = equal
     if (!n1 && !n2) return true;
 
@@ -633,24 +2217,24 @@ bool ScapeGoatTree<T>::areTreesEqual(const TreeNode* n1, const TreeNode* n2) con
 /**
  * Checks if two trees are not equal.
  */
-template<typename T>
-bool ScapeGoatTree<T>::operator!=(const ScapeGoatTree& tree) const {
+template<typename T, typename Aggregate>
+bool ScapeGoatTree<T, Aggregate>::operator!=(const ScapeGoatTree& tree) const {
     return !(*this == tree);
 }
 
 /**
  * Checks if the tree is empty.
  */
-template<typename T>
-bool ScapeGoatTree<T>::operator!() const {
+template<typename T, typename Aggregate>
+bool ScapeGoatTree<T, Aggregate>::operator!() const {
     return root == nullptr;
 }
 
 /**
  * Overloaded minus operator for deleting a value.
  */
-template<typename T>
-bool ScapeGoatTree<T>::operator-(const T &value) {
+template<typename T, typename Aggregate>
+bool ScapeGoatTree<T, Aggregate>::operator-(const T &value) {
    return  deleteValue(value);
 }
 
@@ -661,8 +2245,8 @@ bool ScapeGoatTree<T>::operator-(const T &value) {
 /**
  * Returns a string report indicating if the tree is currently balanced.
  */
-template<typename T>
-std::string ScapeGoatTree<T>::isBalanced() const {
+template<typename T, typename Aggregate>
+std::string ScapeGoatTree<T, Aggregate>::isBalanced() const {
     std::ostringstream out;
 
     const double n = countN(root);
@@ -691,8 +2275,8 @@ std::string ScapeGoatTree<T>::isBalanced() const {
 /**
  * Searches for a specific value in the tree.
  */
-template<typename T>
-bool ScapeGoatTree<T>::search(const T& key) const {
+template<typename T, typename Aggregate>
+bool ScapeGoatTree<T, Aggregate>::search(const T& key) const {
     TreeNode* current = root;
     while (current != nullptr) {
         if (key == current->value) return true;
@@ -704,8 +2288,8 @@ bool ScapeGoatTree<T>::search(const T& key) const {
     return false;
 }
 
-template<typename T>
-ScapeGoatTree<T>::TreeNode *ScapeGoatTree<T>::find_node(T &key) const {
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::TreeNode *ScapeGoatTree<T, Aggregate>::find_node(T &key) const {
     TreeNode* current = root;
     while (current != nullptr) {
         if (key == current->value) return current;
@@ -720,8 +2304,10 @@ ScapeGoatTree<T>::TreeNode *ScapeGoatTree<T>::find_node(T &key) const {
 /**
  * Removes all nodes from the tree and resets its state.
  */
-template<typename T>
-void ScapeGoatTree<T>::clear() {
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::clear() {
+    cancelRebuild();
+    if (snapshots.size()) collectSnapshots();
     postorderTraversal(root);
     root = nullptr;
     nNodes = 0;
@@ -732,10 +2318,11 @@ void ScapeGoatTree<T>::clear() {
  * If the last operation was a batch, it undoes the entire batch.
  */
 
-template<typename T>
-    void ScapeGoatTree<T>::undo() {
+template<typename T, typename Aggregate>
+    void ScapeGoatTree<T, Aggregate>::undo() {
             if (undoStack.isEmpty()) return;
             // Set flag to prevent undo actions from being recorded as new operations
+            const bool wasUndoing = isUndoing;
             isUndoing = true;
             Command<T> cmd = undoStack.pop();
 
@@ -757,16 +2344,17 @@ template<typename T>
                 if (cmd.type == OpType::Insert) deleteValue(cmd.value);
                 else if (cmd.type == OpType::Delete) insert(cmd.value);
             }
-            isUndoing = false;
+            isUndoing = wasUndoing;
         }
 /**
  * Redo the last undone operation.
  * If the last undone operation was a batch, it redoes the entire batch.
  */
-    template<typename T>
-    void ScapeGoatTree<T>::redo() {
+    template<typename T, typename Aggregate>
+    void ScapeGoatTree<T, Aggregate>::redo() {
             if (redoStack.isEmpty()) return;
             // Set flag to prevent redo actions from being recorded in undoStack incorrectly
+            const bool wasUndoing = isUndoing;
             isUndoing = true;
             Command<T> cmd = redoStack.pop();
 
@@ -788,11 +2376,11 @@ template<typename T>
                 if (cmd.type == OpType::Insert) insert(cmd.value);
                 else if (cmd.type == OpType::Delete) deleteValue(cmd.value);
             }
-            isUndoing = false;
+            isUndoing = wasUndoing;
         }
 
-template<typename T>
-T ScapeGoatTree<T>::sumHelper(TreeNode *node,T min,T max) {
+template<typename T, typename Aggregate>
+T ScapeGoatTree<T, Aggregate>::sumHelper(const TreeNode *node,T min,T max) {
     T sum {};
     if (!node)return 0;
     if (node->value >= min)sum+=sumHelper(node->left,min,max);
@@ -802,84 +2390,221 @@ T ScapeGoatTree<T>::sumHelper(TreeNode *node,T min,T max) {
 
 }
 
-template<typename T>
-T ScapeGoatTree<T>::sumInRange(T min, T max) {
-    return sumHelper(root,min,max);
+template<typename T, typename Aggregate>
+T ScapeGoatTree<T, Aggregate>::sumInRange(T min, T max) const {
+    return sumIn(root, min, max);
+}
+
+// =====================
+// Subtree aggregates
+// =====================
+
+/**
+ * Recomputes a node's aggregate from its children: agg(left) + value + agg(right).
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::pull(TreeNode* node) {
+    if constexpr (hasAggregate) {
+        node->agg = Aggregate::combine(Aggregate::combine(aggOf(node->left), Aggregate::lift(node->value)),
+                                       aggOf(node->right));
+    }
+}
+
+template<typename T, typename Aggregate>
+auto ScapeGoatTree<T, Aggregate>::aggOf(const TreeNode* node) {
+    return node ? node->agg : Aggregate::identity();
+}
+
+template<typename T, typename Aggregate>
+auto ScapeGoatTree<T, Aggregate>::suffixAggregate(const TreeNode* node, const T& min) {
+    if (!node) return Aggregate::identity();
+    if (node->value < min) return suffixAggregate(node->right, min);
+    // node and its whole right subtree are >= min
+    return Aggregate::combine(Aggregate::combine(suffixAggregate(node->left, min), Aggregate::lift(node->value)),
+                              aggOf(node->right));
+}
+
+template<typename T, typename Aggregate>
+auto ScapeGoatTree<T, Aggregate>::prefixAggregate(const TreeNode* node, const T& max) {
+    if (!node) return Aggregate::identity();
+    if (node->value > max) return prefixAggregate(node->left, max);
+    // node and its whole left subtree are <= max
+    return Aggregate::combine(Aggregate::combine(aggOf(node->left), Aggregate::lift(node->value)),
+                              prefixAggregate(node->right, max));
+}
+
+/**
+ * Descends to the first node inside [min, max]; from there one path covers the
+ * left boundary and one the right boundary, so the whole query is O(log n).
+ */
+template<typename T, typename Aggregate>
+auto ScapeGoatTree<T, Aggregate>::aggregateHelper(const TreeNode* node, const T& min, const T& max) {
+    while (node) {
+        if (node->value < min) node = node->right;
+        else if (node->value > max) node = node->left;
+        else break;
+    }
+    if (!node) return Aggregate::identity();
+    return Aggregate::combine(Aggregate::combine(suffixAggregate(node->left, min), Aggregate::lift(node->value)),
+                              prefixAggregate(node->right, max));
+}
+
+template<typename T, typename Aggregate>
+template<typename Op>
+void ScapeGoatTree<T, Aggregate>::foldHelper(const TreeNode* node, const T& min, const T& max,
+                                             typename Op::value_type& acc) {
+    if (!node) return;
+    if (node->value > min) foldHelper<Op>(node->left, min, max, acc);
+    if (node->value >= min && node->value <= max) acc = Op::combine(acc, Op::lift(node->value));
+    if (node->value < max) foldHelper<Op>(node->right, min, max, acc);
+}
+
+template<typename T, typename Aggregate>
+template<typename Op>
+typename Op::value_type ScapeGoatTree<T, Aggregate>::aggregateInRange(const T& min, const T& max) const {
+    return aggregateIn<Op>(root, min, max);
 }
 
-template<typename T>
-T ScapeGoatTree<T>::getMin() {
+template<typename T, typename Aggregate>
+T ScapeGoatTree<T, Aggregate>::getMin() {
     if (!root)throw std::runtime_error("Tree is Empty");
     TreeNode* current = root;
     while (current->left) current =current->left;
     return current->value;
 
 }
-template<typename T>
-T ScapeGoatTree<T>::getMax() {
+template<typename T, typename Aggregate>
+T ScapeGoatTree<T, Aggregate>::getMax() {
     if (!root)throw std::exception("Tree is Empty");
     TreeNode* current = root;
     while (current->right) current =current->right;
     return current->value;
 }
 
-template<typename T>
-void ScapeGoatTree<T>::rangeHelper(TreeNode *node,T min,T max,Vector<T>& range) {
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::rangeHelper(TreeNode *node,T min,T max,Vector<T>& range) {
     if (!node)return;
     if (node->value > min)rangeHelper(node->left,min,max,range);
     if (node->value >= min && node->value <= max )range.push_back(node->value);
     if (node->value < max)rangeHelper(node->right,min,max,range);
 }
-template<typename T>
-Vector<T> ScapeGoatTree<T>::valuesInRange(T min, T max) {
+template<typename T, typename Aggregate>
+Vector<T> ScapeGoatTree<T, Aggregate>::valuesInRange(T min, T max) {
     Vector<T>range;
     rangeHelper(root,min,max,range);
     return  std::move(range);
 }
-//leftmost in the right subtree.
-template<typename T>
-T ScapeGoatTree<T>::getSuccessor(T value) const {
-    TreeNode* current = root;
-    TreeNode* successor = nullptr;
-    while (current) {
-        if (current->value > value) {
-            successor = current;
-            current = current->left;
+
+template<typename T, typename Aggregate>
+int ScapeGoatTree<T, Aggregate>::countBelow(const TreeNode* node, const T& key, const bool inclusive) {
+    int count = 0;
+    while (node) {
+        if (node->value < key || (inclusive && !(key < node->value))) {
+            count += static_cast<int>(countN(node->left)) + 1;
+            node = node->right;
         } else {
-            current = current->right;
+            node = node->left;
         }
     }
+    return count;
+}
+
+/**
+ * A node's own rank is its left subtree's size; only subtrees with ranks on
+ * both sides of it are worth a fork.
+ */
+template<typename T, typename Aggregate>
+T ScapeGoatTree<T, Aggregate>::sumRanks(const TreeNode* node, const int lo, const int hi, const Forks forks) {
+    T sum{};
+    if (!node || lo >= hi) return sum;
+    const int at = static_cast<int>(countN(node->left));
+    if (forks && hi - lo >= PARALLEL_REBUILD_MIN && lo < at && at + 1 < hi) {
+        T left{}, right{};
+        forkJoin(forks,
+                 [&] { left = sumRanks(node->left, lo, at, forks.next()); },
+                 [&] { right = sumRanks(node->right, std::max(lo, at + 1) - at - 1, hi - at - 1, forks.next()); });
+        sum += left;
+        sum += node->value;
+        sum += right;
+        return sum;
+    }
+    if (lo < at) sum += sumRanks(node->left, lo, std::min(hi, at), Forks{});
+    if (lo <= at && at < hi) sum += node->value;
+    if (at + 1 < hi) sum += sumRanks(node->right, std::max(lo, at + 1) - at - 1, hi - at - 1, Forks{});
+    return sum;
+}
+
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::copyRanks(const TreeNode* node, const int lo, const int hi, T* out, const Forks forks) {
+    if (!node || lo >= hi) return;
+    const int at = static_cast<int>(countN(node->left));
+    if (lo <= at && at < hi) out[at - lo] = node->value;
+    forkJoin(hi - lo >= PARALLEL_REBUILD_MIN && lo < at && at + 1 < hi ? forks : Forks{},
+             [=] { copyRanks(node->left, lo, std::min(hi, at), out, forks.next()); },
+             [=] { copyRanks(node->right, std::max(lo, at + 1) - at - 1, hi - at - 1, out + std::max(lo, at + 1) - lo, forks.next()); });
+}
+
+template<typename T, typename Aggregate>
+T ScapeGoatTree<T, Aggregate>::sumInRangeParallel(T min, T max, const int threads) const {
+    if constexpr (std::is_same_v<Aggregate, SumAggregate<T>>) {
+        return sumIn(root, min, max);
+    } else {
+        if (max < min) return T{};
+        return sumRanks(root, countBelow(root, min, false), countBelow(root, max, true), forksFor(threads));
+    }
+}
+
+template<typename T, typename Aggregate>
+Vector<T> ScapeGoatTree<T, Aggregate>::valuesInRangeParallel(T min, T max, const int threads) const {
+    Vector<T> range;
+    if (max < min) return range;
+    const int lo = countBelow(root, min, false);
+    const int k = countBelow(root, max, true) - lo;
+    if (k <= 0) return range;
+    if (static_cast<unsigned int>(k) > range._size) {
+        delete[] range.data;
+        range.data = new T[k];
+        range._size = k;
+    }
+    copyRanks(root, lo, lo + k, range.data, forksFor(threads));
+    range.nElements = k;
+    return range;
+}
+//leftmost in the right subtree.
+template<typename T, typename Aggregate>
+T ScapeGoatTree<T, Aggregate>::getSuccessor(T value) const {
+    const TreeNode* successor = successorIn(root, value);
     if (!successor) throw std::runtime_error("No successor found");
     return successor->value;
 }
 
-template<typename T>
-T ScapeGoatTree<T>::kthSmallestHelper(TreeNode* node, int k) const {
+template<typename T, typename Aggregate>
+T ScapeGoatTree<T, Aggregate>::kthSmallestHelper(const TreeNode* node, int k) {
     int leftSize = countN(node->left);
     if (k == leftSize + 1) return node->value;
     if (k <= leftSize) return kthSmallestHelper(node->left, k);
     return kthSmallestHelper(node->right, k - leftSize - 1);
 }
-template<typename T>
-T ScapeGoatTree<T>::kthSmallest(int k) const {
+template<typename T, typename Aggregate>
+T ScapeGoatTree<T, Aggregate>::kthSmallest(int k) const {
     if (k < 1 || k > nNodes) throw std::out_of_range("k is out of bounds");
     return kthSmallestHelper(root, k);
 }
 
-template<typename T>
- ScapeGoatTree<T>::iterator ScapeGoatTree<T>::begin() {
+template<typename T, typename Aggregate>
+ ScapeGoatTree<T, Aggregate>::iterator ScapeGoatTree<T, Aggregate>::begin() {
     if (!root) return end();
     TreeNode* curr = root;
     while (curr->left)curr = curr->left;
     return iterator(curr);
 }
-template<typename T>
- ScapeGoatTree<T>::iterator ScapeGoatTree<T>::end() {
+template<typename T, typename Aggregate>
+ ScapeGoatTree<T, Aggregate>::iterator ScapeGoatTree<T, Aggregate>::end() {
     return iterator(nullptr);
  }
 
-template<typename T>
- ScapeGoatTree<T>::TreeNode *ScapeGoatTree<T>::findSuccessor(TreeNode *node) {
+template<typename T, typename Aggregate>
+ ScapeGoatTree<T, Aggregate>::TreeNode *ScapeGoatTree<T, Aggregate>::findSuccessor(TreeNode *node) {
     if (!node)return nullptr;
 
     if (node->right) {
@@ -896,8 +2621,8 @@ template<typename T>
     return p;
 }
 
-template<typename T>
-int ScapeGoatTree<T>::updateSize(TreeNode*& node) {
+template<typename T, typename Aggregate>
+int ScapeGoatTree<T, Aggregate>::updateSize(TreeNode*& node) {
     if (node == nullptr)
         return 0;
 
@@ -911,34 +2636,161 @@ int ScapeGoatTree<T>::updateSize(TreeNode*& node) {
     return node->size;
 }
 
-template<typename T>
-std::pair<ScapeGoatTree<T>, ScapeGoatTree<T> > ScapeGoatTree<T>::split(T value) {
-    TreeNode* node = find_node(value);
-    if (!node)return {ScapeGoatTree{}, ScapeGoatTree{}};
-    ScapeGoatTree tree1;
-    ScapeGoatTree tree2;
-    if (TreeNode* parent = node->parent) {
-        if (parent->left == node) parent->left = nullptr;
-        if (parent->right == node) parent->right = nullptr;
-    }
-    tree1.root = node->left;
-    tree2.root = node->right;
-    updateSize(tree1.root);
-    updateSize(tree2.root);
-    int size1 = tree1.root ? tree1.root->size : 0;
-    int size2 = tree2.root ? tree2.root->size : 0;
-
-    T* array1 = size1 ? new T[size1] : nullptr;
-    T* array2 = size2 ? new T[size2] : nullptr;
-    int i = 0, j =0;
-    inorderTraversal(tree1.root,i,array1);
-    tree1.root= rebuildTree(0, i-1,nullptr,array1);
-
-    inorderTraversal(tree2.root,j,array2);
-    tree2.root = rebuildTree(0, j-1,nullptr,array2);
-    delete[] array1;
-    delete[] array2;
-    return {tree1,tree2};
+/**
+ * Splits a subtree into the keys < key and the keys >= key along one path.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::splitNodes(TreeNode* node, const T& key, TreeNode*& less, TreeNode*& greaterEq) {
+    if (!node) {
+        less = greaterEq = nullptr;
+        return;
+    }
+    if (node->value < key) {
+        // node and its left subtree stay together, its right subtree is split
+        splitNodes(node->right, key, node->right, greaterEq);
+        if (node->right) node->right->parent = node;
+        less = node;
+    } else {
+        splitNodes(node->left, key, less, node->left);
+        if (node->left) node->left->parent = node;
+        greaterEq = node;
+    }
+    node->size = 1 + countN(node->left) + countN(node->right);
+    pull(node);
+}
+
+/**
+ * Moves the keys < value into the first tree and the keys >= value into the second.
+ * Heights only shrink, so the larger half keeps the original max_nodes: it is in the
+ * same state as the tree after deleting the other half's keys, and the deletion
+ * rule rebuilds it on its next delete once it is below max_nodes/2. The smaller
+ * half leaves our slabs for a fresh block; its old slots go back on our free list.
+ */
+template<typename T, typename Aggregate>
+std::pair<ScapeGoatTree<T, Aggregate>, ScapeGoatTree<T, Aggregate> > ScapeGoatTree<T, Aggregate>::split(T value) {
+    cancelRebuild();
+    orphanSnapshots(true); // the halves relink our nodes
+    ScapeGoatTree low(ALPHA), high(ALPHA);
+    splitNodes(root, value, low.root, high.root);
+    if (low.root) low.root->parent = nullptr;
+    if (high.root) high.root->parent = nullptr;
+    low.nNodes = static_cast<int>(countN(low.root));
+    high.nNodes = static_cast<int>(countN(high.root));
+    ScapeGoatTree& smaller = high.nNodes < low.nNodes ? high : low;
+    ScapeGoatTree& larger = &smaller == &high ? low : high;
+    if (smaller.root) {
+        smaller.root = relocateSubtree(smaller.root, nullptr, smaller.pool);
+        smaller.max_nodes = smaller.nNodes;
+    }
+    larger.pool = std::move(pool);
+    larger.max_nodes = max_nodes;
+    low.rebuildThreads = high.rebuildThreads = rebuildThreads;
+    low.executor = high.executor = executor;
+
+    root = nullptr;
+    nNodes = 0;
+    max_nodes = 0;
+    undoStack.clear(); // the history described nodes this tree no longer has
+    redoStack.clear();
+    return {std::move(low), std::move(high)};
+}
+
+/**
+ * Unlinks the smallest (or largest) node of a subtree; the nodes above it lose one
+ * from their size and have their aggregates recomputed.
+ */
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate>::TreeNode* ScapeGoatTree<T, Aggregate>::detachExtreme(TreeNode*& subRoot, const bool smallest) {
+    TreeNode* node = subRoot;
+    while (smallest ? node->left : node->right) node = smallest ? node->left : node->right;
+    TreeNode* child = smallest ? node->right : node->left;
+    TreeNode* parent = node->parent;
+    if (child) child->parent = parent;
+    if (!parent) subRoot = child;
+    else if (smallest) parent->left = child;
+    else parent->right = child;
+    for (TreeNode* p = parent; p; p = p->parent) {
+        --p->size;
+        pull(p);
+    }
+    return node;
+}
+
+/**
+ * Takes donor's extreme key as a pivot, walks down our spine facing donor until the
+ * subtree is no larger than donor's remainder, and puts the pivot there with that
+ * subtree and the remainder as children. The spine above grows by donor's size, so
+ * the lowest alpha-violator on it is rebuilt, as after an insert.
+ */
+template<typename T, typename Aggregate>
+void ScapeGoatTree<T, Aggregate>::graft(ScapeGoatTree& donor, const bool donorAbove) {
+    const int donorSize = donor.nNodes;
+    pool.adopt(donor.pool);
+    TreeNode* pivot = detachExtreme(donor.root, donorAbove);
+    TreeNode* rest = donor.root;
+    const int restSize = donorSize - 1;
+
+    path.clear();
+    TreeNode* sub = root;
+    while (sub && static_cast<int>(sub->size) > restSize) {
+        path.push_back(sub);
+        sub = donorAbove ? sub->right : sub->left;
+    }
+    const int depth = static_cast<int>(path.size());
+    TreeNode* parent = depth > 0 ? path[depth - 1] : nullptr;
+
+    pivot->left = donorAbove ? sub : rest;
+    pivot->right = donorAbove ? rest : sub;
+    if (pivot->left) pivot->left->parent = pivot;
+    if (pivot->right) pivot->right->parent = pivot;
+    pivot->parent = parent;
+    pivot->size = 1 + countN(pivot->left) + countN(pivot->right);
+    pull(pivot);
+    if (!parent) root = pivot;
+    else if (donorAbove) parent->right = pivot;
+    else parent->left = pivot;
+    for (int i = depth - 1; i >= 0; i--) {
+        path[i]->size += donorSize;
+        pull(path[i]);
+    }
+    path.push_back(pivot);
+
+    nNodes += donorSize;
+    max_nodes = std::max({max_nodes, donor.max_nodes, nNodes});
+    restructure_subtree(depth + 1);
+
+    donor.root = nullptr;
+    donor.nNodes = 0;
+    donor.max_nodes = 0;
+    donor.undoStack.clear();
+    donor.redoStack.clear();
+}
+
+/**
+ * Concatenates two key-disjoint trees; the smaller one is grafted into the larger,
+ * so the relinking walks the larger tree's height but a rebuild may cover both.
+ */
+template<typename T, typename Aggregate>
+ScapeGoatTree<T, Aggregate> ScapeGoatTree<T, Aggregate>::join(ScapeGoatTree&& left, ScapeGoatTree&& right) {
+    if (&left == &right || !right.root) return std::move(left);
+    if (!left.root) return std::move(right);
+    left.cancelRebuild();
+    right.cancelRebuild();
+    left.orphanSnapshots(true);
+    right.orphanSnapshots(true);
+    const TreeNode* maxLeft = left.root;
+    while (maxLeft->right) maxLeft = maxLeft->right;
+    const TreeNode* minRight = right.root;
+    while (minRight->left) minRight = minRight->left;
+    if (!(maxLeft->value < minRight->value))
+        throw std::invalid_argument("join: every key of left must be smaller than every key of right");
+
+    const bool intoLeft = left.nNodes >= right.nNodes;
+    ScapeGoatTree result(std::move(intoLeft ? left : right));
+    result.undoStack.clear();
+    result.redoStack.clear();
+    result.graft(intoLeft ? right : left, intoLeft);
+    return result;
 }
 
 #endif //TREE_SCAPEGOATTREE_TPP
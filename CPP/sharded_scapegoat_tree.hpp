@@ -0,0 +1,222 @@
+/**
+ * Range-partitioned ScapeGoatTree for concurrent writers.
+ *
+ * Keys are split by value across up to shardCount inner trees (shards). Each
+ * shard has its own mutex, so writers touching different key ranges never
+ * wait for each other, and batch operations run one thread per shard.
+ *
+ * Shard i holds the keys in [bounds[i-1], bounds[i]). When a shard grows past
+ * twice its fair share it is split at its median with ScapeGoatTree::split;
+ * when the shard count is at its limit, or a shard shrinks below a quarter of
+ * its share, adjacent shards are merged back with ScapeGoatTree::join. Both
+ * are linear in the shards involved (a median split copies half the shard),
+ * which the writes that made a shard that far out of share pay for.
+ *
+ * Locking:
+ * - every operation holds the layout lock shared; only rebalancing takes it exclusively
+ * - writers lock one shard at a time
+ * - multi-shard reads lock their shards in key order, so they see one consistent state
+ */
+#ifndef SCAPEGOATPROJECT_SHARDED_SCAPEGOAT_TREE_HPP
+#define SCAPEGOATPROJECT_SHARDED_SCAPEGOAT_TREE_HPP
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include "scapegoat_tree.hpp"
+
+template<typename T, typename Aggregate = NoAggregate>
+class ShardedScapeGoatTree {
+    using Tree = ScapeGoatTree<T, Aggregate>;
+    struct Shard {
+        std::mutex lock;
+        Tree tree;
+        // undo() on one shard means nothing once rebalance() moved keys around
+        Shard() { tree.isUndoing = true; }
+    };
+    /**
+     * Shards in key order; shards[i] holds keys in [bounds[i-1], bounds[i]).
+     */
+    Vector<Shard*> shards;
+    Vector<T> bounds;
+    /**
+     * Shared by every operation, exclusive while shards are split or merged.
+     */
+    mutable std::shared_mutex layout;
+    unsigned int maxShards;
+    int minShardSize;
+    std::atomic<int> total{0};
+
+    /**
+     * Locks shards [first, last] in key order and unlocks them on destruction.
+     */
+    class RangeLock {
+        const ShardedScapeGoatTree& owner;
+        unsigned int first, last;
+    public:
+        RangeLock(const ShardedScapeGoatTree& t, unsigned int lo, unsigned int hi);
+        ~RangeLock();
+        RangeLock(const RangeLock&) = delete;
+        RangeLock& operator=(const RangeLock&) = delete;
+    };
+
+    /**
+     * Index of the shard whose range contains key, given the shard bounds.
+     */
+    static unsigned int route(const Vector<T>& bounds, const T& key);
+    /**
+     * The size every shard should stay near: total / shardCount, at least minShardSize.
+     */
+    [[nodiscard]] int idealShardSize() const;
+    /**
+     * True if a shard of this size should be split or merged away.
+     */
+    [[nodiscard]] bool unbalanced(int shardSize) const;
+    /**
+     * Splits and merges shards until every one is within bounds.
+     * Takes the layout lock exclusively.
+     */
+    void rebalance();
+    void splitShard(unsigned int i);
+    /**
+     * Joins shard i+1 into shard i.
+     */
+    void mergeShards(unsigned int i);
+    /**
+     * Sorts values into one bucket per shard.
+     */
+    Vector<Vector<T>> routeBatch(const Vector<T>& values) const;
+    /**
+     * Runs apply(tree, bucket) for every non-empty bucket, one task per shard,
+     * and returns true if any shard ended up unbalanced.
+     */
+    template<typename Apply>
+    bool forEachBucket(const Vector<Vector<T>>& buckets, Apply apply);
+
+public:
+    /**
+     * Consistent read-only view of every shard, taken at one point in time.
+     */
+    class Snapshot {
+        struct Parts {
+            Vector<T> bounds;
+            Vector<typename Tree::Snapshot> views;
+            int nNodes = 0;
+        };
+        std::shared_ptr<const Parts> parts;
+        friend class ShardedScapeGoatTree;
+        explicit Snapshot(std::shared_ptr<const Parts> p) : parts(std::move(p)) {}
+
+    public:
+        /**
+         * In-order iterator across shards; keeps the view alive on its own.
+         */
+        class iterator {
+            std::shared_ptr<const Parts> parts;
+            unsigned int shard = 0;
+            typename Tree::Snapshot::iterator it{nullptr};
+            void settle() {
+                for (; shard < parts->views.size(); shard++) {
+                    it = parts->views[shard].begin();
+                    if (it != parts->views[shard].end()) return;
+                }
+            }
+
+        public:
+            iterator() = default;
+            explicit iterator(std::shared_ptr<const Parts> p) : parts(std::move(p)) { settle(); }
+            const T& operator*() const { return *it; }
+            iterator& operator++() {
+                ++it;
+                if (!(it != parts->views[shard].end())) {
+                    shard++;
+                    settle();
+                }
+                return *this;
+            }
+            bool operator!=(const iterator& other) const { return it != other.it; }
+            bool operator==(const iterator& other) const { return it == other.it; }
+        };
+
+        [[nodiscard]] bool search(const T& key) const;
+        T sumInRange(T min, T max) const;
+        T kthSmallest(int k) const;
+        [[nodiscard]] int size() const { return parts->nNodes; }
+        iterator begin() const { return iterator(parts); }
+        iterator end() const { return iterator(); }
+    };
+    using iterator = typename Snapshot::iterator;
+
+    /**
+     * Creates an empty tree that spreads its keys over at most shardCount shards.
+     * Shards are only split off once a shard holds more than 2 * minShardSize keys.
+     */
+    explicit ShardedScapeGoatTree(unsigned int shardCount = std::thread::hardware_concurrency(),
+                                  int minShardSize = 1024);
+    ~ShardedScapeGoatTree();
+    ShardedScapeGoatTree(const ShardedScapeGoatTree&) = delete;
+    ShardedScapeGoatTree& operator=(const ShardedScapeGoatTree&) = delete;
+
+    /**
+     * Inserts a value, locking only the shard that owns it.
+     */
+    void insert(const T& value);
+    /**
+     * Removes a value, locking only the shard that owns it.
+     */
+    bool deleteValue(const T& value);
+    /**
+     * Routes the values to their shards and inserts every shard's share in
+     * parallel through ScapeGoatTree::insertBatch.
+     */
+    void insertBatch(const Vector<T>& values);
+    /**
+     * Parallel counterpart of insertBatch for removals.
+     */
+    void deleteBatch(const Vector<T>& values);
+
+    [[nodiscard]] bool search(const T& key) const;
+    /**
+     * Sum of the keys in [min, max] over every overlapping shard.
+     */
+    T sumInRange(T min, T max) const;
+    /**
+     * Folds Op over the keys in [min, max], shard by shard in key order.
+     */
+    template<typename Op = Aggregate>
+    typename Op::value_type aggregateInRange(const T& min, const T& max) const;
+    /**
+     * k-th smallest key overall (1-based); throws std::out_of_range.
+     */
+    T kthSmallest(int k) const;
+    [[nodiscard]] int size() const { return total.load(); }
+    bool operator!() const { return size() == 0; }
+
+    /**
+     * Number of shards currently in use (grows up to the shard limit).
+     */
+    [[nodiscard]] unsigned int shardCount() const;
+    /**
+     * Size of every shard in key order (for tests/benchmarks).
+     */
+    [[nodiscard]] Vector<int> shardSizes() const;
+    /**
+     * Undo commands held by all shard trees; stays 0 (for tests).
+     */
+    [[nodiscard]] unsigned int historySize() const;
+
+    /**
+     * O(shards) consistent view built from a snapshot of every shard.
+     */
+    Snapshot snapshot();
+    /**
+     * Iterates a snapshot taken here, so a range-for sees one consistent
+     * state even while other threads keep writing.
+     */
+    iterator begin() { return snapshot().begin(); }
+    static iterator end() { return iterator(); }
+};
+#include "sharded_scapegoat_tree.tpp"
+
+#endif //SCAPEGOATPROJECT_SHARDED_SCAPEGOAT_TREE_HPP
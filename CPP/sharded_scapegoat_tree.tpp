@@ -0,0 +1,335 @@
+#ifndef SCAPEGOATPROJECT_SHARDED_SCAPEGOAT_TREE_TPP
+#define SCAPEGOATPROJECT_SHARDED_SCAPEGOAT_TREE_TPP
+#include <stdexcept>
+// =====================
+// Construction
+// =====================
+
+template<typename T, typename Aggregate>
+ShardedScapeGoatTree<T, Aggregate>::ShardedScapeGoatTree(const unsigned int shardCount, const int minShardSize)
+    : maxShards(shardCount ? shardCount : 1), minShardSize(minShardSize > 0 ? minShardSize : 1) {
+    shards.push_back(new Shard);
+}
+
+template<typename T, typename Aggregate>
+ShardedScapeGoatTree<T, Aggregate>::~ShardedScapeGoatTree() {
+    for (unsigned int i = 0; i < shards.size(); i++) delete shards[i];
+}
+
+template<typename T, typename Aggregate>
+ShardedScapeGoatTree<T, Aggregate>::RangeLock::RangeLock(const ShardedScapeGoatTree& t, const unsigned int lo,
+                                                        const unsigned int hi)
+    : owner(t), first(lo), last(hi) {
+    for (unsigned int i = first; i <= last; i++) owner.shards[i]->lock.lock();
+}
+
+template<typename T, typename Aggregate>
+ShardedScapeGoatTree<T, Aggregate>::RangeLock::~RangeLock() {
+    for (unsigned int i = last + 1; i-- > first;) owner.shards[i]->lock.unlock();
+}
+
+// =====================
+// Routing and rebalancing
+// =====================
+
+/**
+ * Binary search for the number of bounds <= key.
+ */
+template<typename T, typename Aggregate>
+unsigned int ShardedScapeGoatTree<T, Aggregate>::route(const Vector<T>& bounds, const T& key) {
+    unsigned int lo = 0, hi = bounds.size();
+    while (lo < hi) {
+        const unsigned int mid = (lo + hi) / 2;
+        if (key < bounds[mid]) hi = mid;
+        else lo = mid + 1;
+    }
+    return lo;
+}
+
+template<typename T, typename Aggregate>
+int ShardedScapeGoatTree<T, Aggregate>::idealShardSize() const {
+    const int share = total.load() / static_cast<int>(maxShards);
+    return share > minShardSize ? share : minShardSize;
+}
+
+template<typename T, typename Aggregate>
+bool ShardedScapeGoatTree<T, Aggregate>::unbalanced(const int shardSize) const {
+    const int ideal = idealShardSize();
+    return (maxShards > 1 && shardSize > 2 * ideal) || (shards.size() > 1 && shardSize < ideal / 4);
+}
+
+/**
+ * Splits shard i at its median key; the upper half becomes shard i+1.
+ */
+template<typename T, typename Aggregate>
+void ShardedScapeGoatTree<T, Aggregate>::splitShard(const unsigned int i) {
+    Tree& tree = shards[i]->tree;
+    const T pivot = tree.kthSmallest(tree.size() / 2 + 1);
+    auto [low, high] = tree.split(pivot);
+    auto* upper = new Shard;
+    upper->tree = std::move(high);
+    tree = std::move(low);
+
+    shards.push_back(nullptr);
+    for (unsigned int j = shards.size() - 1; j > i + 1; j--) shards[j] = shards[j - 1];
+    shards[i + 1] = upper;
+    bounds.push_back(pivot);
+    for (unsigned int j = bounds.size() - 1; j > i; j--) bounds[j] = bounds[j - 1];
+    bounds[i] = pivot;
+}
+
+template<typename T, typename Aggregate>
+void ShardedScapeGoatTree<T, Aggregate>::mergeShards(const unsigned int i) {
+    shards[i]->tree = Tree::join(std::move(shards[i]->tree), std::move(shards[i + 1]->tree));
+    delete shards[i + 1];
+    for (unsigned int j = i + 1; j + 1 < shards.size(); j++) shards[j] = shards[j + 1];
+    shards.pop_back();
+    for (unsigned int j = i; j + 1 < bounds.size(); j++) bounds[j] = bounds[j + 1];
+    bounds.pop_back();
+}
+
+/**
+ * Each step either splits the largest shard (merging the lightest other
+ * adjacent pair if that exceeds the shard limit) or folds the smallest shard
+ * into its lighter neighbour.
+ */
+template<typename T, typename Aggregate>
+void ShardedScapeGoatTree<T, Aggregate>::rebalance() {
+    std::unique_lock guard(layout);
+    // every step fixes one shard; the cap only guards against ping-ponging
+    for (unsigned int step = 0; step < 4 * maxShards + 4; step++) {
+        const int ideal = idealShardSize();
+        unsigned int largest = 0, smallest = 0;
+        for (unsigned int i = 1; i < shards.size(); i++) {
+            if (shards[i]->tree.size() > shards[largest]->tree.size()) largest = i;
+            if (shards[i]->tree.size() < shards[smallest]->tree.size()) smallest = i;
+        }
+
+        if (maxShards > 1 && shards[largest]->tree.size() > 2 * ideal) {
+            splitShard(largest);
+            if (shards.size() <= maxShards) continue;
+            unsigned int lightest = shards.size();
+            int lightestSize = 0;
+            for (unsigned int i = 0; i + 1 < shards.size(); i++) {
+                if (i == largest) continue; // that pair is the split we just made
+                const int pairSize = shards[i]->tree.size() + shards[i + 1]->tree.size();
+                if (lightest == shards.size() || pairSize < lightestSize) {
+                    lightest = i;
+                    lightestSize = pairSize;
+                }
+            }
+            mergeShards(lightest);
+        } else if (shards.size() > 1 && shards[smallest]->tree.size() < ideal / 4) {
+            if (smallest == 0) mergeShards(0);
+            else if (smallest + 1 == shards.size()) mergeShards(smallest - 1);
+            else if (shards[smallest - 1]->tree.size() < shards[smallest + 1]->tree.size()) mergeShards(smallest - 1);
+            else mergeShards(smallest);
+        } else {
+            return;
+        }
+    }
+}
+
+template<typename T, typename Aggregate>
+Vector<Vector<T>> ShardedScapeGoatTree<T, Aggregate>::routeBatch(const Vector<T>& values) const {
+    Vector<Vector<T>> buckets;
+    for (unsigned int i = 0; i < shards.size(); i++) buckets.push_back(Vector<T>());
+    for (unsigned int i = 0; i < values.size(); i++) buckets[route(bounds, values[i])].push_back(values[i]);
+    return buckets;
+}
+
+/**
+ * The buckets are forked on the shared task pool; the calling thread works
+ * through its share of them too.
+ */
+template<typename T, typename Aggregate>
+template<typename Apply>
+bool ShardedScapeGoatTree<T, Aggregate>::forEachBucket(const Vector<Vector<T>>& buckets, Apply apply) {
+    std::atomic<bool> lopsided{false};
+    TaskPool::shared().forEach(0, static_cast<int>(buckets.size()), 1, [&](const int i) {
+        if (buckets[i].size() == 0) return;
+        Shard& shard = *shards[i];
+        std::lock_guard lock(shard.lock);
+        const int before = shard.tree.size();
+        apply(shard.tree, buckets[i]);
+        total += shard.tree.size() - before;
+        if (unbalanced(shard.tree.size())) lopsided = true;
+    });
+    return lopsided;
+}
+
+// =====================
+// Writes
+// =====================
+
+template<typename T, typename Aggregate>
+void ShardedScapeGoatTree<T, Aggregate>::insert(const T& value) {
+    bool lopsided;
+    {
+        std::shared_lock guard(layout);
+        Shard& shard = *shards[route(bounds, value)];
+        std::lock_guard lock(shard.lock);
+        const int before = shard.tree.size();
+        shard.tree.insert(value);
+        total += shard.tree.size() - before;
+        lopsided = unbalanced(shard.tree.size());
+    }
+    if (lopsided) rebalance();
+}
+
+template<typename T, typename Aggregate>
+bool ShardedScapeGoatTree<T, Aggregate>::deleteValue(const T& value) {
+    bool removed, lopsided;
+    {
+        std::shared_lock guard(layout);
+        Shard& shard = *shards[route(bounds, value)];
+        std::lock_guard lock(shard.lock);
+        removed = shard.tree.deleteValue(value);
+        if (removed) total--;
+        lopsided = removed && unbalanced(shard.tree.size());
+    }
+    if (lopsided) rebalance();
+    return removed;
+}
+
+template<typename T, typename Aggregate>
+void ShardedScapeGoatTree<T, Aggregate>::insertBatch(const Vector<T>& values) {
+    bool lopsided;
+    {
+        std::shared_lock guard(layout);
+        lopsided = forEachBucket(routeBatch(values), [](Tree& tree, const Vector<T>& keys) { tree.insertBatch(keys); });
+    }
+    if (lopsided) rebalance();
+}
+
+template<typename T, typename Aggregate>
+void ShardedScapeGoatTree<T, Aggregate>::deleteBatch(const Vector<T>& values) {
+    bool lopsided;
+    {
+        std::shared_lock guard(layout);
+        lopsided = forEachBucket(routeBatch(values), [](Tree& tree, const Vector<T>& keys) { tree.deleteBatch(keys); });
+    }
+    if (lopsided) rebalance();
+}
+
+// =====================
+// Reads
+// =====================
+
+template<typename T, typename Aggregate>
+bool ShardedScapeGoatTree<T, Aggregate>::search(const T& key) const {
+    std::shared_lock guard(layout);
+    Shard& shard = *shards[route(bounds, key)];
+    std::lock_guard lock(shard.lock);
+    return shard.tree.search(key);
+}
+
+template<typename T, typename Aggregate>
+T ShardedScapeGoatTree<T, Aggregate>::sumInRange(T min, T max) const {
+    if (max < min) return T{};
+    std::shared_lock guard(layout);
+    const unsigned int first = route(bounds, min), last = route(bounds, max);
+    RangeLock locked(*this, first, last);
+    T sum{};
+    for (unsigned int i = first; i <= last; i++) sum += shards[i]->tree.sumInRange(min, max);
+    return sum;
+}
+
+template<typename T, typename Aggregate>
+template<typename Op>
+typename Op::value_type ShardedScapeGoatTree<T, Aggregate>::aggregateInRange(const T& min, const T& max) const {
+    if (max < min) return Op::identity();
+    std::shared_lock guard(layout);
+    const unsigned int first = route(bounds, min), last = route(bounds, max);
+    RangeLock locked(*this, first, last);
+    typename Op::value_type acc = Op::identity();
+    for (unsigned int i = first; i <= last; i++)
+        acc = Op::combine(acc, shards[i]->tree.template aggregateInRange<Op>(min, max));
+    return acc;
+}
+
+template<typename T, typename Aggregate>
+T ShardedScapeGoatTree<T, Aggregate>::kthSmallest(int k) const {
+    std::shared_lock guard(layout);
+    RangeLock locked(*this, 0, shards.size() - 1);
+    if (k >= 1) {
+        for (unsigned int i = 0; i < shards.size(); i++) {
+            const Tree& tree = shards[i]->tree;
+            if (k <= tree.size()) return tree.kthSmallest(k);
+            k -= tree.size();
+        }
+    }
+    throw std::out_of_range("k is out of bounds");
+}
+
+template<typename T, typename Aggregate>
+unsigned int ShardedScapeGoatTree<T, Aggregate>::shardCount() const {
+    std::shared_lock guard(layout);
+    return shards.size();
+}
+
+template<typename T, typename Aggregate>
+Vector<int> ShardedScapeGoatTree<T, Aggregate>::shardSizes() const {
+    std::shared_lock guard(layout);
+    RangeLock locked(*this, 0, shards.size() - 1);
+    Vector<int> sizes;
+    for (unsigned int i = 0; i < shards.size(); i++) sizes.push_back(shards[i]->tree.size());
+    return sizes;
+}
+
+template<typename T, typename Aggregate>
+unsigned int ShardedScapeGoatTree<T, Aggregate>::historySize() const {
+    std::shared_lock guard(layout);
+    RangeLock locked(*this, 0, shards.size() - 1);
+    unsigned int commands = 0;
+    for (unsigned int i = 0; i < shards.size(); i++) commands += shards[i]->tree.historySize();
+    return commands;
+}
+
+// =====================
+// Snapshots
+// =====================
+
+/**
+ * Holds every shard lock while the per-shard snapshots are taken, so the
+ * views line up; each one costs O(1).
+ */
+template<typename T, typename Aggregate>
+typename ShardedScapeGoatTree<T, Aggregate>::Snapshot ShardedScapeGoatTree<T, Aggregate>::snapshot() {
+    std::shared_lock guard(layout);
+    RangeLock locked(*this, 0, shards.size() - 1);
+    auto parts = std::make_shared<typename Snapshot::Parts>();
+    parts->bounds = bounds;
+    for (unsigned int i = 0; i < shards.size(); i++) {
+        parts->views.push_back(shards[i]->tree.snapshot());
+        parts->nNodes += shards[i]->tree.size();
+    }
+    return Snapshot(std::move(parts));
+}
+
+template<typename T, typename Aggregate>
+bool ShardedScapeGoatTree<T, Aggregate>::Snapshot::search(const T& key) const {
+    return parts->views[route(parts->bounds, key)].search(key);
+}
+
+template<typename T, typename Aggregate>
+T ShardedScapeGoatTree<T, Aggregate>::Snapshot::sumInRange(T min, T max) const {
+    if (max < min) return T{};
+    T sum{};
+    const unsigned int last = route(parts->bounds, max);
+    for (unsigned int i = route(parts->bounds, min); i <= last; i++) sum += parts->views[i].sumInRange(min, max);
+    return sum;
+}
+
+template<typename T, typename Aggregate>
+T ShardedScapeGoatTree<T, Aggregate>::Snapshot::kthSmallest(int k) const {
+    if (k >= 1) {
+        for (unsigned int i = 0; i < parts->views.size(); i++) {
+            if (k <= parts->views[i].size()) return parts->views[i].kthSmallest(k);
+            k -= parts->views[i].size();
+        }
+    }
+    throw std::out_of_range("k is out of bounds");
+}
+
+#endif //SCAPEGOATPROJECT_SHARDED_SCAPEGOAT_TREE_TPP
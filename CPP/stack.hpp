@@ -32,6 +32,13 @@ public:
         return data.data[0];
     }
 
+    /**
+     * Removes every element.
+     */
+    void clear() {
+        data.clear();
+    }
+
     /**
      * Returns the number of elements currently in the stack.
      */
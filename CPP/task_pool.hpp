@@ -0,0 +1,251 @@
+/**
+ * Work-stealing fork/join pool shared by the parallel tree operations.
+ *
+ * Every worker owns a deque of tasks. join(first, second) pushes first on
+ * the caller's deque, runs second, then takes first back if nobody stole it
+ * and runs it too. An idle worker steals the oldest task of another deque:
+ * forks split work in halves, so that is the largest piece still waiting.
+ * Threads outside the pool may call join as well; their tasks go to one
+ * shared deque, and while they wait for a stolen task they steal in turn.
+ *
+ * Tasks live on the joining thread's stack, so a fork allocates nothing: it
+ * is one push and one pop under the deque's (normally uncontended) lock.
+ * Idle workers sleep on a condition variable until something is pushed.
+ */
+#ifndef SCAPEGOATPROJECT_TASK_POOL_HPP
+#define SCAPEGOATPROJECT_TASK_POOL_HPP
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+/**
+ * Counters of a TaskPool (for tests/benchmarks).
+ */
+struct TaskPoolStats {
+    std::size_t forks = 0;  // tasks pushed by join
+    std::size_t stolen = 0; // of those, run by another thread than the one that pushed them
+};
+
+class TaskPool {
+    struct Task {
+        void (*run)(Task*){};
+        std::atomic<bool> done{false};
+        std::exception_ptr error;
+    };
+    template<typename Fn>
+    struct TaskFor : Task {
+        Fn& fn;
+        explicit TaskFor(Fn& f) : fn(f) {
+            this->run = [](Task* task) {
+                try {
+                    static_cast<TaskFor*>(task)->fn();
+                } catch (...) {
+                    task->error = std::current_exception();
+                }
+                task->done.store(true, std::memory_order_release);
+            };
+        }
+    };
+    struct alignas(64) Deque {
+        std::mutex lock;
+        std::deque<Task*> tasks;
+        std::atomic<std::size_t> forks{0}, stolen{0};
+    };
+    static constexpr int SPINS = 64; // failed steal rounds before a worker sleeps
+
+    unsigned int nWorkers;
+    std::unique_ptr<Deque[]> deques; // one per worker, the last for outside threads
+    std::unique_ptr<std::thread[]> threads;
+    std::atomic<std::size_t> queued{0};
+    std::atomic<int> sleepers{0};
+    std::atomic<bool> stopping{false};
+    std::mutex sleepLock;
+    std::condition_variable wake;
+
+    inline static thread_local const TaskPool* currentPool = nullptr;
+    inline static thread_local unsigned int currentIndex = 0;
+
+    /**
+     * Index of the calling thread's deque.
+     */
+    [[nodiscard]] unsigned int home() const { return currentPool == this ? currentIndex : nWorkers; }
+
+    void push(Task* task) {
+        Deque& deque = deques[home()];
+        {
+            std::lock_guard guard(deque.lock);
+            deque.tasks.push_back(task);
+        }
+        deque.forks.fetch_add(1, std::memory_order_relaxed);
+        queued.fetch_add(1);
+        if (sleepers.load() > 0) {
+            std::lock_guard guard(sleepLock);
+            wake.notify_one();
+        }
+    }
+
+    /**
+     * Removes task from the caller's deque if it is still there. It is
+     * normally the newest entry; outside threads share a deque, so it is
+     * searched from the back.
+     */
+    bool takeBack(const Task* task) {
+        Deque& deque = deques[home()];
+        std::lock_guard guard(deque.lock);
+        for (auto it = deque.tasks.rbegin(); it != deque.tasks.rend(); ++it) {
+            if (*it != task) continue;
+            deque.tasks.erase(std::next(it).base());
+            queued.fetch_sub(1);
+            return true;
+        }
+        return false;
+    }
+
+    Task* popOwn(const unsigned int self) {
+        Deque& deque = deques[self];
+        std::lock_guard guard(deque.lock);
+        if (deque.tasks.empty()) return nullptr;
+        Task* task = deque.tasks.back();
+        deque.tasks.pop_back();
+        queued.fetch_sub(1);
+        return task;
+    }
+
+    /**
+     * Takes the oldest task of some other deque, starting after self.
+     */
+    Task* steal(const unsigned int self) {
+        for (unsigned int k = 1; k <= nWorkers; k++) {
+            Deque& victim = deques[(self + k) % (nWorkers + 1)];
+            std::lock_guard guard(victim.lock);
+            if (victim.tasks.empty()) continue;
+            Task* task = victim.tasks.front();
+            victim.tasks.pop_front();
+            victim.stolen.fetch_add(1, std::memory_order_relaxed);
+            queued.fetch_sub(1);
+            return task;
+        }
+        return nullptr;
+    }
+
+    void work(const unsigned int self) {
+        currentPool = this;
+        currentIndex = self;
+        for (int idle = 0;;) {
+            Task* task = popOwn(self);
+            if (!task) task = steal(self);
+            if (task) {
+                task->run(task);
+                idle = 0;
+                continue;
+            }
+            if (++idle < SPINS) {
+                std::this_thread::yield();
+                continue;
+            }
+            std::unique_lock guard(sleepLock);
+            sleepers.fetch_add(1);
+            wake.wait(guard, [this] { return queued.load() > 0 || stopping.load(); });
+            sleepers.fetch_sub(1);
+            if (stopping.load() && queued.load() == 0) return;
+            idle = 0;
+        }
+    }
+
+    /**
+     * Runs task here if it was not stolen; otherwise steals other work until
+     * the thief is done with it.
+     */
+    void waitFor(Task* task) {
+        if (takeBack(task)) {
+            task->run(task);
+            return;
+        }
+        while (!task->done.load(std::memory_order_acquire)) {
+            if (Task* other = steal(home())) other->run(other);
+            else std::this_thread::yield();
+        }
+    }
+
+public:
+    /**
+     * Starts workers threads; 0 runs every task on the thread that joins it.
+     */
+    explicit TaskPool(const unsigned int workers)
+        : nWorkers(workers), deques(new Deque[workers + 1]), threads(new std::thread[workers]) {
+        for (unsigned int i = 0; i < nWorkers; i++) threads[i] = std::thread([this, i] { work(i); });
+    }
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+    /**
+     * Every join has returned by now, so no task is left.
+     */
+    ~TaskPool() {
+        {
+            std::lock_guard guard(sleepLock);
+            stopping.store(true);
+        }
+        wake.notify_all();
+        for (unsigned int i = 0; i < nWorkers; i++) threads[i].join();
+    }
+
+    /**
+     * The pool parallel tree operations use unless given another: one worker
+     * per hardware thread but the caller's own.
+     */
+    static TaskPool& shared() {
+        static TaskPool pool(std::max(1u, std::thread::hardware_concurrency()) - 1);
+        return pool;
+    }
+
+    [[nodiscard]] unsigned int workers() const { return nWorkers; }
+
+    /**
+     * Runs first and second, possibly in parallel, and returns when both are
+     * done. An exception from either is rethrown here (second's if both throw).
+     */
+    template<typename First, typename Second>
+    void join(First&& first, Second&& second) {
+        TaskFor<First> task(first);
+        push(&task);
+        try {
+            second();
+        } catch (...) {
+            waitFor(&task);
+            throw;
+        }
+        waitFor(&task);
+        if (task.error) std::rethrow_exception(task.error);
+    }
+
+    /**
+     * Calls fn(i) for every i in [lo, hi), halving the range down to pieces
+     * of at most grain indices.
+     */
+    template<typename Fn>
+    void forEach(const int lo, const int hi, const int grain, Fn&& fn) {
+        if (hi - lo <= std::max(grain, 1)) {
+            for (int i = lo; i < hi; i++) fn(i);
+            return;
+        }
+        const int mid = lo + (hi - lo) / 2;
+        join([&] { forEach(lo, mid, grain, fn); }, [&] { forEach(mid, hi, grain, fn); });
+    }
+
+    [[nodiscard]] TaskPoolStats stats() const {
+        TaskPoolStats total;
+        for (unsigned int i = 0; i <= nWorkers; i++) {
+            total.forks += deques[i].forks.load(std::memory_order_relaxed);
+            total.stolen += deques[i].stolen.load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+};
+
+#endif //SCAPEGOATPROJECT_TASK_POOL_HPP
@@ -4,7 +4,16 @@
 #include <random>
 #include <algorithm>
 #include <set>
+#include <limits>
+#include <thread>
+#include <chrono>
+#include <bit>
+#include <cstdint>
 #include "scapegoat_tree.hpp"
+#include "sharded_scapegoat_tree.hpp"
+#include "rcu_scapegoat_tree.hpp"
+#include "concurrent_scapegoat_tree.hpp"
+#include "compact_scapegoat_tree.hpp"
 typedef int Type;
 // Helper function to check if the tree contains all values in a vector
 template<typename T>
@@ -217,6 +226,21 @@ void testUandR() {
     tree.redo();
     assert(tree.search(1) && tree.search(2) && tree.search(3));
 
+    // undo/redo leave recording on
+    const unsigned int recorded = tree.historySize();
+    tree.insert(99);
+    assert(recorded > 0 && tree.historySize() == recorded + 1);
+
+    // with recording off nothing is kept, and undo has nothing to take back
+    tree.setUndoHistory(false);
+    tree.insert(100);
+    assert(tree.historySize() == 0);
+    tree.undo();
+    assert(tree.search(100));
+    tree.setUndoHistory(true);
+    tree.deleteValue(100);
+    tree.undo();
+    assert(tree.search(100));
 
     std::cout << "Undo and Redo Passed!" << std::endl;
 }
@@ -321,6 +345,1694 @@ void testIterator() {
     assert(vect==list);
     std::cout << "Iterator passed"<<std::endl;
 }
+void testNodePool() {
+    std::cout << "Testing Node Pool..." << std::endl;
+    ScapeGoatTree<Type> tree;
+    tree.reserve(1000);
+    const std::size_t slabsAfterReserve = tree.poolStats().slabAllocations;
+    assert(tree.poolStats().capacity >= 1000);
+
+    // reserved slots cover the inserts, and deleted nodes are recycled
+    for (int i = 0; i < 1000; ++i) tree.insert(i);
+    for (int i = 0; i < 1000; i += 2) tree.deleteValue(i);
+    for (int i = 0; i < 1000; i += 2) tree.insert(i);
+    assert(tree.poolStats().slabAllocations == slabsAfterReserve);
+    assert(tree.poolStats().liveNodes == 1000);
+    for (int i = 0; i < 1000; ++i) assert(tree.search(i));
+
+    tree.clear();
+    assert(tree.poolStats().liveNodes == 0);
+    tree.shrink_to_fit();
+    assert(tree.poolStats().capacity == 0);
+
+    // a tree of strings exercises non-trivial node destruction
+    ScapeGoatTree<std::string> words;
+    for (int i = 0; i < 200; ++i) words.insert("word" + std::to_string(i));
+    for (int i = 0; i < 200; i += 3) words.deleteValue("word" + std::to_string(i));
+    assert(words.search("word1"));
+    assert(!words.search("word3"));
+    std::cout << "Node Pool Passed!" << std::endl;
+}
+void testInPlaceRebuild() {
+    std::cout << "Testing In-Place Rebuild..." << std::endl;
+    ScapeGoatTree<Type> tree;
+    constexpr int N = 4096;
+    tree.reserve(N);
+    const std::size_t served = tree.poolStats().nodesServed;
+    // ascending inserts force many scapegoat rebuilds, deletes force full rebuilds
+    for (int i = 0; i < N; ++i) tree.insert(i);
+    for (int i = 0; i < N; i += 4) tree.deleteValue(i);
+    for (int i = 0; i < N; i += 4) tree.deleteValue(i + 1);
+
+    // rebuilds reused the nodes: exactly one node per insert was ever created
+    assert(tree.poolStats().nodesServed - served == N);
+    assert(tree.poolStats().liveNodes == N / 2);
+    assert(tree.isBalanced().find("NOT balanced") == std::string::npos);
+
+    std::vector<Type> expected, actual;
+    for (int i = 0; i < N; ++i) if (i % 4 > 1) expected.push_back(i);
+    for (auto v : tree) actual.push_back(v);
+    assert(actual == expected);
+    for (int k = 1; k <= N / 2; k += 97) assert(tree.kthSmallest(k) == expected[k - 1]);
+    std::cout << "In-Place Rebuild Passed!" << std::endl;
+}
+void testHotPaths() {
+    std::cout << "Testing Allocation-Free Insert/Delete..." << std::endl;
+    ScapeGoatTree<Type> tree;
+    constexpr int N = 3000;
+    tree.reserve(N);
+    const std::size_t slabs = tree.poolStats().slabAllocations;
+    std::mt19937 rng(7);
+    std::vector<Type> keys(N);
+    for (int i = 0; i < N; ++i) keys[i] = i;
+    std::ranges::shuffle(keys, rng);
+
+    for (Type k : keys) tree.insert(k);
+    for (Type k : keys) tree.insert(k); // duplicates leave sizes untouched
+    assert(tree.kthSmallest(N) == N - 1);
+    // deletes hit leaves, one-child and two-child nodes
+    std::set<Type> reference(keys.begin(), keys.end());
+    for (int i = 0; i < N; i += 3) {
+        assert(tree.deleteValue(keys[i]));
+        reference.erase(keys[i]);
+    }
+    assert(!tree.deleteValue(keys[0]));
+    assert(tree.poolStats().slabAllocations == slabs);
+
+    int k = 1;
+    for (Type v : reference) assert(tree.kthSmallest(k++) == v);
+    tree.undo();
+    assert(tree.search(keys[N - 3]));
+    std::cout << "Allocation-Free Insert/Delete Passed!" << std::endl;
+}
+// user-defined monoid: how many keys and their sum, in one aggregate
+struct CountSum {
+    using value_type = std::pair<long long, long long>;
+    static value_type identity() { return {0, 0}; }
+    static value_type lift(const Type& v) { return {1, v}; }
+    static value_type combine(const value_type& a, const value_type& b) { return {a.first + b.first, a.second + b.second}; }
+};
+
+template<typename Agg>
+void checkAggregate(const ScapeGoatTree<Type, Agg>& tree, const std::set<Type>& reference, std::mt19937& rng) {
+    std::uniform_int_distribution<int> dist(-50, 2100);
+    for (int q = 0; q < 50; ++q) {
+        int lo = dist(rng), hi = dist(rng);
+        if (hi < lo) std::swap(lo, hi);
+        auto expected = Agg::identity();
+        for (auto it = reference.lower_bound(lo); it != reference.end() && *it <= hi; ++it)
+            expected = Agg::combine(expected, Agg::lift(*it));
+        assert(tree.aggregateInRange(lo, hi) == expected);
+        // the same monoid folded without stored aggregates must agree
+        assert((ScapeGoatTree<Type>().template aggregateInRange<Agg>(lo, hi) == Agg::identity()));
+    }
+}
+
+void testAggregates() {
+    std::cout << "Testing Subtree Aggregates..." << std::endl;
+    std::mt19937 rng(11);
+    std::uniform_int_distribution<int> dist(0, 2000);
+    ScapeGoatTree<Type, SumAggregate<Type>> sums;
+    ScapeGoatTree<Type, MinAggregate<Type>> mins;
+    ScapeGoatTree<Type, MaxAggregate<Type>> maxs;
+    ScapeGoatTree<Type, CountSum> custom;
+    ScapeGoatTree<Type> plain;
+    std::set<Type> reference;
+
+    for (int i = 0; i < 6000; ++i) {
+        const int v = dist(rng);
+        if (i % 3 == 2) {
+            sums.deleteValue(v); mins.deleteValue(v); maxs.deleteValue(v); custom.deleteValue(v); plain.deleteValue(v);
+            reference.erase(v);
+        } else {
+            sums.insert(v); mins.insert(v); maxs.insert(v); custom.insert(v); plain.insert(v);
+            reference.insert(v);
+        }
+        if (i % 1000 == 999) {
+            checkAggregate(sums, reference, rng);
+            checkAggregate(mins, reference, rng);
+            checkAggregate(maxs, reference, rng);
+            checkAggregate(custom, reference, rng);
+        }
+    }
+    // the O(log n) sum, the O(k) sum and an ad-hoc fold agree
+    for (int q = 0; q < 100; ++q) {
+        int lo = dist(rng), hi = dist(rng);
+        if (hi < lo) std::swap(lo, hi);
+        assert(sums.sumInRange(lo, hi) == plain.sumInRange(lo, hi));
+        assert(plain.aggregateInRange<SumAggregate<Type>>(lo, hi) == plain.sumInRange(lo, hi));
+        assert(static_cast<long long>(plain.aggregateInRange<CountAggregate<Type>>(lo, hi)) == custom.aggregateInRange(lo, hi).first);
+    }
+
+    // merge keeps aggregates intact
+    ScapeGoatTree<Type, SumAggregate<Type>> other;
+    for (int v = 2500; v < 2600; ++v) other.insert(v);
+    auto merged = sums + other;
+    assert(merged.sumInRange(2500, 2599) == (2500 + 2599) * 100 / 2);
+    assert(merged.sumInRange(0, 3000) == sums.sumInRange(0, 3000) + other.sumInRange(0, 3000));
+
+    // split halves carry correct aggregates
+    const Type pivot = merged.getRoot()->value;
+    long long below = 0, above = 0;
+    for (Type v : reference) (v < pivot ? below : above) += v;
+    auto [low, high] = merged.split(pivot);
+    assert(low.sumInRange(-1, 5000) == below);
+    assert(high.sumInRange(-1, 5000) == above + other.sumInRange(0, 3000));
+    std::cout << "Subtree Aggregates Passed!" << std::endl;
+}
+void testBulkConstruction() {
+    std::cout << "Testing Bulk Construction..." << std::endl;
+    std::mt19937 rng(5);
+    std::vector<Type> unsorted(5000);
+    for (auto& v : unsorted) v = static_cast<Type>(rng() % 3000);
+    std::vector<Type> expected = unsorted;
+    std::ranges::sort(expected);
+    expected.erase(std::ranges::unique(expected).begin(), expected.end());
+
+    // unsorted input is sorted and deduplicated
+    ScapeGoatTree<Type> tree(unsorted.begin(), unsorted.end());
+    std::vector<Type> actual;
+    for (auto v : tree) actual.push_back(v);
+    assert(actual == expected);
+    assert(tree.kthSmallest(static_cast<int>(expected.size())) == expected.back());
+    assert(tree.isBalanced().find("NOT balanced") == std::string::npos);
+
+    // sorted input, built with exactly one node per key
+    auto sorted = ScapeGoatTree<Type, SumAggregate<Type>>::fromSorted(expected.begin(), expected.end());
+    assert(sorted.poolStats().nodesServed == expected.size());
+    long long total = 0;
+    for (auto v : expected) total += v;
+    assert(sorted.sumInRange(0, 3000) == total);
+    tree.insert(-1); // the tree stays fully usable
+    assert(tree.getMin() == -1);
+
+    // assignSorted as one undoable batch
+    std::vector<Type> replacement = {1, 2, 3};
+    tree.assignSorted(replacement.begin(), replacement.end());
+    assert(tree.search(2) && !tree.search(-1) && !tree.search(expected.back()));
+    tree.undo();
+    assert(tree.search(2) == std::ranges::binary_search(expected, 2));
+    assert(tree.search(-1) && tree.search(expected.back()));
+
+    // without undo recording the history is dropped
+    tree.assignSorted(replacement.begin(), replacement.end(), false);
+    tree.undo();
+    assert(tree.search(1) && tree.search(3) && !tree.search(-1));
+
+    // assignSorted checks the order instead of restoring it
+    bool rejected = false;
+    try { tree.assignSorted(unsorted.begin(), unsorted.end()); } catch (const std::invalid_argument&) { rejected = true; }
+    assert(rejected && tree.search(1) && tree.size() == 3);
+
+    // deduplication leaves unique keys intact, even ones that own memory
+    std::vector<std::string> words = {"pear", "apple", "fig", "apple", "kiwi"};
+    ScapeGoatTree<std::string> dictionary(words.begin(), words.end());
+    std::vector<std::string> kept;
+    for (const auto& w : dictionary) kept.push_back(w);
+    assert((kept == std::vector<std::string>{"apple", "fig", "kiwi", "pear"}));
+    std::cout << "Bulk Construction Passed!" << std::endl;
+}
+void testMergeBatch() {
+    std::cout << "Testing Merge-and-Rebuild Batch Insert..." << std::endl;
+    ScapeGoatTree<Type, SumAggregate<Type>> tree;
+    std::set<Type> reference;
+    for (int i = 0; i < 1000; i += 2) { tree.insert(i); reference.insert(i); }
+
+    // half the batch already exists; big enough to take the merge path
+    Vector<Type> batch;
+    for (int i = 1500; i >= 0; i -= 3) { batch.push_back(i); reference.insert(i); }
+    const int rebuilds = std::stoi(tree.isBalanced().substr(tree.isBalanced().find("Rebuilds: ") + 10));
+    tree.insertBatch(batch);
+    assert(std::stoi(tree.isBalanced().substr(tree.isBalanced().find("Rebuilds: ") + 10)) == rebuilds + 1);
+
+    std::vector<Type> actual;
+    for (auto v : tree) actual.push_back(v);
+    assert(actual == std::vector<Type>(reference.begin(), reference.end()));
+    long long total = 0;
+    for (auto v : reference) total += v;
+    assert(tree.sumInRange(0, 2000) == total);
+    assert(tree.kthSmallest(static_cast<int>(reference.size())) == 1500);
+
+    // undo removes exactly the keys the batch added
+    tree.undo();
+    for (int i = 0; i <= 1500; ++i) assert(tree.search(i) == (i < 1000 && i % 2 == 0));
+    tree.redo();
+    assert(tree.search(1497) && tree.search(3));
+
+    // with the ratio disabled the same batch goes through insert() one by one
+    ScapeGoatTree<Type> slow;
+    slow.setBatchRebuildRatio(1e18);
+    slow.insertBatch(batch);
+    assert(slow.search(1500) && slow.search(0) && !slow.search(1));
+
+    // the ratio is a setting of the tree and follows it through moves
+    ScapeGoatTree<Type> moved(std::move(slow));
+    assert(moved.getBatchRebuildRatio() == 1e18);
+    ScapeGoatTree<Type> assigned;
+    assigned = std::move(moved);
+    assert(assigned.getBatchRebuildRatio() == 1e18);
+    std::cout << "Merge-and-Rebuild Batch Insert Passed!" << std::endl;
+}
+void testSubtractBatch() {
+    std::cout << "Testing Set-Difference Batch Delete..." << std::endl;
+    ScapeGoatTree<Type, SumAggregate<Type>> tree;
+    for (int i = 0; i < 2000; ++i) tree.insert(i);
+
+    // purge every key divisible by 3, plus keys that are not in the tree
+    Vector<Type> victims;
+    for (int i = 3000; i >= -30; i -= 3) victims.push_back(i);
+    tree.deleteBatch(victims);
+    long long total = 0;
+    int count = 0;
+    for (int i = 0; i < 2000; ++i) {
+        assert(tree.search(i) == (i % 3 != 0));
+        if (i % 3) { total += i; count++; }
+    }
+    assert(tree.sumInRange(-100, 5000) == total);
+    assert(tree.kthSmallest(count) == 1999);
+    assert(tree.isBalanced().find("NOT balanced") == std::string::npos);
+
+    // undo only brings back what was removed
+    tree.undo();
+    for (int i = 0; i < 2000; ++i) assert(tree.search(i));
+    assert(!tree.search(-3) && !tree.search(2001));
+    tree.redo();
+    assert(!tree.search(0) && tree.search(1));
+
+    // everything at once empties the tree cleanly
+    Vector<Type> all;
+    for (int i = 0; i < 2000; ++i) all.push_back(i);
+    tree.deleteBatch(all);
+    assert(!tree);
+    assert(tree.poolStats().liveNodes == 0);
+    std::cout << "Set-Difference Batch Delete Passed!" << std::endl;
+}
+void testSetAlgebra() {
+    std::cout << "Testing Set Algebra..." << std::endl;
+    ScapeGoatTree<Type, SumAggregate<Type>> evens, threes, few;
+    for (int i = 0; i < 600; i += 2) evens.insert(i);
+    for (int i = 0; i < 600; i += 3) threes.insert(i);
+    for (int i = 0; i < 600; i += 150) few.insert(i); // 0 150 300 450: lopsided, takes the search path
+
+    auto both = evens.intersect(threes);
+    auto onlyEvens = evens.difference(threes);
+    auto either = evens.symmetricDifference(threes);
+    for (int i = -6; i < 606; ++i) {
+        const bool e = i >= 0 && i < 600 && i % 2 == 0, t = i >= 0 && i < 600 && i % 3 == 0;
+        assert(both.search(i) == (e && t));
+        assert(onlyEvens.search(i) == (e && !t));
+        assert(either.search(i) == (e != t));
+    }
+    assert(both.sumInRange(0, 600) == both.aggregateInRange<SumAggregate<Type>>(0, 600));
+
+    auto fewEvens = few.intersect(evens);
+    assert(fewEvens.search(0) && fewEvens.search(150) && fewEvens.search(300) && fewEvens.search(450));
+    assert(evens.intersect(few) == fewEvens);
+    auto fewOdd = few.difference(evens);
+    assert(!fewOdd);
+    assert(few.isSubsetOf(threes) && !few.isSubsetOf(evens.difference(few)));
+    assert(!evens.isSubsetOf(threes) && both.isSubsetOf(evens) && both.isSubsetOf(threes));
+    assert(onlyEvens.isDisjoint(threes) && threes.isDisjoint(onlyEvens));
+    assert(!evens.isDisjoint(threes) && !few.isDisjoint(evens));
+    assert(few.isDisjoint(evens.difference(few)));
+
+    // in-place union: small donor is hung in node by node, large one merged
+    ScapeGoatTree<Type, SumAggregate<Type>> target(evens), donor(few);
+    donor.insert(151);
+    target.unionWith(std::move(donor));
+    assert(!donor && donor.poolStats().liveNodes == 0);
+    assert(target.search(151) && target.search(450) && target.search(598));
+    assert(target.poolStats().liveNodes == 301);
+    target.undo(); // only the key that was new goes away
+    assert(!target.search(151) && target.search(150));
+    assert(target.sumInRange(0, 600) == evens.sumInRange(0, 600));
+
+    ScapeGoatTree<Type, SumAggregate<Type>> odds;
+    for (int i = 1; i < 600; i += 2) odds.insert(i);
+    target.unionWith(std::move(odds));
+    for (int i = 0; i < 600; ++i) assert(target.search(i));
+    assert(target.sumInRange(0, 600) == 599LL * 600 / 2);
+    assert(target.isBalanced().find("NOT balanced") == std::string::npos);
+    // nodes that came from the donor are recycled through the adopted pool
+    for (int i = 1; i < 600; i += 2) target.deleteValue(i);
+    assert(target.poolStats().liveNodes == 300);
+    std::cout << "Set Algebra Passed!" << std::endl;
+}
+void testSplitJoin() {
+    std::cout << "Testing Split and Join..." << std::endl;
+    auto build = [](int from, int to) {
+        ScapeGoatTree<Type, SumAggregate<Type>> tree;
+        for (int i = from; i < to; ++i) tree.insert(i * 2);
+        return tree;
+    };
+    auto checkRange = [](auto& tree, int from, int to) { // holds exactly the even keys in [2*from, 2*to)
+        const long long n = to - from;
+        assert(tree.getRoot() == nullptr ? n == 0 : tree.getRoot()->size == n);
+        assert(tree.sumInRange(-10, 100000) == n * (from + to - 1));
+        for (int k = from; k < to; ++k) assert(tree.search(k * 2));
+        assert(!tree.search(from * 2 - 2) && !tree.search(to * 2));
+        assert(tree.isBalanced().find("NOT balanced") == std::string::npos);
+        assert(static_cast<long long>(tree.poolStats().liveNodes) == n);
+    };
+
+    // split on a present key, an absent key and both ends
+    auto tree = build(0, 1000);
+    auto [low, high] = tree.split(700); // present: 700 goes right
+    assert(!tree && tree.poolStats().liveNodes == 0);
+    checkRange(low, 0, 350);
+    checkRange(high, 350, 1000);
+    auto [lowA, lowB] = low.split(301); // absent
+    checkRange(lowA, 0, 151);
+    checkRange(lowB, 151, 350);
+    auto [none, all] = high.split(-5);
+    assert(!none);
+    checkRange(all, 350, 1000);
+
+    // halves live on independently, each in slabs of its own
+    lowB.insert(1);
+    lowB.deleteValue(1);
+    for (int k = 350; k < 400; ++k) all.deleteValue(k * 2);
+    checkRange(all, 400, 1000);
+    lowA.clear();
+    lowA.shrink_to_fit();
+
+    // join is the inverse of split, whichever side is larger
+    auto joined = decltype(lowB)::join(std::move(lowB), std::move(all));
+    assert(!lowB && !all);
+    assert(joined.getRoot()->size == 199 + 600 && joined.search(302) && joined.search(800) && !joined.search(798));
+    assert(joined.isBalanced().find("NOT balanced") == std::string::npos);
+    auto small = build(10, 20);
+    auto big = build(20, 1000);
+    auto merged = decltype(small)::join(std::move(small), std::move(big));
+    checkRange(merged, 10, 1000);
+    auto tiny = build(1000, 1003);
+    merged = decltype(merged)::join(std::move(merged), std::move(tiny));
+    checkRange(merged, 10, 1003);
+
+    bool threw = false;
+    auto overlap = build(0, 50);
+    try {
+        decltype(overlap)::join(std::move(overlap), build(49, 60));
+    } catch (const std::invalid_argument&) {
+        threw = true;
+    }
+    assert(threw && overlap.search(98));
+
+    // the smaller half is copied out, so the larger one holds all the old slabs
+    // and hands them back once its own keys are gone
+    auto whole = build(0, 2000);
+    const std::size_t before = whole.poolStats().capacity;
+    auto [most, few] = whole.split(3980); // 10 keys go right
+    assert(few.poolStats().capacity < 100 && most.poolStats().capacity == before);
+    checkRange(few, 1990, 2000);
+    most.clear();
+    most.shrink_to_fit();
+    assert(most.poolStats().capacity == 0 && few.search(3990));
+
+    // constant split/join churn keeps the tree intact and balanced
+    auto churn = build(0, 2000);
+    unsigned int seed = 7;
+    for (int round = 0; round < 300; ++round) {
+        seed = seed * 1103515245u + 12345u;
+        auto [a, b] = churn.split(static_cast<Type>(seed % 4200) - 100);
+        churn = decltype(churn)::join(std::move(a), std::move(b));
+    }
+    checkRange(churn, 0, 2000);
+    std::cout << "Split and Join Passed!" << std::endl;
+}
+void testStructuralCopy() {
+    std::cout << "Testing Structural Copy..." << std::endl;
+    ScapeGoatTree<Type, SumAggregate<Type>> original(0.8);
+    unsigned int seed = 11;
+    for (int i = 0; i < 3000; ++i) {
+        seed = seed * 1103515245u + 12345u;
+        original.insert(static_cast<Type>(seed % 10000));
+    }
+    for (int i = 0; i < 10000; i += 7) original.deleteValue(i);
+
+    ScapeGoatTree<Type, SumAggregate<Type>> copy(original);
+    assert(copy == original);                        // same shape, not just same keys
+    assert(copy.isBalanced() == original.isBalanced()); // same counters
+    assert(copy.poolStats().slabAllocations == 1);   // one contiguous block
+    assert(copy.sumInRange(100, 9000) == original.sumInRange(100, 9000));
+    assert(copy.kthSmallest(500) == original.kthSmallest(500));
+
+    // no history was copied, and the copy is independent of the original
+    copy.undo();
+    assert(copy == original);
+    // same ALPHA and max_nodes: identical operations keep identical shapes
+    for (int i = 1; i < 10000; i += 5) {
+        copy.insert(i);
+        original.insert(i);
+        if (i % 3 == 0) {
+            copy.deleteValue(i - 1);
+            original.deleteValue(i - 1);
+        }
+    }
+    assert(copy == original);
+    copy.insert(-1);
+    assert(!original.search(-1));
+
+    // assignment over a non-empty tree, and self-assignment
+    ScapeGoatTree<Type, SumAggregate<Type>> target;
+    for (int i = 0; i < 50; ++i) target.insert(-i - 100);
+    target = original;
+    assert(target == original && !target.search(-100));
+    target.undo();
+    assert(target == original);
+    auto& alias = target;
+    target = alias;
+    assert(target == original);
+    std::cout << "Structural Copy Passed!" << std::endl;
+}
+void testSnapshots() {
+    std::cout << "Testing Snapshots..." << std::endl;
+    using SumTree = ScapeGoatTree<Type, SumAggregate<Type>>;
+    auto matches = [](const SumTree::Snapshot& snap, const std::vector<Type>& expected) {
+        std::vector<Type> seen;
+        for (Type v : snap) seen.push_back(v);
+        assert(seen == expected);
+        assert(snap.size() == static_cast<int>(expected.size()));
+        long long total = 0;
+        for (Type v : expected) total += v;
+        assert(snap.sumInRange(-1000000, 1000000) == total);
+        for (int k = 1; k <= static_cast<int>(expected.size()); k += 37) assert(snap.kthSmallest(k) == expected[k - 1]);
+        for (Type v : expected) assert(snap.search(v));
+    };
+
+    SumTree tree;
+    std::vector<Type> before;
+    for (int i = 0; i < 2000; i += 2) {
+        tree.insert(i);
+        before.push_back(i);
+    }
+    auto first = tree.snapshot();
+    assert(tree.liveSnapshots() == 1);
+
+    // every kind of write: path copies, deletions, rebuilds and batch merges
+    for (int i = 1; i < 2000; i += 4) tree.insert(i);
+    for (int i = 0; i < 2000; i += 6) tree.deleteValue(i);
+    for (int i = 5000; i < 5300; ++i) tree.insert(i); // sorted run: forces scapegoat rebuilds
+    Vector<Type> batch, victims;
+    for (int i = 3000; i < 4000; ++i) batch.push_back(i);
+    tree.setBatchRebuildRatio(0.0);
+    tree.insertBatch(batch);
+    for (int i = 3000; i < 4000; i += 2) victims.push_back(i);
+    tree.deleteBatch(victims);
+    matches(first, before);
+    assert(!first.search(1) && !first.search(3001));
+
+    std::vector<Type> middle;
+    for (Type v : tree) middle.push_back(v);
+    auto second = tree.snapshot();
+    auto secondCopy = second; // handles share one view
+    for (int i = 0; i < 6000; i += 3) tree.deleteValue(i);
+    tree.undo();
+    matches(first, before);
+    matches(second, middle);
+    matches(secondCopy, middle);
+
+    // live tree is still consistent
+    long long total = 0;
+    int count = 0;
+    for (Type v : tree) { total += v; count++; }
+    assert(tree.sumInRange(-1, 100000) == total && tree.getRoot()->size == static_cast<unsigned int>(count));
+    assert(tree.isBalanced().find("NOT balanced") == std::string::npos);
+
+    // dropping every handle lets the next write reclaim the old versions
+    first = second;
+    {
+        auto dropped = std::move(first);
+    }
+    second = tree.snapshot();
+    secondCopy = second;
+    tree.insert(-1);
+    assert(tree.liveSnapshots() == 1);
+    second = SumTree().snapshot();
+    secondCopy = second;
+    tree.insert(-2);
+    assert(tree.liveSnapshots() == 0);
+    assert(static_cast<int>(tree.poolStats().liveNodes) == count + 2);
+
+    // snapshots outlive structural operations and the tree itself
+    std::vector<Type> last;
+    for (Type v : tree) last.push_back(v);
+    auto survivor = tree.snapshot();
+    {
+        auto [low, high] = tree.split(2500);
+        low.deleteValue(-1);
+        auto joined = SumTree::join(std::move(low), std::move(high));
+        tree = std::move(joined);
+    }
+    matches(survivor, last);
+    tree.clear();
+    {
+        SumTree doomed;
+        for (int i = 0; i < 500; ++i) doomed.insert(i * 3);
+        survivor = doomed.snapshot();
+        doomed.deleteValue(0);
+    }
+    std::vector<Type> tripled;
+    for (int i = 0; i < 500; ++i) tripled.push_back(i * 3);
+    matches(survivor, tripled);
+
+    // a reader thread sees one consistent version while the writer keeps going
+    SumTree live;
+    for (int i = 0; i < 20000; ++i) live.insert(i);
+    auto view = live.snapshot();
+    bool consistent = true;
+    std::thread reader([&view, &consistent] {
+        for (int round = 0; round < 20; ++round) {
+            long long sum = 0;
+            for (Type v : view) sum += v;
+            consistent = consistent && sum == 19999LL * 20000 / 2 && view.sumInRange(0, 20000) == sum;
+        }
+    });
+    for (int i = 0; i < 20000; i += 2) live.deleteValue(i);
+    for (int i = 20000; i < 30000; ++i) live.insert(i);
+    reader.join();
+    assert(consistent);
+    std::cout << "Snapshots Passed!" << std::endl;
+}
+void testBackgroundRebuild() {
+    std::cout << "Testing Background Rebuild..." << std::endl;
+    auto sameAs = [](ScapeGoatTree<Type>& tree, const std::set<Type>& reference) {
+        std::vector<Type> seen;
+        for (Type v : tree) seen.push_back(v);
+        assert(seen == std::vector<Type>(reference.begin(), reference.end()));
+        assert(tree.size() == static_cast<int>(reference.size()));
+    };
+
+    // the deletion rebuild goes to the worker; writes made meanwhile are replayed
+    ScapeGoatTree<Type> tree;
+    std::set<Type> reference;
+    for (int i = 0; i < 20000; ++i) {
+        tree.insert(i);
+        reference.insert(i);
+    }
+    tree.setBackgroundRebuild(1000);
+    auto rebuilds = [](const ScapeGoatTree<Type>& t) {
+        return std::stoi(t.isBalanced().substr(t.isBalanced().find("Rebuilds: ") + 10));
+    };
+    const int rebuildsBefore = rebuilds(tree);
+    bool started = false;
+    for (int i = 0; i < 20000 && !started; ++i) {
+        tree.deleteValue(i);
+        reference.erase(i);
+        started = tree.rebuildPending();
+    }
+    assert(started);
+    std::mt19937 rng(15);
+    for (int op = 0; op < 5000; ++op) {
+        const Type v = static_cast<Type>(rng() % 30000);
+        if (rng() % 2) {
+            tree.insert(v);
+            reference.insert(v);
+        } else {
+            assert(tree.deleteValue(v) == (reference.erase(v) == 1));
+        }
+        if (op % 1000 == 0) {
+            sameAs(tree, reference);
+            assert(tree.search(v) == reference.count(v));
+        }
+    }
+    tree.waitForRebuild();
+    assert(!tree.rebuildPending() && rebuilds(tree) > rebuildsBefore);
+    sameAs(tree, reference);
+    assert(tree.isBalanced().find("NOT balanced") == std::string::npos);
+    assert(static_cast<int>(tree.poolStats().liveNodes) == tree.size());
+    // undo history stays with the tree across the swap
+    tree.insert(-5);
+    tree.undo();
+    assert(!tree.search(-5));
+
+    // a sorted run makes a large scapegoat, which is rebuilt in the background too
+    ScapeGoatTree<Type> sorted;
+    sorted.setBackgroundRebuild(2000);
+    for (int i = 0; i < 50000; ++i) sorted.insert(i);
+    sorted.waitForRebuild();
+    for (int i = 0; i < 50000; i += 7) assert(sorted.search(i));
+    assert(sorted.size() == 50000);
+
+    // a user snapshot taken before the swap keeps its version
+    ScapeGoatTree<Type> viewed;
+    for (int i = 0; i < 10000; ++i) viewed.insert(i);
+    viewed.setBackgroundRebuild(100);
+    auto before = viewed.snapshot();
+    for (int i = 0; i < 5001; ++i) viewed.deleteValue(i);
+    assert(viewed.rebuildPending()); // the last delete dropped below half
+    for (int i = 5001; i < 6000; ++i) viewed.deleteValue(i);
+    viewed.waitForRebuild();
+    viewed.deleteValue(9999);
+    assert(before.size() == 10000 && before.search(0) && before.search(9999));
+    assert(viewed.size() == 3999 && !viewed.search(0));
+
+    // values with destructors are freed on the reaper thread; a pending job dies with its tree
+    {
+        ScapeGoatTree<std::string> words;
+        words.setBackgroundRebuild(50);
+        for (int i = 0; i < 3000; ++i) words.insert("word" + std::to_string(i));
+        for (int i = 0; i < 2000; ++i) words.deleteValue("word" + std::to_string(i));
+        words.waitForRebuild();
+        assert(words.size() == 1000 && words.search("word2500") && !words.search("word10"));
+        for (int i = 2000; i < 2700; ++i) words.deleteValue("word" + std::to_string(i));
+    }
+    // turning it off drops the pending job and keeps the contents
+    for (int i = 0; i < 3000; ++i) tree.deleteValue(i * 7);
+    tree.setBackgroundRebuild(0);
+    assert(!tree.rebuildPending());
+    for (int i = 0; i < 3000; ++i) reference.erase(i * 7);
+    sameAs(tree, reference);
+    std::cout << "Background Rebuild Passed!" << std::endl;
+}
+void testIncrementalRebuild() {
+    std::cout << "Testing Incremental Rebuild..." << std::endl;
+    using SumTree = ScapeGoatTree<Type, SumAggregate<Type>>;
+    auto sameAs = [](SumTree& tree, const std::set<Type>& reference) {
+        std::vector<Type> seen;
+        for (Type v : tree) seen.push_back(v);
+        assert(seen == std::vector<Type>(reference.begin(), reference.end()));
+        long long total = 0;
+        for (Type v : reference) total += v;
+        assert(tree.size() == static_cast<int>(reference.size()) && tree.sumInRange(-1, 1000000) == total);
+    };
+
+    // the deletion rebuild advances a few steps per operation; every stage is checked
+    SumTree tree;
+    std::set<Type> reference;
+    for (int i = 0; i < 20000; ++i) {
+        tree.insert(i);
+        reference.insert(i);
+    }
+    tree.setIncrementalRebuild(16);
+    int first = 0;
+    while (!tree.rebuildPending()) {
+        tree.deleteValue(first);
+        reference.erase(first++);
+    }
+    std::mt19937 rng(16);
+    int ops = 0;
+    for (; tree.rebuildPending(); ++ops) {
+        const Type v = static_cast<Type>(rng() % 30000);
+        if (rng() % 2) {
+            tree.insert(v);
+            reference.insert(v);
+        } else {
+            assert(tree.deleteValue(v) == (reference.erase(v) == 1));
+        }
+        assert(tree.search(v) == reference.count(v));
+        if (ops % 500 == 0) sameAs(tree, reference);
+    }
+    // copying, linking and replaying ~10000 nodes at 16 steps per operation
+    assert(ops > 10000 / 16);
+    sameAs(tree, reference);
+    assert(tree.isBalanced().find("NOT balanced") == std::string::npos);
+    // the old tree is condemned, not freed yet
+    assert(static_cast<int>(tree.poolStats().liveNodes) > tree.size());
+    tree.setIncrementalRebuild(0); // frees what is left at once
+    assert(static_cast<int>(tree.poolStats().liveNodes) == tree.size());
+
+    // sorted runs make large scapegoats; they are rebuilt incrementally as well,
+    // and deep paths hurry the job along instead of letting the height drift
+    SumTree sorted;
+    sorted.setIncrementalRebuild(32);
+    for (int i = 0; i < 50000; ++i) {
+        sorted.insert(i);
+        if (i % 5000 == 4999) {
+            const std::string report = sorted.isBalanced();
+            const int height = std::stoi(report.substr(report.find("Height: ") + 8));
+            const double bound = std::stod(report.substr(report.find("Height bound: ") + 14));
+            assert(height <= 2 * bound);
+        }
+    }
+    sorted.waitForRebuild();
+    for (int i = 0; i < 50000; i += 7) assert(sorted.search(i));
+    assert(sorted.size() == 50000 && sorted.sumInRange(0, 49999) == 49999LL * 50000 / 2);
+
+    // subtree jobs while writes land inside and outside their range
+    SumTree mixed;
+    std::set<Type> present;
+    mixed.setIncrementalRebuild(8);
+    for (int i = 0; i < 40000; ++i) {
+        const Type v = i < 15000 ? static_cast<Type>(i) : static_cast<Type>(rng() % 20000);
+        if (i < 15000 || rng() % 3) {
+            mixed.insert(v);
+            present.insert(v);
+        } else {
+            assert(mixed.deleteValue(v) == (present.erase(v) == 1));
+        }
+        if (i % 2000 == 0) sameAs(mixed, present);
+    }
+    mixed.waitForRebuild();
+    sameAs(mixed, present);
+
+    // a user snapshot taken before the swap keeps its version
+    SumTree viewed;
+    for (int i = 0; i < 10000; ++i) viewed.insert(i);
+    viewed.setIncrementalRebuild(8);
+    auto before = viewed.snapshot();
+    for (int i = 0; i < 6000; ++i) viewed.deleteValue(i);
+    viewed.waitForRebuild();
+    for (int i = 0; i < 3000; ++i) viewed.insert(-i);
+    assert(before.size() == 10000 && before.search(0) && before.sumInRange(0, 9999) == 9999LL * 10000 / 2);
+    assert(viewed.size() == 7000 && !viewed.search(1));
+
+    // values with destructors; trees destroyed while copying, linking and draining
+    for (int stop = 100; stop <= 6000; stop += 1300) {
+        ScapeGoatTree<std::string> words;
+        words.setIncrementalRebuild(4);
+        for (int i = 0; i < 3000; ++i) words.insert("word" + std::to_string(i));
+        for (int i = 0; i < 1501 + stop; ++i) words.deleteValue("w" + std::to_string(i)); // misses
+        for (int i = 0; i < 1501; ++i) words.deleteValue("word" + std::to_string(i));
+        for (int i = 0; i < stop; ++i) words.insert("more" + std::to_string(i));
+        assert(words.size() == 1499 + stop && words.search("word2000") && !words.search("word10"));
+    }
+    std::cout << "Incremental Rebuild Passed!" << std::endl;
+}
+void testParallelRebuild() {
+    std::cout << "Testing Parallel Rebuild..." << std::endl;
+    using Key = long long; // the sums over these key ranges do not fit in an int
+    using SumTree = ScapeGoatTree<Key, SumAggregate<Key>>;
+    // every node matches the serial tree's: value, size and parent
+    auto sameShape = [](SumTree& serial, SumTree& parallel) {
+        using SumNode = Node<Key, SumAggregate<Key>>;
+        std::vector<std::pair<const SumNode*, const SumNode*>> todo{{serial.getRoot(), parallel.getRoot()}};
+        while (!todo.empty()) {
+            const auto [a, b] = todo.back();
+            todo.pop_back();
+            assert((a == nullptr) == (b == nullptr));
+            if (!a) continue;
+            assert(a->value == b->value && a->size == b->size);
+            assert((a->parent == nullptr) == (b->parent == nullptr) && (!a->parent || a->parent->value == b->parent->value));
+            todo.push_back({a->left, b->left});
+            todo.push_back({a->right, b->right});
+        }
+        assert(parallel.sumInRange(-1000000, 1000000) == serial.sumInRange(-1000000, 1000000));
+    };
+
+    // ascending inserts rebuild large scapegoats; the deletes end in a whole-tree rebuild
+    SumTree serial, parallel;
+    parallel.setRebuildThreads(4);
+    for (int i = 0; i < 200000; ++i) {
+        serial.insert(i);
+        parallel.insert(i);
+    }
+    sameShape(serial, parallel);
+    for (int i = 0; i < 100001; ++i) {
+        serial.deleteValue(i * 2 % 200000 + i * 2 / 200000);
+        parallel.deleteValue(i * 2 % 200000 + i * 2 / 200000);
+    }
+    sameShape(serial, parallel);
+    assert(parallel.poolStats().liveNodes == static_cast<std::size_t>(parallel.size()));
+
+    // bulk loads and set operations build their results in parallel too
+    std::vector<Key> evens, thirds;
+    for (int i = 0; i < 300000; i += 2) evens.push_back(i);
+    for (int i = 0; i < 300000; i += 3) thirds.push_back(i);
+    SumTree a, b, pa, pb;
+    pa.setRebuildThreads(3);
+    pb.setRebuildThreads(3);
+    a.assignSorted(evens.begin(), evens.end());
+    b.assignSorted(thirds.begin(), thirds.end());
+    pa.assignSorted(evens.begin(), evens.end());
+    pb.assignSorted(thirds.begin(), thirds.end());
+    sameShape(a, pa);
+    SumTree both = a + b, pboth = pa + pb;
+    sameShape(both, pboth);
+    assert(pboth.getRebuildThreads() == 3 && pboth.size() == 150000 + 100000 - 50000);
+    SumTree common = a.intersect(b), pcommon = pa.intersect(pb);
+    sameShape(common, pcommon);
+
+    // values with destructors
+    ScapeGoatTree<std::string> words, more;
+    words.setRebuildThreads(8);
+    for (int i = 0; i < 70000; ++i) words.insert("w" + std::to_string(i));
+    for (int i = 0; i < 40000; ++i) more.insert("m" + std::to_string(i));
+    ScapeGoatTree<std::string> all = words + more;
+    assert(all.size() == 110000 && all.search("w69999") && all.search("m0"));
+    for (int i = 0; i < 40000; ++i) words.deleteValue("w" + std::to_string(i));
+    assert(words.size() == 30000 && words.search("w40000") && !words.search("w39999"));
+    std::cout << "Parallel Rebuild Passed!" << std::endl;
+}
+void testParallelBulkLoad() {
+    std::cout << "Testing Parallel Bulk Load..." << std::endl;
+    auto matches = [](ScapeGoatTree<Type>& tree, const std::set<Type>& expected) {
+        assert(tree.size() == static_cast<int>(expected.size()));
+        std::vector<Type> seen;
+        for (Type v : tree) seen.push_back(v);
+        assert(seen == std::vector<Type>(expected.begin(), expected.end()));
+        assert(tree.isBalanced().find("NOT balanced") == std::string::npos);
+    };
+    std::mt19937 rng(18);
+    // unsorted with many duplicates, already sorted with duplicates, and all equal
+    std::vector<Type> shuffled(300000), sorted(100000), same(70000, 42);
+    for (Type& v : shuffled) v = static_cast<Type>(rng() % 120000);
+    for (int i = 0; i < 100000; ++i) sorted[i] = i / 3;
+    for (const auto* input : {&shuffled, &sorted, &same}) {
+        const std::set<Type> expected(input->begin(), input->end());
+        for (const int threads : {2, 3, 8}) {
+            auto tree = ScapeGoatTree<Type>::fromUnsorted(input->begin(), input->end(), threads);
+            matches(tree, expected);
+            assert(tree.getRebuildThreads() == threads);
+        }
+        ScapeGoatTree<Type> serial(input->begin(), input->end());
+        auto parallel = ScapeGoatTree<Type>::fromUnsorted(input->begin(), input->end(), 4);
+        assert(serial == parallel);
+    }
+
+    // a large insertBatch sorts its keys in parallel as well, and stays undoable
+    ScapeGoatTree<Type> tree;
+    tree.setRebuildThreads(4);
+    std::set<Type> expected;
+    for (int round = 0; round < 3; ++round) {
+        Vector<Type> batch;
+        for (int i = 0; i < 100000; ++i) {
+            const Type v = static_cast<Type>(rng() % 400000);
+            batch.push_back(v);
+            expected.insert(v);
+        }
+        tree.insertBatch(batch);
+        matches(tree, expected);
+    }
+    tree.undo();
+    assert(tree.size() < static_cast<int>(expected.size()));
+
+    // values with destructors
+    std::vector<std::string> words;
+    for (int i = 0; i < 90000; ++i) words.push_back("w" + std::to_string(rng() % 50000));
+    auto dictionary = ScapeGoatTree<std::string>::fromUnsorted(words.begin(), words.end(), 4);
+    const std::set<std::string> distinct(words.begin(), words.end());
+    assert(dictionary.size() == static_cast<int>(distinct.size()));
+    std::vector<std::string> seen;
+    for (const std::string& w : dictionary) seen.push_back(w);
+    assert(seen == std::vector<std::string>(distinct.begin(), distinct.end()));
+    std::cout << "Parallel Bulk Load Passed!" << std::endl;
+}
+void testParallelRangeQueries() {
+    std::cout << "Testing Parallel Range Queries..." << std::endl;
+    std::mt19937 rng(19);
+    std::vector<long long> keys(250000);
+    for (long long& k : keys) k = static_cast<long long>(rng() % 1000000);
+    ScapeGoatTree<long long> tree(keys.begin(), keys.end());
+    for (int i = 0; i < 20000; ++i) tree.deleteValue(static_cast<long long>(rng() % 1000000)); // a less regular shape
+
+    // random ranges, the whole tree, empty and inverted ranges; results match the serial ones exactly
+    std::vector<std::pair<long long, long long>> ranges{{-5, 2000000}, {500, 400}, {1000001, 2000000}, {7, 7}};
+    for (int i = 0; i < 40; ++i) {
+        long long lo = rng() % 1000000, hi = rng() % 1000000;
+        if (hi < lo) std::swap(lo, hi);
+        ranges.push_back({lo, hi});
+    }
+    for (const auto& [lo, hi] : ranges) {
+        const Vector<long long> serial = tree.valuesInRange(lo, hi);
+        const long long sum = tree.sumInRange(lo, hi);
+        for (const int threads : {1, 2, 4, 16}) {
+            const Vector<long long> parallel = tree.valuesInRangeParallel(lo, hi, threads);
+            assert(parallel.size() == serial.size());
+            for (unsigned int i = 0; i < serial.size(); ++i) assert(parallel[i] == serial[i]);
+            assert(tree.sumInRangeParallel(lo, hi, threads) == sum);
+        }
+    }
+
+    // floating-point sums are added up in the serial order, so they match bit for bit
+    std::vector<double> reals;
+    for (int i = 0; i < 100000; ++i) reals.push_back(std::ldexp(static_cast<double>(rng()), -static_cast<int>(rng() % 40)));
+    ScapeGoatTree<double> realTree(reals.begin(), reals.end());
+    assert(realTree.sumInRangeParallel(0.0, 1e12, 8) == realTree.sumInRange(0.0, 1e12));
+
+    // with SumAggregate the O(log n) serial query is used
+    ScapeGoatTree<long long, SumAggregate<long long>> summed(keys.begin(), keys.end());
+    assert(summed.sumInRangeParallel(1000, 900000, 4) == summed.sumInRange(1000, 900000));
+    std::cout << "Parallel Range Queries Passed!" << std::endl;
+}
+void testTaskPool() {
+    std::cout << "Testing Task Pool..." << std::endl;
+    // recursive fork/join sums, on a pool with no workers, one, and several
+    auto sum = [](auto&& self, TaskPool& pool, const long long lo, const long long hi) -> long long {
+        if (hi - lo <= 64) {
+            long long s = 0;
+            for (long long i = lo; i < hi; ++i) s += i;
+            return s;
+        }
+        const long long mid = (lo + hi) / 2;
+        long long left = 0, right = 0;
+        pool.join([&] { left = self(self, pool, lo, mid); }, [&] { right = self(self, pool, mid, hi); });
+        return left + right;
+    };
+    for (const unsigned int workers : {0u, 1u, 3u}) {
+        TaskPool pool(workers);
+        assert(pool.workers() == workers);
+        assert(sum(sum, pool, 0, 100000) == 100000LL * 99999 / 2);
+        const TaskPoolStats stats = pool.stats();
+        assert(stats.forks > 1000 && stats.stolen <= stats.forks);
+        if (workers == 0) assert(stats.stolen == 0);
+
+        std::vector<int> hits(5000, 0);
+        pool.forEach(0, 5000, 7, [&](const int i) { hits[i]++; });
+        assert(std::all_of(hits.begin(), hits.end(), [](const int h) { return h == 1; }));
+    }
+
+    // a worker takes the forked task while the caller is still busy
+    TaskPool pool(1);
+    std::atomic<bool> started{false};
+    pool.join([&] { started = true; }, [&] {
+        const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (!started && std::chrono::steady_clock::now() < deadline) std::this_thread::yield();
+        assert(started);
+    });
+    assert(pool.stats().stolen >= 1);
+
+    // exceptions from either side reach the caller, after both sides finished
+    for (const bool firstThrows : {true, false}) {
+        std::atomic<int> finished{0};
+        bool caught = false;
+        try {
+            pool.join([&] { finished++; if (firstThrows) throw std::runtime_error("first"); },
+                      [&] { finished++; if (!firstThrows) throw std::runtime_error("second"); });
+        } catch (const std::runtime_error& e) {
+            caught = std::string(e.what()) == (firstThrows ? "first" : "second");
+        }
+        assert(caught && finished == 2);
+    }
+
+    // outside threads share one pool
+    std::vector<std::thread> callers;
+    std::atomic<int> correct{0};
+    for (int t = 0; t < 4; ++t)
+        callers.emplace_back([&, t] { if (sum(sum, pool, t, 50000 + t) == (50000LL + t) * (49999 + t) / 2 - t * (t - 1LL) / 2) correct++; });
+    for (auto& caller : callers) caller.join();
+    assert(correct == 4);
+
+    // trees fork on the executor they are given, and pass it on to derived trees
+    TaskPool treePool(2);
+    ScapeGoatTree<Type> serial, parallel;
+    parallel.setRebuildThreads(4);
+    parallel.setExecutor(&treePool);
+    for (int i = 0; i < 120000; ++i) {
+        serial.insert(i);
+        parallel.insert(i);
+    }
+    assert(serial == parallel && treePool.stats().forks > 0);
+    ScapeGoatTree<Type> doubled = parallel + serial;
+    assert(doubled.getExecutor() == &treePool && doubled.size() == 120000);
+    parallel.setExecutor(nullptr);
+    for (int i = 0; i < 70000; ++i) parallel.deleteValue(i);
+    assert(parallel.size() == 50000 && parallel.search(70000) && !parallel.search(69999));
+    std::cout << "Task Pool Passed!" << std::endl;
+}
+void testFrozenSet() {
+    std::cout << "Testing Frozen Set..." << std::endl;
+    std::mt19937 rng(21);
+    // every size up to 70 (complete and partial last levels), then a large one
+    std::vector<int> sizes;
+    for (int n = 0; n <= 70; ++n) sizes.push_back(n);
+    sizes.push_back(100000);
+    for (const int n : sizes) {
+        ScapeGoatTree<Type> tree;
+        std::set<Type> expected;
+        while (static_cast<int>(expected.size()) < n) {
+            const Type v = static_cast<Type>(rng() % (4 * n + 1)) * 2 - 2 * n; // even keys, negatives too
+            expected.insert(v);
+            tree.insert(v);
+        }
+        const FrozenScapeGoatSet<Type> frozen = tree.freeze();
+        assert(frozen.size() == n && !frozen == (n == 0));
+        assert(std::vector<Type>(frozen.begin(), frozen.end()) == std::vector<Type>(expected.begin(), expected.end()));
+        std::vector<Type> probes;
+        for (int i = 0; i < 300; ++i) probes.push_back(static_cast<Type>(rng() % (8 * n + 11)) - 4 * n - 5);
+        probes.push_back(std::numeric_limits<Type>::min());
+        probes.push_back(std::numeric_limits<Type>::max());
+        std::unique_ptr<bool[]> found(new bool[probes.size()]);
+        frozen.searchBatch(probes.data(), static_cast<int>(probes.size()), found.get());
+        for (unsigned int i = 0; i < probes.size(); ++i) {
+            const Type p = probes[i];
+            const auto it = expected.lower_bound(p);
+            assert(frozen.search(p) == expected.count(p) && found[i] == frozen.search(p));
+            assert(frozen.rank(p) == static_cast<int>(std::distance(expected.begin(), it)));
+            const Type* bound = frozen.lowerBound(p);
+            assert(it == expected.end() ? bound == nullptr : bound && *bound == *it);
+            const Type q = probes[(i * 7) % probes.size()];
+            if (n <= 70) // the tree's own int sum would overflow on the large set
+                assert(frozen.sumInRange(p, q) == tree.sumInRange(p, q));
+        }
+        for (int k = 1; k <= n; k += 1 + n / 50) assert(frozen.kthSmallest(k) == tree.kthSmallest(k));
+        bool threw = false;
+        try {
+            frozen.kthSmallest(n + 1);
+        } catch (const std::out_of_range&) {
+            threw = true;
+        }
+        assert(threw);
+    }
+
+    // prefix sums built in parallel chunks add up to the same integers
+    std::vector<long long> keys(200000);
+    for (long long& k : keys) k = static_cast<long long>(rng() % 10000000);
+    ScapeGoatTree<long long> serial(keys.begin(), keys.end());
+    auto parallel = ScapeGoatTree<long long>::fromUnsorted(keys.begin(), keys.end(), 4);
+    TaskPool pool(2);
+    parallel.setExecutor(&pool);
+    FrozenScapeGoatSet<long long> a = serial.freeze(), b = parallel.freeze();
+    for (int i = 0; i < 200; ++i) {
+        long long lo = rng() % 10000000, hi = rng() % 10000000;
+        if (hi < lo) std::swap(lo, hi);
+        assert(a.sumInRange(lo, hi) == b.sumInRange(lo, hi) && b.sumInRange(lo, hi) == serial.sumInRange(lo, hi));
+    }
+
+    // the set is independent of the tree, and moves cleanly
+    FrozenScapeGoatSet<long long> moved = std::move(a);
+    serial.clear();
+    assert(moved.size() == b.size() && a.size() == 0 && !a.search(keys[0]) && moved.search(keys[0]));
+
+    // keys with destructors: lookups only
+    ScapeGoatTree<std::string> words;
+    for (int i = 0; i < 500; ++i) words.insert("w" + std::to_string(i * 3));
+    const FrozenScapeGoatSet<std::string> frozenWords = words.freeze();
+    assert(frozenWords.search("w3") && !frozenWords.search("w4") && frozenWords.kthSmallest(1) == "w0");
+    assert(*frozenWords.lowerBound("w1") == "w1002" && frozenWords.rank("w1") == 1);
+    std::cout << "Frozen Set Passed!" << std::endl;
+}
+void testCompact() {
+    std::cout << "Testing Compact..." << std::endl;
+    using TreeNode = Node<Type>;
+    // one block of n slots with the root first, the top half of the levels
+    // next, and every subtree below them in a run of its own
+    auto checkLayout = [](ScapeGoatTree<Type>& tree) {
+        const int n = tree.size();
+        std::vector<std::pair<const TreeNode*, int>> nodes{{tree.getRoot(), 0}};
+        for (unsigned int i = 0; i < nodes.size(); ++i) {
+            const auto [node, depth] = nodes[i];
+            if (node->left) nodes.push_back({node->left, depth + 1});
+            if (node->right) nodes.push_back({node->right, depth + 1});
+        }
+        assert(static_cast<int>(nodes.size()) == n);
+        const auto base = reinterpret_cast<std::uintptr_t>(tree.getRoot());
+        auto slot = [base](const TreeNode* node) { return (reinterpret_cast<std::uintptr_t>(node) - base) / sizeof(TreeNode); };
+        std::vector<bool> used(n, false);
+        for (const auto& [node, depth] : nodes) {
+            assert(reinterpret_cast<std::uintptr_t>(node) >= base && slot(node) < static_cast<std::size_t>(n) && !used[slot(node)]);
+            used[slot(node)] = true;
+        }
+        const int top = std::bit_width(static_cast<unsigned int>(n)) / 2;
+        for (const auto& [node, depth] : nodes) {
+            if (depth < top) assert(slot(node) < (1u << top) - 1);
+            if (depth != top) continue;
+            std::size_t lo = slot(node), hi = lo;
+            std::vector<const TreeNode*> todo{node};
+            while (!todo.empty()) {
+                const TreeNode* t = todo.back();
+                todo.pop_back();
+                lo = std::min(lo, slot(t));
+                hi = std::max(hi, slot(t));
+                if (t->left) todo.push_back(t->left);
+                if (t->right) todo.push_back(t->right);
+            }
+            assert(hi - lo + 1 == node->size && lo == slot(node));
+        }
+    };
+    std::mt19937 rng(22);
+    for (const int n : {1, 2, 3, 7, 100, 1000, 65537}) {
+        ScapeGoatTree<Type> tree;
+        std::set<Type> expected;
+        for (int i = 0; i < 2 * n; ++i) {
+            const Type v = static_cast<Type>(rng() % (3 * n));
+            tree.insert(v);
+            expected.insert(v);
+        }
+        for (int i = 0; i < n; ++i) {
+            const Type v = static_cast<Type>(rng() % (3 * n));
+            tree.deleteValue(v);
+            expected.erase(v);
+        }
+        tree.compact();
+        assert(tree.size() == static_cast<int>(expected.size()) && tree.isBalanced().find("NOT balanced") == std::string::npos);
+        std::vector<Type> seen;
+        for (const Type v : tree) seen.push_back(v);
+        assert(seen == std::vector<Type>(expected.begin(), expected.end()));
+        if (tree.size()) checkLayout(tree);
+        assert(tree.poolStats().liveNodes == expected.size() && tree.poolStats().capacity < 2 * expected.size() + 64);
+        tree.insert(-1); // still a normal tree
+        assert(tree.search(-1) && (expected.empty() || tree.getSuccessor(-1) == *expected.begin()));
+    }
+
+    // bulk loads are laid out the same way
+    std::vector<Type> sorted(50000);
+    for (int i = 0; i < 50000; ++i) sorted[i] = 2 * i;
+    auto loaded = ScapeGoatTree<Type>::fromSorted(sorted.begin(), sorted.end());
+    checkLayout(loaded);
+
+    // a snapshot keeps the nodes it sees; aggregates are recomputed
+    ScapeGoatTree<Type, SumAggregate<Type>> summed;
+    for (int i = 0; i < 3000; ++i) summed.insert(i);
+    auto view = summed.snapshot();
+    summed.compact();
+    for (int i = 0; i < 1000; ++i) summed.deleteValue(i);
+    assert(view.size() == 3000 && view.sumInRange(0, 2999) == 2999 * 3000 / 2 && view.search(5));
+    assert(summed.sumInRange(0, 5000) == 2999 * 3000 / 2 - 999 * 1000 / 2 && summed.size() == 2000);
+
+    // large rebuilds can relocate on their own
+    ScapeGoatTree<Type> relocating;
+    relocating.setCompactRebuild(64);
+    for (int i = 0; i < 20000; ++i) relocating.insert(i);
+    for (int i = 0; i < 15000; ++i) relocating.deleteValue(i);
+    assert(relocating.size() == 5000 && relocating.kthSmallest(1) == 15000 && relocating.getCompactRebuild() == 64);
+    assert(relocating.poolStats().liveNodes == 5000);
+    relocating.undo();
+    assert(relocating.size() == 5001 && relocating.search(14999));
+    std::cout << "Compact Passed!" << std::endl;
+}
+void testCompactStorage() {
+    std::cout << "Testing Compact Storage..." << std::endl;
+    static_assert(CompactScapeGoatTree<int>::nodeBytes() == 20);
+    std::mt19937 rng(23);
+    // the same operations must give the same shape as the pointer tree
+    ScapeGoatTree<Type, SumAggregate<Type>> reference;
+    CompactScapeGoatTree<Type, SumAggregate<Type>> tree;
+    for (int round = 0; round < 40; ++round) {
+        for (int i = 0; i < 2000; ++i) {
+            const Type v = static_cast<Type>(rng() % 5000);
+            if (rng() % 3) {
+                reference.insert(v);
+                tree.insert(v);
+            } else {
+                assert(reference.deleteValue(v) == tree.deleteValue(v));
+            }
+        }
+        Vector<Type> batch;
+        for (int i = 0; i < 300; ++i) batch.push_back(static_cast<Type>(rng() % 5000));
+        if (round % 2) {
+            reference.insertBatch(batch);
+            tree.insertBatch(batch);
+        } else {
+            reference.deleteBatch(batch);
+            tree.deleteBatch(batch);
+        }
+        if (round % 5 == 0) {
+            reference.undo();
+            tree.undo();
+            if (round % 10 == 0) {
+                reference.redo();
+                tree.redo();
+            }
+        }
+        assert(tree.size() == reference.size());
+        assert(tree.displayPreOrder() == reference.displayPreOrder());
+        const Type lo = static_cast<Type>(rng() % 5000), hi = lo + static_cast<Type>(rng() % 2000);
+        assert(tree.sumInRange(lo, hi) == reference.sumInRange(lo, hi));
+        assert(tree.valuesInRange(lo, hi).size() == reference.valuesInRange(lo, hi).size());
+        for (int k = 1; k <= tree.size(); k += 97) assert(tree.kthSmallest(k) == reference.kthSmallest(k));
+    }
+    std::vector<Type> keys;
+    for (auto it = reference.begin(); it != ScapeGoatTree<Type, SumAggregate<Type>>::end(); ++it) keys.push_back(*it);
+    std::vector<Type> walked;
+    for (auto it = tree.begin(); it != CompactScapeGoatTree<Type, SumAggregate<Type>>::end(); ++it) walked.push_back(*it);
+    assert(walked == keys);
+    assert(tree.getMin() == keys.front() && tree.getMax() == keys.back());
+    assert(tree.getSuccessor(keys[0]) == keys[1]);
+    assert(tree.isBalanced().find("NOT") == std::string::npos);
+
+    // shrink_to_fit keeps the shape and drops every free slot
+    const std::string shape = tree.displayPreOrder();
+    tree.shrink_to_fit();
+    assert(tree.memoryUsage() == (tree.size() + 1) * tree.nodeBytes());
+    assert(tree.displayPreOrder() == shape);
+    tree.insert(-1);
+    assert(tree.search(-1) && tree.deleteValue(-1));
+
+    // copies are independent, moves leave the source empty
+    CompactScapeGoatTree<Type, SumAggregate<Type>> copy(tree);
+    assert(copy == tree);
+    copy.deleteValue(keys[0]);
+    assert(copy != tree && tree.search(keys[0]));
+    CompactScapeGoatTree<Type, SumAggregate<Type>> moved(std::move(copy));
+    assert(!copy && moved.size() == tree.size() - 1);
+    copy = moved;
+    assert(copy == moved);
+
+    // bulk loads take exactly one slot per key
+    std::vector<Type> unsorted(keys.rbegin(), keys.rend());
+    unsorted.push_back(keys[0]);
+    CompactScapeGoatTree<Type> bulk(unsorted.begin(), unsorted.end());
+    const auto sorted = CompactScapeGoatTree<Type>::fromSorted(keys.begin(), keys.end());
+    assert(bulk == sorted && bulk.size() == static_cast<int>(keys.size()));
+    assert(bulk.displayPreOrder() == ScapeGoatTree<Type>::fromSorted(keys.begin(), keys.end()).displayPreOrder());
+    assert(bulk.memoryUsage() == (keys.size() + 1) * bulk.nodeBytes());
+    const auto both = bulk + CompactScapeGoatTree<Type>::fromSorted(unsorted.begin(), unsorted.begin() + 1);
+    assert(both == bulk);
+    bool rejected = false;
+    try { bulk.assignSorted(unsorted.begin(), unsorted.end()); } catch (const std::invalid_argument&) { rejected = true; }
+    assert(rejected && bulk == sorted);
+
+    // values with destructors survive growing, freeing and reuse of slots
+    CompactScapeGoatTree<std::string> words;
+    for (int i = 0; i < 3000; ++i) words.insert("word" + std::to_string(i));
+    for (int i = 0; i < 3000; i += 2) assert(words.deleteValue("word" + std::to_string(i)));
+    for (int i = 0; i < 1000; ++i) words.insert("again" + std::to_string(i));
+    assert(words.size() == 2500 && words.search("word1") && !words.search("word0"));
+    words.clear();
+    assert(!words && words.displayInOrder() == "Tree is empty.");
+    std::cout << "Compact Storage Passed!" << std::endl;
+}
+
+void testNodeFeatures() {
+    std::cout << "Testing Node Features..." << std::endl;
+    using NoParent = CompactScapeGoatTree<Type, NoAggregate, NodeFeatures<false, true>>;
+    using NoSize = CompactScapeGoatTree<Type, NoAggregate, NodeFeatures<true, false>>;
+    using Bare = CompactScapeGoatTree<Type, NoAggregate, NodeFeatures<false, false>>;
+    using BareSum = CompactScapeGoatTree<Type, SumAggregate<Type>, NodeFeatures<false, false>>;
+    static_assert(sizeof(CompactNode<int, NoAggregate, NodeFeatures<false, true>>) == 16);
+    static_assert(sizeof(CompactNode<int, NoAggregate, NodeFeatures<true, false>>) == 16);
+    static_assert(NoParent::nodeBytes() == 16 && Bare::nodeBytes() == 12);
+    std::mt19937 rng(24);
+    // sizes summed along the path find the same scapegoats, so shapes match
+    CompactScapeGoatTree<Type> full;
+    NoParent noParent;
+    NoSize noSize;
+    Bare bare;
+    BareSum bareSum;
+    auto sameShape = [&] {
+        const std::string shape = full.displayPreOrder();
+        return noParent.displayPreOrder() == shape && noSize.displayPreOrder() == shape &&
+               bare.displayPreOrder() == shape && bareSum.displayPreOrder() == shape;
+    };
+    for (int round = 0; round < 30; ++round) {
+        for (int i = 0; i < 2000; ++i) {
+            const Type v = static_cast<Type>(rng() % 4000);
+            if (rng() % 3) {
+                full.insert(v);
+                noParent.insert(v);
+                noSize.insert(v);
+                bare.insert(v);
+                bareSum.insert(v);
+            } else {
+                const bool removed = full.deleteValue(v);
+                assert(noParent.deleteValue(v) == removed && noSize.deleteValue(v) == removed);
+                assert(bare.deleteValue(v) == removed && bareSum.deleteValue(v) == removed);
+            }
+        }
+        Vector<Type> batch;
+        for (int i = 0; i < 200; ++i) batch.push_back(static_cast<Type>(rng() % 4000));
+        full.insertBatch(batch);
+        noParent.insertBatch(batch);
+        noSize.insertBatch(batch);
+        bare.insertBatch(batch);
+        bareSum.insertBatch(batch);
+        if (round % 4 == 0) {
+            full.undo();
+            noParent.undo();
+            noSize.undo();
+            bare.undo();
+            bareSum.undo();
+        }
+        assert(sameShape());
+        const Type lo = static_cast<Type>(rng() % 4000), hi = lo + static_cast<Type>(rng() % 1000);
+        assert(bareSum.sumInRange(lo, hi) == full.sumInRange(lo, hi));
+        assert(noParent.kthSmallest(round + 1) == full.kthSmallest(round + 1));
+    }
+    // without parent links the iterator walks with a stack
+    std::vector<Type> expected, walked;
+    for (auto it = full.begin(); it != CompactScapeGoatTree<Type>::end(); ++it) expected.push_back(*it);
+    for (auto it = bare.begin(); it != Bare::end(); ++it) walked.push_back(*it);
+    assert(walked == expected);
+    bare.shrink_to_fit();
+    noSize.shrink_to_fit();
+    assert(sameShape() && bare.memoryUsage() == static_cast<std::size_t>(bare.size() + 1) * 12);
+    assert(noSize.getSuccessor(expected[0]) == expected[1] && bare.getMax() == expected.back());
+    std::cout << "Node Features Passed!" << std::endl;
+}
+
+void testBatchLookup() {
+    std::cout << "Testing Batch Lookup..." << std::endl;
+    std::mt19937 rng(25);
+    ScapeGoatTree<Type> tree;
+    Type keys[600];
+    bool found[600];
+    Type successors[600];
+    bool hasSuccessor[600];
+    decltype(tree.find_node(keys[0])) nodes[600];
+    // empty tree and empty batches
+    for (int i = 0; i < 4; ++i) keys[i] = static_cast<Type>(i);
+    tree.searchBatch(keys, 4, found);
+    tree.successorBatch(keys, 4, successors, hasSuccessor);
+    assert(!found[0] && !found[3] && !hasSuccessor[0] && !hasSuccessor[3]);
+    tree.searchBatch(keys, 0, found);
+    for (int i = 0; i < 5000; ++i) tree.insert(static_cast<Type>(rng() % 20000));
+    auto check = [&](const int m) {
+        tree.searchBatch(keys, m, found);
+        tree.findBatch(keys, m, nodes);
+        tree.successorBatch(keys, m, successors, hasSuccessor);
+        for (int i = 0; i < m; ++i) {
+            assert(found[i] == tree.search(keys[i]));
+            assert(nodes[i] == tree.find_node(keys[i]));
+            bool expected = true;
+            Type next{};
+            try { next = tree.getSuccessor(keys[i]); } catch (const std::runtime_error&) { expected = false; }
+            assert(hasSuccessor[i] == expected && (!expected || successors[i] == next));
+        }
+    };
+    ScapeGoatTree<Type>::Snapshot view;
+    for (int round = 0; round < 20; ++round) {
+        // later rounds copy paths under a live snapshot; successors climb parent links
+        if (round == 10) view = tree.snapshot();
+        // unsorted, with duplicates and keys past both ends
+        const int m = 1 + static_cast<int>(rng() % 600);
+        for (int i = 0; i < m; ++i) keys[i] = static_cast<Type>(rng() % 20400) - 200;
+        if (round % 3 == 0) for (int i = 1; i < m; i += 2) keys[i] = keys[i - 1];
+        check(m);
+        std::sort(keys, keys + m);
+        check(m);
+        for (int i = 0; i < 300; ++i) tree.deleteValue(static_cast<Type>(rng() % 20000));
+    }
+    keys[0] = keys[1] = tree.getMax();
+    keys[2] = tree.getMin() - 1;
+    check(3);
+    assert(found[0] && found[1] && !hasSuccessor[0] && !hasSuccessor[1]);
+    assert(hasSuccessor[2] && successors[2] == tree.getMin());
+    std::cout << "Batch Lookup Passed!" << std::endl;
+}
+
+void testShardedTree() {
+    std::cout << "Testing Sharded Tree..." << std::endl;
+    using Sharded = ShardedScapeGoatTree<Type, SumAggregate<Type>>;
+    auto matches = [](Sharded& tree, const std::set<Type>& expected) {
+        assert(tree.size() == static_cast<int>(expected.size()));
+        std::vector<Type> seen;
+        for (Type v : tree) seen.push_back(v);
+        assert(std::equal(seen.begin(), seen.end(), expected.begin(), expected.end()));
+        long long total = 0;
+        for (Type v : expected) total += v;
+        assert(tree.sumInRange(std::numeric_limits<Type>::min(), std::numeric_limits<Type>::max()) == total);
+        int k = 0;
+        for (Type v : expected)
+            if (++k % 53 == 1) assert(tree.kthSmallest(k) == v);
+    };
+
+    // small shards so splits and merges happen constantly
+    Sharded tree(4, 16);
+    std::set<Type> expected;
+    std::mt19937 rng(7);
+    std::uniform_int_distribution<int> dist(-5000, 5000);
+    for (int i = 0; i < 4000; ++i) {
+        const int v = dist(rng);
+        if (rng() % 3) {
+            tree.insert(v);
+            expected.insert(v);
+        } else {
+            assert(tree.deleteValue(v) == (expected.erase(v) == 1));
+        }
+    }
+    matches(tree, expected);
+    assert(tree.shardCount() == 4);
+    Vector<int> sizes = tree.shardSizes();
+    for (unsigned int i = 0; i < sizes.size(); i++) assert(sizes[i] <= 2 * std::max(16, tree.size() / 4));
+
+    // range queries that start, end and straddle shard boundaries
+    for (int i = 0; i < 200; ++i) {
+        int lo = dist(rng), hi = dist(rng);
+        if (hi < lo) std::swap(lo, hi);
+        long long want = 0;
+        for (auto it = expected.lower_bound(lo); it != expected.end() && *it <= hi; ++it) want += *it;
+        assert(tree.sumInRange(lo, hi) == want);
+        assert(tree.aggregateInRange(lo, hi) == want);
+        assert(tree.search(lo) == expected.contains(lo));
+    }
+    bool threw = false;
+    try { (void)tree.kthSmallest(tree.size() + 1); } catch (const std::out_of_range&) { threw = true; }
+    assert(threw);
+
+    // batches routed to every shard, then most of the keys removed again
+    Vector<Type> batch, victims;
+    for (int i = 10000; i < 30000; i += 3) {
+        batch.push_back(i);
+        expected.insert(i);
+    }
+    tree.insertBatch(batch);
+    matches(tree, expected);
+    for (Type v : expected) if (v % 5) victims.push_back(v);
+    tree.deleteBatch(victims);
+    for (unsigned int i = 0; i < victims.size(); i++) expected.erase(victims[i]);
+    matches(tree, expected);
+
+    // a snapshot keeps its view across later writes and rebalancing
+    auto view = tree.snapshot();
+    const std::set<Type> frozen = expected;
+    for (int i = -20000; i < -10000; ++i) tree.insert(i);
+    int k = 0;
+    for (auto it = view.begin(); it != view.end(); ++it, ++k) assert(frozen.contains(*it));
+    assert(k == static_cast<int>(frozen.size()) && view.size() == k);
+    assert(!view.search(-15000) && tree.search(-15000));
+    assert(view.kthSmallest(1) == *frozen.begin());
+
+    // writers on their own key ranges, plus one batch writer, all at once
+    Sharded shared(8, 64);
+    std::vector<std::thread> writers;
+    for (int t = 0; t < 4; ++t) {
+        writers.emplace_back([&shared, t] {
+            for (int i = 0; i < 5000; ++i) shared.insert(i * 4 + t);
+            for (int i = 0; i < 5000; i += 2) shared.deleteValue(i * 4 + t);
+        });
+    }
+    writers.emplace_back([&shared] {
+        Vector<Type> keys;
+        for (int i = 0; i < 5000; ++i) keys.push_back(100000 + i);
+        shared.insertBatch(keys);
+    });
+    bool ordered = true;
+    for (int round = 0; round < 5; ++round) {
+        long long previous = std::numeric_limits<long long>::min();
+        for (Type v : shared) {
+            ordered = ordered && v > previous;
+            previous = v;
+        }
+    }
+    for (auto& w : writers) w.join();
+    assert(ordered);
+    std::set<Type> want;
+    for (int t = 0; t < 4; ++t)
+        for (int i = 1; i < 5000; i += 2) want.insert(i * 4 + t);
+    for (int i = 0; i < 5000; ++i) want.insert(100000 + i);
+    matches(shared, want);
+    assert(tree.historySize() == 0 && shared.historySize() == 0); // splits and joins included
+    std::cout << "Sharded Tree Passed!" << std::endl;
+}
+void testRcuReaders() {
+    std::cout << "Testing RCU Readers..." << std::endl;
+    using Rcu = RcuScapeGoatTree<Type, SumAggregate<Type>>;
+    Rcu tree;
+    for (int i = 0; i < 1000; ++i) tree.insert(i * 2);
+    assert(tree.size() == 1000 && tree.search(10) && !tree.search(11));
+    assert(tree.getSuccessor(10) == 12 && tree.kthSmallest(3) == 4);
+    assert(tree.sumInRange(0, 10) == 30);
+
+    // a pinned version ignores later writes and keeps its nodes alive
+    {
+        auto pinned = tree.read();
+        for (int i = 0; i < 1000; i += 2) tree.deleteValue(i * 2);
+        for (int i = 5000; i < 5500; ++i) tree.insert(i); // sorted run: rebuilds
+        assert(pinned.size() == 1000 && pinned.search(0) && !pinned.search(5000));
+        long long sum = 0;
+        int count = 0;
+        for (Type v : pinned) {
+            sum += v;
+            count++;
+        }
+        assert(count == 1000 && sum == pinned.sumInRange(0, 2000) && sum == 999LL * 1000);
+        assert(pinned.kthSmallest(1000) == 1998);
+        assert(tree.pendingReclaim() > 0);
+    }
+    tree.insert(-1); // first write after the reader left frees everything it held
+    assert(tree.pendingReclaim() == 0);
+    assert(static_cast<int>(tree.poolStats().liveNodes) == tree.size());
+
+    Vector<Type> batch;
+    for (int i = 10000; i < 12000; ++i) batch.push_back(i);
+    tree.insertBatch(batch);
+    assert(tree.search(11999));
+    tree.deleteBatch(batch);
+    assert(!tree.search(11999));
+    tree.clear();
+    assert(tree.size() == 0 && tree.pendingReclaim() == 0);
+    bool threw = false;
+    try { (void)tree.getSuccessor(0); } catch (const std::runtime_error&) { threw = true; }
+    assert(threw);
+
+    // one writer keeps every key k paired with k + 1; readers must never see half a pair
+    constexpr int PAIRS = 3000;
+    std::atomic<bool> done{false};
+    bool consistent = true;
+    std::thread writer([&tree, &done] {
+        for (int round = 0; round < 3; ++round) {
+            for (int i = 0; i < PAIRS; ++i) {
+                Vector<Type> pair;
+                pair.push_back(i * 10);
+                pair.push_back(i * 10 + 1);
+                tree.insertBatch(pair);
+            }
+            for (int i = 0; i < PAIRS; i += 2) {
+                Vector<Type> pair;
+                pair.push_back(i * 10);
+                pair.push_back(i * 10 + 1);
+                tree.deleteBatch(pair);
+            }
+        }
+        done = true;
+    });
+    std::vector<std::thread> readerThreads;
+    std::vector<char> ok(3, 1);
+    for (int r = 0; r < 3; ++r) {
+        readerThreads.emplace_back([&tree, &done, &ok, r] {
+            while (!done) {
+                auto view = tree.read();
+                long long sum = 0;
+                int count = 0;
+                Type previous = -1;
+                for (Type v : view) {
+                    if (v <= previous || (v % 10 == 1 && previous != v - 1)) ok[r] = 0;
+                    sum += v;
+                    previous = v;
+                    count++;
+                }
+                if (count != view.size() || count % 2 || sum != view.sumInRange(0, PAIRS * 10)) ok[r] = 0;
+                const int probe = (count * 7) % PAIRS * 10;
+                if (view.search(probe) != view.search(probe + 1)) ok[r] = 0;
+            }
+        });
+    }
+    writer.join();
+    for (auto& t : readerThreads) t.join();
+    for (char flag : ok) consistent = consistent && flag;
+    assert(consistent);
+    tree.insert(-5);
+    assert(tree.pendingReclaim() == 0);
+    assert(tree.size() == PAIRS + 1);
+    assert(tree.historySize() == 0); // thousands of writes, no undo history kept
+    std::cout << "RCU Readers Passed!" << std::endl;
+}
+/**
+ * Key whose comparisons throw for one value, to exercise error paths.
+ */
+struct Fragile {
+    static constexpr int POISON = -13;
+    int v = 0;
+    static void check(const Fragile& a, const Fragile& b) {
+        if (a.v == POISON || b.v == POISON) throw std::domain_error("poisoned key");
+    }
+    friend bool operator<(const Fragile& a, const Fragile& b) { check(a, b); return a.v < b.v; }
+    friend bool operator>(const Fragile& a, const Fragile& b) { check(a, b); return a.v > b.v; }
+    friend bool operator==(const Fragile& a, const Fragile& b) { check(a, b); return a.v == b.v; }
+};
+void testFlatCombining() {
+    std::cout << "Testing Flat Combining..." << std::endl;
+    using Combined = ConcurrentScapeGoatTree<Type, SumAggregate<Type>>;
+    Combined tree;
+    assert(tree.insert(5) && !tree.insert(5) && tree.search(5));
+    assert(tree.deleteValue(5) && !tree.deleteValue(5) && !tree.search(5));
+    assert(tree.size() == 0);
+
+    // every thread works on its own keys, so each answer is predictable
+    constexpr int THREADS = 4, KEYS = 3000;
+    std::vector<std::thread> threads;
+    std::vector<char> ok(THREADS, 1);
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&tree, &ok, t] {
+            for (int i = 0; i < KEYS; ++i) {
+                const int key = i * THREADS + t;
+                if (!tree.insert(key) || tree.insert(key) || !tree.search(key)) ok[t] = 0;
+            }
+            for (int i = 0; i < KEYS; i += 2) {
+                const int key = i * THREADS + t;
+                if (!tree.deleteValue(key) || tree.search(key)) ok[t] = 0;
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    for (char flag : ok) assert(flag);
+    assert(tree.size() == THREADS * KEYS / 2);
+    long long want = 0;
+    for (int t = 0; t < THREADS; ++t)
+        for (int i = 1; i < KEYS; i += 2) want += i * THREADS + t;
+    assert(tree.sumInRange(0, THREADS * KEYS) == want);
+    assert(tree.kthSmallest(1) == THREADS); // i = 1, t = 0
+
+    // everyone races for the same keys: each key is added exactly once
+    threads.clear();
+    std::atomic<int> wins{0};
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&tree, &wins] {
+            for (int i = 0; i < 2000; ++i)
+                if (tree.insert(-1 - i)) wins++;
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    assert(wins == 2000);
+    assert(tree.size() == THREADS * KEYS / 2 + 2000);
+    const CombiningStats stats = tree.combiningStats();
+    assert(stats.passes > 0 && stats.requests >= stats.passes);
+
+    // requests posted while the tree is locked pile up and are served in one pass
+    threads.clear();
+    std::atomic<int> posted{0};
+    std::vector<char> answers(16, 0);
+    tree.locked([&](auto& inner) {
+        inner.insert(100000); // direct access still keeps size() right
+        for (int t = 0; t < 16; ++t) {
+            threads.emplace_back([&tree, &posted, &answers, t] {
+                posted++;
+                // pairs of threads insert then delete, or search, the same key
+                if (t % 4 == 0) answers[t] = tree.insert(200000 + t);
+                else if (t % 4 == 1) answers[t] = tree.deleteValue(100000);
+                else answers[t] = tree.search(100000 + t % 2);
+            });
+        }
+        while (posted < 16) std::this_thread::yield();
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+    });
+    for (auto& thread : threads) thread.join();
+    const CombiningStats after = tree.combiningStats();
+    assert(after.requests - stats.requests > after.passes - stats.passes); // some pass served several
+    int deleted = 0;
+    for (int t = 0; t < 16; ++t) {
+        if (t % 4 == 0) assert(answers[t]);
+        if (t % 4 == 1) deleted += answers[t];
+        if (t % 4 == 3) assert(!answers[t]); // 100001 never existed
+    }
+    assert(deleted == 1 && !tree.search(100000));
+    assert(tree.size() == THREADS * KEYS / 2 + 2000 + 4);
+    assert(tree.locked([](auto& inner) { return inner.size(); }) == tree.size());
+    assert(tree.locked([](auto& inner) { return inner.historySize(); }) == 0);
+
+    // history is opt-in; with it, locked() can undo a whole combined pass
+    ConcurrentScapeGoatTree<Type> undoable(true);
+    undoable.insert(1);
+    assert(undoable.locked([](auto& inner) { return inner.historySize(); }) > 0);
+    undoable.locked([](auto& inner) { inner.undo(); });
+    assert(undoable.size() == 0 && !undoable.search(1));
+
+    // a request whose key makes the tree throw gets the exception; the pass
+    // does not leave anyone waiting, and the tree stays usable
+    ConcurrentScapeGoatTree<Fragile> fragile;
+    assert(fragile.insert(Fragile{1}) && fragile.insert(Fragile{3}));
+    bool threw = false;
+    try { fragile.insert(Fragile{Fragile::POISON}); } catch (const std::domain_error&) { threw = true; }
+    assert(threw && fragile.size() == 2);
+    threads.clear();
+    std::atomic<int> failures{0};
+    for (int t = 0; t < THREADS; ++t) {
+        threads.emplace_back([&fragile, &failures, t] {
+            for (int i = 0; i < 200; ++i) {
+                try {
+                    fragile.insert(Fragile{i % 50 == 0 ? Fragile::POISON : 10 + i * THREADS + t});
+                } catch (const std::domain_error&) {
+                    failures++;
+                }
+            }
+        });
+    }
+    for (auto& thread : threads) thread.join();
+    assert(failures >= THREADS * 4 && fragile.search(Fragile{3}));
+    assert(fragile.size() == fragile.locked([](auto& inner) { return inner.size(); }));
+    std::cout << "Flat Combining Passed!" << std::endl;
+}
 int main() {
 
     try {
@@ -335,6 +2047,31 @@ int main() {
         testUandR();
         stressTest();
         testIterator();
+        testNodePool();
+        testInPlaceRebuild();
+        testHotPaths();
+        testAggregates();
+        testBulkConstruction();
+        testMergeBatch();
+        testSubtractBatch();
+        testSetAlgebra();
+        testSplitJoin();
+        testStructuralCopy();
+        testSnapshots();
+        testBackgroundRebuild();
+        testIncrementalRebuild();
+        testParallelRebuild();
+        testParallelBulkLoad();
+        testParallelRangeQueries();
+        testTaskPool();
+        testFrozenSet();
+        testCompact();
+        testCompactStorage();
+        testNodeFeatures();
+        testBatchLookup();
+        testShardedTree();
+        testRcuReaders();
+        testFlatCombining();
         std::cout << "\n=======================================" << std::endl;
         std::cout << " ALL EXTREME TESTS PASSED SUCCESSFULLY!" << std::endl;
         std::cout << "=======================================" << std::endl;
@@ -33,7 +33,7 @@ public:
      */
     void push_back(const T& value) {
        if (nElements >= _size) {
-           _size *= 2;
+           _size = _size ? _size * 2 : 50; // a moved-from vector has no storage
            T* newData = new T[_size]{};
            for (unsigned int i = 0; i < nElements; ++i)
                newData[i] = data[i];
@@ -65,6 +65,10 @@ public:
         }
         return value;
     }
+    /**
+     * Forgets all elements but keeps the storage for reuse.
+     */
+    void clear() { nElements = 0; }
     T* begin() { return data; }
     T* end()   { return data + _size; }
 
@@ -77,13 +81,11 @@ public:
      * Provides read-only access to the element at the specified index.
      */
     const T& operator[](unsigned int index) const { return data[index]; }
-    template <typename>
+    template <typename, typename>
     friend class ScapeGoatTree;
 
-    Vector(const Vector& other) {
-        nElements = other.nElements;
-        _size = other._size;
-        data = new T[_size];
+    Vector(const Vector& other)
+        : _size(other._size), nElements(other.nElements), data(new T[other._size]) {
         for (int i = 0; i < nElements; i++) {
             data[i] = other.data[i];
         }
@@ -104,11 +106,8 @@ public:
         return *this;
     }
     // Move constructor
-    Vector(Vector&& other) noexcept {
-        data = other.data;
-        nElements = other.nElements;
-        _size = other._size;
-
+    Vector(Vector&& other) noexcept
+        : _size(other._size), nElements(other.nElements), data(other.data) {
         other.data = nullptr;
         other.nElements = 0;
         other._size = 0;